@@ -153,6 +153,7 @@
 
             # Path prefixes for executables
             exeprefix = ${cfg.settings.exePrefix}
+            canonprefix = ${cfg.settings.canonPrefix}
 
             # Prediction algorithm
             prediction_algorithm = ${cfg.settings.predictionAlgorithm}
@@ -278,16 +279,29 @@
                 '';
               };
 
+              canonPrefix = lib.mkOption {
+                type = lib.types.str;
+                default = "/nix/store/";
+                description = ''
+                  Versioned install locations. Store hashes and versions are
+                  ignored below these prefixes, so rebuilds keep the model.
+                '';
+              };
+
               predictionAlgorithm = lib.mkOption {
                 type = lib.types.enum [
                   "Markov"
                   "VOMM"
+                  "Frecency"
+                  "Logistic"
                 ];
                 default = "VOMM";
                 description = ''
                   The prediction algorithm to use.
                   "Markov" = Classic Markov chain prediction.
                   "VOMM" = Variable Order Markov Model (experimental).
+                  "Frecency" = Decayed start counts, cheapest, for small hosts.
+                  "Logistic" = Online logistic model per app, for many apps.
                 '';
               };
 
@@ -0,0 +1,205 @@
+/* cluster.c - Clusters of exes that run together
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "cluster.h"
+#include "conf.h"
+#include "exe.h"
+#include "markov.h"
+#include "state.h"
+
+/*
+ * Exes that nearly always run together, an app and its helpers, carry
+ * the same information in their chains with every other exe.  Once in a
+ * while, when the state is saved, the chains are looked at, and exes
+ * whose running times have a Jaccard similarity
+ *
+ *   J(a,b) = time(a and b) / time(a or b)
+ *
+ * of at least model.clustersim are merged into a cluster.  The member
+ * that ran the longest leads it and keeps its chains, which now stand
+ * for the whole cluster; the others drop theirs, and no new ones are
+ * made for them.  When the leader is predicted to start, so is every
+ * member, and their maps are read ahead together.
+ *
+ * A member starting while its leader is not running leaves the cluster
+ * and gets chains of its own again, from scratch.
+ */
+
+#define CLUSTER_MIN_CYCLES 10	/* running together before a pair counts */
+
+/* Access to global state */
+extern preload_state_t state[1];
+
+
+/* union-find over the exes of a pass */
+static preload_exe_t *
+find (GHashTable *parent, preload_exe_t *exe)
+{
+  preload_exe_t *p;
+
+  while ((p = g_hash_table_lookup (parent, exe)) && p != exe)
+    exe = p;
+  return exe;
+}
+
+static void
+merge_similar (preload_markov_t *markov, GHashTable *parent)
+{
+  preload_exe_t *a = markov->a, *b = markov->b;
+  gint64 either;
+
+  if (a->cluster || b->cluster)
+    return;
+  if (markov->time < (gint64)CLUSTER_MIN_CYCLES * conf->model.cycle)
+    return;
+
+  either = a->time + b->time - markov->time;
+  if (either <= 0 || markov->time * 100 < either * conf->model.clustersim)
+    return;
+
+  a = find (parent, a);
+  b = find (parent, b);
+  if (a == b)
+    return;
+
+  /* the longest running leads */
+  if (a->time < b->time || (a->time == b->time && a->seq > b->seq)) {
+    preload_exe_t *t = a;
+    a = b;
+    b = t;
+  }
+  g_hash_table_insert (parent, b, a);
+}
+
+static void
+drop_markovs (preload_exe_t *exe)
+{
+  guint i;
+
+  for (i = 0; i < exe->markovs->len; i++)
+    preload_markov_free (g_ptr_array_index (exe->markovs, i), exe);
+  g_ptr_array_set_size (exe->markovs, 0);
+}
+
+void
+preload_cluster_join (preload_exe_t *member, preload_exe_t *leader)
+{
+  g_return_if_fail (member && leader && member != leader);
+  g_return_if_fail (!leader->cluster);
+
+  drop_markovs (member);
+  member->cluster = leader;
+  state->model_generation++;
+}
+
+static void
+join_root (preload_exe_t *exe, preload_exe_t G_GNUC_UNUSED *p, GHashTable *parent)
+{
+  preload_cluster_join (exe, find (parent, exe));
+}
+
+static void
+follow_leader (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer G_GNUC_UNUSED data)
+{
+  /* members of a leader that joined another cluster follow it */
+  if (exe->cluster && exe->cluster->cluster)
+    exe->cluster = exe->cluster->cluster;
+}
+
+int
+preload_cluster_update (void)
+{
+  GHashTable *parent;
+  int joined;
+
+  if (conf->model.clustersim <= 0)
+    return 0;
+
+  parent = g_hash_table_new (NULL, NULL);
+  preload_markov_foreach ((GFunc)merge_similar, parent);
+  joined = g_hash_table_size (parent);
+  g_hash_table_foreach (parent, (GHFunc)join_root, parent);
+  g_hash_table_foreach (state->exes, (GHFunc)follow_leader, NULL);
+  g_hash_table_destroy (parent);
+
+  if (joined)
+    g_debug ("%d exes joined clusters", joined);
+  return joined;
+}
+
+
+static void
+new_markov (gpointer G_GNUC_UNUSED key, preload_exe_t *other, preload_exe_t *exe)
+{
+  if (other != exe && !other->cluster)
+    preload_markov_new (exe, other, TRUE);
+}
+
+void
+preload_cluster_leave (preload_exe_t *exe)
+{
+  g_return_if_fail (exe);
+
+  if (!exe->cluster)
+    return;
+
+  exe->cluster = NULL;
+  g_hash_table_foreach (state->exes, (GHFunc)new_markov, exe);
+  state->model_generation++;
+}
+
+
+void
+preload_cluster_exe_changed (preload_exe_t *exe)
+{
+  if (exe->cluster && exe_is_running (exe) && !exe_is_running (exe->cluster)) {
+    g_debug ("%s runs without %s, leaving its cluster", exe->path, exe->cluster->path);
+    preload_cluster_leave (exe);
+  }
+}
+
+
+static void
+share_prob (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer G_GNUC_UNUSED data)
+{
+  if (exe->cluster && !exe_is_running (exe))
+    exe->lnprob = exe->cluster->lnprob;
+}
+
+void
+preload_cluster_share_probs (void)
+{
+  g_hash_table_foreach (state->exes, (GHFunc)share_prob, NULL);
+}
+
+
+static void
+collect_members (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer data)
+{
+  struct { preload_exe_t *leader; GSList *members; } *ctx = data;
+
+  if (exe->cluster == ctx->leader)
+    ctx->members = g_slist_prepend (ctx->members, exe);
+}
+
+void
+preload_cluster_forget (preload_exe_t *exe)
+{
+  struct { preload_exe_t *leader; GSList *members; } ctx = { exe, NULL };
+  GSList *l;
+
+  g_hash_table_foreach (state->exes, (GHFunc)collect_members, &ctx);
+  for (l = ctx.members; l; l = l->next)
+    preload_cluster_leave (l->data);
+  g_slist_free (ctx.members);
+}
@@ -0,0 +1,36 @@
+/* cluster.h - Clusters of exes that run together
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <glib.h>
+
+/* Forward declarations */
+typedef struct _preload_exe_t preload_exe_t;
+
+/* merges exes that run together into clusters, dropping the chains of
+ * the members; returns how many exes joined one */
+int preload_cluster_update (void);
+
+/* makes member part of the cluster of leader, dropping its chains */
+void preload_cluster_join (preload_exe_t *member, preload_exe_t *leader);
+
+/* takes exe out of its cluster, with chains of its own again */
+void preload_cluster_leave (preload_exe_t *exe);
+
+/* exe changed running state; a member starting without its leader
+ * leaves the cluster */
+void preload_cluster_exe_changed (preload_exe_t *exe);
+
+/* members that are not running take the probability of their leader */
+void preload_cluster_share_probs (void);
+
+/* exe is going away: its members leave the cluster */
+void preload_cluster_forget (preload_exe_t *exe);
+
+#endif /* CLUSTER_H */
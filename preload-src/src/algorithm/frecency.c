@@ -0,0 +1,141 @@
+/* frecency.c - Frecency prediction engine
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "frecency.h"
+#include "conf.h"
+#include "exe.h"
+#include "state.h"
+
+#include <math.h>
+
+/*
+ * The cheapest engine: every exe keeps how often it started, with each
+ * start weighing less as it ages (halving every model.frecencyhalflife),
+ * and the same split by the local hour of day it started in.  That is a
+ * few dozen bytes per exe and a single pass per prediction, against the
+ * N² chains of Markov and the context trees of VOMM, and it is the floor
+ * the other engines should beat.
+ *
+ * Decayed starts over the mean age of a start give a rate, scaled by how
+ * much of the starts fall in this hour, and
+ *
+ *   P(X starts within a period) = 1 - exp(-rate * period)
+ *
+ * Starts are counted whatever the engine, so switching to it, or falling
+ * back to it, does not start from scratch.
+ */
+
+#define FRECENCY_HOUR_PRIOR 0.5	/* starts every hour is assumed to have */
+
+/* Access to global state */
+extern preload_state_t state[1];
+
+
+static double
+decay (int from, int to)
+{
+  if (conf->model.frecencyhalflife <= 0 || to <= from)
+    return 1;
+  return exp2 (-(double)(to - from) / conf->model.frecencyhalflife);
+}
+
+
+void
+preload_frecency_start (preload_exe_t *exe, int time, int hour)
+{
+  double factor;
+  int i;
+
+  g_return_if_fail (exe);
+
+  factor = decay (exe->frecency_time, time);
+  exe->frecency *= factor;
+  for (i = 0; i < 24; i++)
+    exe->frecency_hour[i] *= factor;
+  exe->frecency_time = MAX (exe->frecency_time, time);
+
+  exe->frecency += 1;
+  if (hour >= 0 && hour < 24)
+    exe->frecency_hour[hour] += 1;
+}
+
+
+double
+preload_frecency_score (const preload_exe_t *exe, int time)
+{
+  g_return_val_if_fail (exe, 0);
+
+  return exe->frecency * decay (exe->frecency_time, time);
+}
+
+
+double
+preload_frecency_prob (const preload_exe_t *exe, int time, int hour, int period)
+{
+  double score, window, rate;
+
+  g_return_val_if_fail (exe, 0);
+
+  score = preload_frecency_score (exe, time);
+  if (score <= 0 || period <= 0)
+    return 0;
+
+  /* what the starts were counted over: the mean age of a start once the
+   * model is older than that, the life of the model before */
+  window = MAX (time, period);
+  if (conf->model.frecencyhalflife > 0)
+    window = conf->model.frecencyhalflife / M_LN2 * -expm1 (-window * M_LN2 / conf->model.frecencyhalflife);
+  rate = score / MAX (window, period);
+
+  /* the share of starts in this hour, against an even spread */
+  if (conf->model.frecencyhourly && hour >= 0 && hour < 24)
+    rate *= 24 * (exe->frecency_hour[hour] + FRECENCY_HOUR_PRIOR)
+	    / (exe->frecency + 24 * FRECENCY_HOUR_PRIOR);
+
+  return -expm1 (-rate * period);
+}
+
+
+int
+preload_frecency_hour (void)
+{
+  time_t now = time (NULL);
+  struct tm tm;
+
+  if (!localtime_r (&now, &tm))
+    return -1;
+  return tm.tm_hour;
+}
+
+
+static void
+exe_bid (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, int *hour)
+{
+  double p;
+
+  if (exe_is_running (exe))
+    return;
+
+  p = preload_frecency_prob (exe, state->time, *hour, conf->model.cycle);
+  if (p > 0)
+    exe->lnprob += log1p (-MIN (p, 0.999));
+}
+
+
+void
+preload_frecency_predict (void)
+{
+  int hour = preload_frecency_hour ();
+
+  g_hash_table_foreach (state->exes, (GHFunc)exe_bid, &hour);
+}
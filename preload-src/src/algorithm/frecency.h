@@ -0,0 +1,32 @@
+/* frecency.h - Frecency prediction engine declarations
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#ifndef FRECENCY_H
+#define FRECENCY_H
+
+#include <glib.h>
+
+/* Forward declarations */
+typedef struct _preload_exe_t preload_exe_t;
+
+/* exe was seen starting at state time, in local hour of day hour */
+void preload_frecency_start (preload_exe_t *exe, int time, int hour);
+
+/* starts of exe, decayed to state time */
+double preload_frecency_score (const preload_exe_t *exe, int time);
+
+/* probability that exe starts within period seconds of state time, in
+ * local hour of day hour */
+double preload_frecency_prob (const preload_exe_t *exe, int time, int hour, int period);
+
+/* the local hour of day now */
+int preload_frecency_hour (void);
+
+/* bids in the exes that are not running */
+void preload_frecency_predict (void);
+
+#endif /* FRECENCY_H */
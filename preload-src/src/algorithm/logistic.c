@@ -0,0 +1,232 @@
+/* logistic.c - Online logistic prediction engine
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "logistic.h"
+#include "conf.h"
+#include "exe.h"
+#include "state.h"
+
+#include <math.h>
+
+/*
+ * Every exe learns its own logistic model of starting within the next
+ * cycle, over features of the moment, hashed into LOGISTIC_BUCKETS:
+ *
+ *   - the exes running, each weighing 1/sqrt(how many)
+ *   - the last LOGISTIC_RECENT exes started
+ *   - the hour of the week
+ *   - how long since the exe last ran, in doubling steps of cycles
+ *
+ * so memory grows with the number of exes and not with its square, and
+ * predicting costs a sparse dot product per exe.
+ *
+ * At every model update the exes that were not running at the last one
+ * are examples: seen running since, or not.  Their weights take one step of
+ * stochastic gradient descent on the log-loss, and the context of now is
+ * kept for the prediction, and the step, to come.
+ */
+
+#define LOGISTIC_RECENT 4	/* starts remembered as features */
+#define LOGISTIC_SINCE_MAX 15	/* doubling steps of cycles, and never */
+#define LOGISTIC_RATE 0.05	/* step of the descent */
+#define LOGISTIC_PRIOR -6.0	/* bias a new exe starts with, P about 0.25% */
+
+enum
+{
+  FEATURE_RUNNING = 1,
+  FEATURE_RECENT,
+  FEATURE_HOUR,
+  FEATURE_SINCE
+};
+
+typedef struct
+{
+  guint bucket;
+  float value;
+} feature_t;
+
+/* Access to global state */
+extern preload_state_t state[1];
+
+static GArray *context;		/* feature_t, shared by all exes */
+static int context_time;	/* state time it was taken at */
+static guint recent[LOGISTIC_RECENT];	/* path hashes, latest first */
+static int recent_len;
+
+
+static guint
+bucket (guint kind, guint value)
+{
+  guint h = (value ^ (kind * 0x9e3779b9u)) * 0x85ebca6bu;
+
+  h ^= h >> 13;
+  return h % LOGISTIC_BUCKETS;
+}
+
+static int
+since_bucket (int since)
+{
+  int cycles, steps = 0;
+
+  if (since < 0)
+    return LOGISTIC_SINCE_MAX + 1;
+  cycles = (state->time - since) / MAX (conf->model.cycle, 1);
+  while (cycles > 0 && steps < LOGISTIC_SINCE_MAX) {
+    cycles >>= 1;
+    steps++;
+  }
+  return steps;
+}
+
+static double
+dot (const preload_exe_t *exe, int since)
+{
+  double z = exe->logistic[LOGISTIC_BUCKETS];
+  guint i;
+
+  for (i = 0; i < context->len; i++) {
+    feature_t *f = &g_array_index (context, feature_t, i);
+    z += exe->logistic[f->bucket] * f->value;
+  }
+  return z + exe->logistic[bucket (FEATURE_SINCE, since)];
+}
+
+static void
+add_feature (guint kind, guint value, float weight)
+{
+  feature_t f = { bucket (kind, value), weight };
+  g_array_append_val (context, f);
+}
+
+
+void
+preload_logistic_start (preload_exe_t *exe)
+{
+  g_return_if_fail (exe);
+
+  memmove (recent + 1, recent, sizeof (recent) - sizeof (recent[0]));
+  recent[0] = g_str_hash (exe->path);
+  recent_len = MIN (recent_len + 1, LOGISTIC_RECENT);
+}
+
+
+static void
+exe_learn (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer G_GNUC_UNUSED data)
+{
+  gboolean started;
+  double step;
+  guint i;
+
+  if (exe->logistic_since < 0)
+    return;
+
+  if (!exe->logistic) {
+    exe->logistic = g_new0 (float, LOGISTIC_WEIGHTS);
+    exe->logistic[LOGISTIC_BUCKETS] = LOGISTIC_PRIOR;
+  }
+
+  /* d(log-loss)/dw = (p - y) x */
+  started = exe->running_timestamp > context_time;
+  step = LOGISTIC_RATE * ((started ? 1.0 : 0.0) - 1 / (1 + exp (-dot (exe, exe->logistic_since))));
+  for (i = 0; i < context->len; i++) {
+    feature_t *f = &g_array_index (context, feature_t, i);
+    exe->logistic[f->bucket] += step * f->value;
+  }
+  exe->logistic[bucket (FEATURE_SINCE, exe->logistic_since)] += step;
+  exe->logistic[LOGISTIC_BUCKETS] += step;
+}
+
+static void
+exe_snapshot (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer G_GNUC_UNUSED data)
+{
+  exe->logistic_since = exe_is_running (exe) ? -1 : since_bucket (exe->running_timestamp);
+}
+
+void
+preload_logistic_observe (void)
+{
+  GSList *l;
+  time_t now;
+  struct tm tm;
+  float weight;
+  int i;
+
+  if (context)
+    g_hash_table_foreach (state->exes, (GHFunc)exe_learn, NULL);
+  else
+    context = g_array_new (FALSE, FALSE, sizeof (feature_t));
+
+  g_array_set_size (context, 0);
+  context_time = state->time;
+  weight = 1 / sqrt (MAX (g_slist_length (state->running_exes), 1));
+  for (l = state->running_exes; l; l = l->next)
+    add_feature (FEATURE_RUNNING, g_str_hash (((preload_exe_t *)l->data)->path), weight);
+  for (i = 0; i < recent_len; i++)
+    add_feature (FEATURE_RECENT, recent[i], 1);
+  now = time (NULL);
+  if (localtime_r (&now, &tm))
+    add_feature (FEATURE_HOUR, tm.tm_wday * 24 + tm.tm_hour, 1);
+
+  g_hash_table_foreach (state->exes, (GHFunc)exe_snapshot, NULL);
+}
+
+
+double
+preload_logistic_prob (const preload_exe_t *exe)
+{
+  g_return_val_if_fail (exe, 0);
+
+  if (!context || !exe->logistic || exe->logistic_since < 0)
+    return 0;
+  return 1 / (1 + exp (-dot (exe, exe->logistic_since)));
+}
+
+double
+preload_logistic_resume_prob (const preload_exe_t *exe, int idle)
+{
+  g_return_val_if_fail (exe, 0);
+
+  if (!context || !exe->logistic)
+    return 0;
+  return 1 / (1 + exp (-dot (exe, since_bucket (idle))));
+}
+
+
+static void
+exe_bid (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer G_GNUC_UNUSED data)
+{
+  double p;
+
+  if (exe_is_running (exe))
+    return;
+
+  p = preload_logistic_prob (exe);
+  if (p > 0)
+    exe->lnprob += log1p (-MIN (p, 0.999));
+}
+
+void
+preload_logistic_predict (void)
+{
+  g_hash_table_foreach (state->exes, (GHFunc)exe_bid, NULL);
+}
+
+
+void
+preload_logistic_reset (void)
+{
+  if (context)
+    g_array_free (context, TRUE);
+  context = NULL;
+  recent_len = 0;
+}
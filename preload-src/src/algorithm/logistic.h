@@ -0,0 +1,40 @@
+/* logistic.h - Online logistic prediction engine declarations
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#ifndef LOGISTIC_H
+#define LOGISTIC_H
+
+#include <glib.h>
+
+/* hashed feature buckets per exe; its weights have one more, the bias */
+#define LOGISTIC_BUCKETS 128
+#define LOGISTIC_WEIGHTS (LOGISTIC_BUCKETS + 1)
+
+/* Forward declarations */
+typedef struct _preload_exe_t preload_exe_t;
+
+/* exe was seen starting */
+void preload_logistic_start (preload_exe_t *exe);
+
+/* learns from which exes started since the last call, then takes the
+ * context to predict, and learn, from next */
+void preload_logistic_observe (void);
+
+/* probability that exe starts within a cycle of the last context */
+double preload_logistic_prob (const preload_exe_t *exe);
+
+/* the same for exe running but idle since state time idle: what it would
+ * bid had it stopped then */
+double preload_logistic_resume_prob (const preload_exe_t *exe, int idle);
+
+/* bids in the exes that are not running */
+void preload_logistic_predict (void);
+
+/* forgets the context and recent starts */
+void preload_logistic_reset (void);
+
+#endif /* LOGISTIC_H */
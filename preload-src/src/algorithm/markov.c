@@ -25,6 +25,7 @@
 #include "markov.h"
 #include "exe.h"
 #include "state.h"
+#include "trace.h"
 
 #include <math.h>
 
@@ -82,27 +83,79 @@ preload_markov_new (preload_exe_t *a, preload_exe_t *b, gboolean initialize)
 }
 
 
-void
-preload_markov_state_changed (preload_markov_t *markov)
+int
+preload_markov_dwell_bucket (double length)
 {
-  int old_state, new_state;
+  int bucket = 0;
 
-  if (markov->change_timestamp == state->time)
-    return; /* already taken care of */
+  while (length >= MARKOV_DWELL_BASE && bucket < MARKOV_DWELL_BUCKETS - 1) {
+    length /= 2;
+    bucket++;
+  }
+  return bucket;
+}
 
-  old_state = markov->state;
-  new_state = markov_compute_state (markov);
+/* counts fit a byte; when one would not, the old ones weigh half */
+static void
+dwell_add (guint8 *dwell, int bucket)
+{
+  int i;
 
-  g_return_if_fail (old_state != new_state);
+  if (dwell[bucket] == MARKOV_DWELL_MAX)
+    for (i = 0; i < MARKOV_DWELL_BUCKETS; i++)
+      dwell[i] /= 2;
+  dwell[bucket]++;
+}
+
+
+static void
+markov_transition (preload_markov_t *markov, int new_state, int time)
+{
+  int old_state = markov->state;
+
+  PRELOAD_TRACE (markov_state, markov->a->path, markov->b->path, old_state, new_state);
 
   markov->weight[old_state][old_state]++;
-  markov->time_to_leave[old_state] += ((state->time - markov->change_timestamp)
+  markov->time_to_leave[old_state] += ((time - markov->change_timestamp)
 				       - markov->time_to_leave[old_state])
 				      / markov->weight[old_state][old_state];
 
+  dwell_add (markov->dwell[old_state],
+	     preload_markov_dwell_bucket (time - markov->change_timestamp));
+
   markov->weight[old_state][new_state]++;
   markov->state = new_state;
-  markov->change_timestamp = state->time;
+  markov->change_timestamp = time;
+}
+
+
+void
+preload_markov_state_changed (preload_markov_t *markov)
+{
+  int new_state;
+
+  if (markov->change_timestamp == state->time)
+    return; /* already taken care of */
+
+  new_state = markov_compute_state (markov);
+
+  g_return_if_fail (markov->state != new_state);
+
+  markov_transition (markov, new_state, state->time);
+}
+
+
+/* same, for a change noticed between scans at the given time.  both exes
+ * may change in the same instant, so go by the state, not the time. */
+void
+preload_markov_state_changed_at (preload_markov_t *markov, int time)
+{
+  int new_state = markov_compute_state (markov);
+
+  if (markov->state == new_state)
+    return; /* already taken care of */
+
+  markov_transition (markov, new_state, MAX (time, markov->change_timestamp));
 }
 
 
@@ -111,6 +164,8 @@ preload_markov_free (preload_markov_t *markov, preload_exe_t *from)
 {
   g_return_if_fail (markov);
 
+  state->free_generation++;
+
   if (from) {
     preload_exe_t *other;
     g_assert (markov->a == from || markov->b == from);
@@ -186,6 +241,72 @@ preload_markov_correlation (preload_markov_t *markov)
 }
 
 
+/* the share of the stays in a state recorded in dwell that lasted at
+ * least length, taking stays as spread evenly over their bucket */
+static double
+dwell_survival (const guint8 *dwell, double length, int total)
+{
+  double lo = 0, hi = MARKOV_DWELL_BASE, longer = 0;
+  int i;
+
+  for (i = 0; i < MARKOV_DWELL_BUCKETS; i++, lo = hi, hi *= 2) {
+    if (length <= lo)
+      longer += dwell[i];
+    else if (length < hi)
+      longer += dwell[i] * (hi - length) / (hi - lo);
+  }
+  return longer / total;
+}
+
+/* the probability of the chain leaving state within period seconds,
+ * having been in it for spent seconds.
+ *
+ * a state lasts as long as it lasted before: from the dwell times
+ * recorded,
+ *
+ *   p(leave before spent + period | lasted spent) =
+ *     (S(spent) - S(spent + period)) / S(spent)
+ *
+ * where S(x) is the share of stays that lasted x or more.  that tells a
+ * quick tool run from an all-day session, which a mean cannot.  with
+ * few stays recorded, or none as long as this one, it leans on the
+ * exponential dwell of mean time_to_leave instead:
+ *
+ *                                              -period/time_to_leave
+ *   p(leave before period) = 1 - e
+ */
+#define MARKOV_DWELL_PRIOR 4	/* stays the exponential counts as */
+
+double
+preload_markov_leave_prob (const preload_markov_t *markov, int state,
+			   double spent, double period)
+{
+  double p_exp, p_hist, lasted, w;
+  int i, total = 0;
+
+  g_return_val_if_fail (markov, 0);
+  g_return_val_if_fail (state >= 0 && state < 4, 0);
+
+  if (!(markov->time_to_leave[state] > 0))
+    return 0;
+  p_exp = -expm1 (-period / markov->time_to_leave[state]);
+
+  for (i = 0; i < MARKOV_DWELL_BUCKETS; i++)
+    total += markov->dwell[state][i];
+  if (!total)
+    return p_exp;
+
+  spent = MAX (spent, 0);
+  lasted = dwell_survival (markov->dwell[state], spent, total);
+  if (lasted <= 0)
+    return p_exp;
+  p_hist = 1 - dwell_survival (markov->dwell[state], spent + period, total) / lasted;
+
+  w = total / (total + (double)MARKOV_DWELL_PRIOR);
+  return w * p_hist + (1 - w) * p_exp;
+}
+
+
 /* Markov foreach iteration context */
 typedef struct _markov_foreach_context_t
 {
@@ -217,3 +338,58 @@ preload_markov_foreach (GFunc func, gpointer user_data)
   ctx.data = user_data;
   g_hash_table_foreach (state->exes, (GHFunc)exe_markov_foreach, &ctx);
 }
+
+
+typedef struct
+{
+  preload_exe_t *exe;
+  GHashTable *partners;
+  int created;
+} markov_complete_context_t;
+
+static void
+pair_complete (gpointer G_GNUC_UNUSED key, preload_exe_t *other, markov_complete_context_t *ctx)
+{
+  /* each pair once, from the exe registered first */
+  if (other->seq <= ctx->exe->seq || other->cluster
+      || g_hash_table_lookup (ctx->partners, other))
+    return;
+
+  preload_markov_new (ctx->exe, other, TRUE);
+  ctx->created++;
+}
+
+static void
+exe_complete (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, markov_complete_context_t *ctx)
+{
+  guint i;
+
+  /* members of a cluster have no chains, their leader's stand for them */
+  if (exe->cluster)
+    return;
+
+  ctx->exe = exe;
+  ctx->partners = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (i = 0; i < exe->markovs->len; i++)
+    g_hash_table_insert (ctx->partners,
+			 markov_other_exe ((preload_markov_t *)g_ptr_array_index (exe->markovs, i), exe),
+			 GINT_TO_POINTER (1));
+  g_hash_table_foreach (state->exes, (GHFunc)pair_complete, ctx);
+  g_hash_table_destroy (ctx->partners);
+}
+
+void
+preload_markov_complete (void)
+{
+  markov_complete_context_t ctx = { NULL, NULL, 0 };
+
+  if (!state->chainless)
+    return;
+  state->chainless = FALSE;
+
+  g_hash_table_foreach (state->exes, (GHFunc)exe_complete, &ctx);
+  if (ctx.created) {
+    g_debug ("%d chains created for exes registered without them", ctx.created);
+    state->model_generation++;
+  }
+}
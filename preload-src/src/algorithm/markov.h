@@ -15,6 +15,12 @@
 typedef struct _preload_exe_t preload_exe_t;
 typedef struct _preload_state_t preload_state_t;
 
+/* times spent in a state before leaving it, in buckets doubling from
+ * MARKOV_DWELL_BASE seconds; the last bucket is open-ended */
+#define MARKOV_DWELL_BUCKETS 16
+#define MARKOV_DWELL_BASE 8
+#define MARKOV_DWELL_MAX 255	/* counts are bytes */
+
 /* preload_markov_t: a 4-state continuous-time Markov chain. */
 typedef struct _preload_markov_t
 {
@@ -24,6 +30,8 @@ typedef struct _preload_markov_t
   int weight[4][4]; /* number of times we've gone from state i to state j.
 		     * weight[i][i] is the number of times we have left
 		     * state i. (sum over weight[i][j] for j<>i essentially. */
+  guint8 dwell[4][MARKOV_DWELL_BUCKETS]; /* how long state i lasted, counts
+					   * halved when one would overflow. */
 
   /* runtime: */
   /* state 0: no-a, no-b,
@@ -42,8 +50,15 @@ typedef struct _preload_markov_t
 preload_markov_t * preload_markov_new (preload_exe_t *a, preload_exe_t *b, gboolean initialize);
 void preload_markov_free (preload_markov_t *markov, preload_exe_t *from);
 void preload_markov_state_changed (preload_markov_t *markov);
+void preload_markov_state_changed_at (preload_markov_t *markov, int time);
 double preload_markov_correlation (preload_markov_t *markov);
+int preload_markov_dwell_bucket (double length);
+double preload_markov_leave_prob (const preload_markov_t *markov, int state,
+				  double spent, double period);
 void preload_markov_foreach (GFunc func, gpointer user_data);
+/* gives every pair of exes outside clusters the chain it lacks, once exes
+ * were registered without them */
+void preload_markov_complete (void);
 
 /* Helper to compute current markov state based on running status */
 int markov_compute_state(preload_markov_t *markov);
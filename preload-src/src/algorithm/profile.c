@@ -0,0 +1,318 @@
+/* profile.c - Workload profiles from the set of running exes
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "profile.h"
+#include "conf.h"
+#include "exe.h"
+#include "state.h"
+#include "prophet.h"
+
+#include <math.h>
+
+/*
+ * A machine used for distinct things in turn (development, calls, games,
+ * builds) runs a different set of exes for each, and one model blended
+ * over all of them predicts badly when the user moves from one to the
+ * next.  So the running set is matched, every model update, against up
+ * to model.maxprofiles profiles: the centroids of the running sets seen
+ * while each was active, the share of its cycles each exe was running
+ * in.  The nearest by cosine similarity is the one in use, or a new one
+ * if none reaches model.profilesim and there is room.  Another profile
+ * takes over only once it has matched best for a few updates in a row,
+ * so a passing app does not flip it.
+ *
+ * The active profile is an overlay on the engine, not a replacement:
+ * after the engine has bid, the exes its profile most often runs bid in
+ * again by their share.  On a switch those are read ahead right away,
+ * without waiting for the next prediction.
+ */
+
+#define PROFILE_SWITCH 2	/* updates another profile must match best in a row */
+#define PROFILE_MEMORY 360	/* updates the weights average over, at most */
+#define PROFILE_MIN_WEIGHT 0.01	/* below which an exe not running is dropped */
+#define PROFILE_TOP 16	/* exes a profile bids for and reads ahead */
+#define PROFILE_BID 0.5	/* of its weight, the probability an exe bids */
+
+/* Access to global state */
+extern preload_state_t state[1];
+
+static GPtrArray *profiles;
+static preload_profile_t *active;
+static preload_profile_t *candidate; /* NULL for a new one, when streak */
+static int streak; /* updates candidate matched best in a row */
+
+
+static void
+profile_free (preload_profile_t *profile)
+{
+  g_hash_table_destroy (profile->weights);
+  if (profile->top)
+    g_ptr_array_free (profile->top, TRUE);
+  g_free (profile);
+}
+
+GPtrArray *
+preload_profiles (void)
+{
+  if (!profiles)
+    profiles = g_ptr_array_new_with_free_func ((GDestroyNotify)profile_free);
+  return profiles;
+}
+
+preload_profile_t *
+preload_profile_new (int cycles)
+{
+  preload_profile_t *profile = g_new0 (preload_profile_t, 1);
+
+  profile->id = preload_profiles ()->len;
+  profile->cycles = cycles;
+  profile->weights = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  g_ptr_array_add (profiles, profile);
+  return profile;
+}
+
+preload_profile_t *
+preload_profile_active (void)
+{
+  return active;
+}
+
+
+static void
+profile_changed (preload_profile_t *profile)
+{
+  GHashTableIter iter;
+  gpointer value;
+  double sum = 0;
+
+  g_hash_table_iter_init (&iter, profile->weights);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    sum += *(gfloat *)value * *(gfloat *)value;
+  profile->norm = sqrt (sum);
+
+  if (profile->top)
+    g_ptr_array_free (profile->top, TRUE);
+  profile->top = NULL;
+}
+
+void
+preload_profile_set (preload_profile_t *profile, preload_exe_t *exe, double weight)
+{
+  gfloat *w;
+
+  g_return_if_fail (profile && exe);
+
+  w = g_new (gfloat, 1);
+  *w = weight;
+  g_hash_table_insert (profile->weights, exe, w);
+  profile_changed (profile);
+}
+
+static double
+weight_of (preload_profile_t *profile, preload_exe_t *exe)
+{
+  gfloat *w = g_hash_table_lookup (profile->weights, exe);
+
+  return w ? *w : 0;
+}
+
+
+typedef struct
+{
+  preload_exe_t *exe;
+  double weight;
+} weighted_exe_t;
+
+static int
+weighted_exe_compare (const weighted_exe_t *a, const weighted_exe_t *b)
+{
+  if (a->weight != b->weight)
+    return a->weight < b->weight ? 1 : -1;
+  return (a->exe->seq > b->exe->seq) - (a->exe->seq < b->exe->seq);
+}
+
+/* the exes of profile most often running, kept until it changes */
+static GPtrArray *
+top_exes (preload_profile_t *profile)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GArray *all;
+  guint i;
+
+  if (profile->top)
+    return profile->top;
+
+  all = g_array_new (FALSE, FALSE, sizeof (weighted_exe_t));
+  g_hash_table_iter_init (&iter, profile->weights);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    weighted_exe_t we = { key, *(gfloat *)value };
+    g_array_append_val (all, we);
+  }
+  g_array_sort (all, (GCompareFunc)weighted_exe_compare);
+
+  profile->top = g_ptr_array_new ();
+  for (i = 0; i < all->len && i < PROFILE_TOP; i++)
+    g_ptr_array_add (profile->top, g_array_index (all, weighted_exe_t, i).exe);
+  g_array_free (all, TRUE);
+
+  return profile->top;
+}
+
+
+/* cosine similarity of the running set with the centroid of profile */
+static double
+similarity (preload_profile_t *profile, GSList *running, int count)
+{
+  double dot = 0;
+  GSList *l;
+
+  if (profile->norm <= 0 || !count)
+    return 0;
+
+  for (l = running; l; l = l->next)
+    dot += weight_of (profile, l->data);
+  return dot / (profile->norm * sqrt (count));
+}
+
+/* moves the centroid of profile toward the running set */
+static void
+learn (preload_profile_t *profile, GSList *running)
+{
+  GHashTable *is_running = g_hash_table_new (NULL, NULL);
+  GHashTableIter iter;
+  gpointer key, value;
+  double rate;
+  GSList *l;
+
+  profile->cycles++;
+  rate = 1.0 / MIN (profile->cycles, PROFILE_MEMORY);
+
+  for (l = running; l; l = l->next) {
+    g_hash_table_add (is_running, l->data);
+    if (!g_hash_table_lookup (profile->weights, l->data))
+      g_hash_table_insert (profile->weights, l->data, g_new0 (gfloat, 1));
+  }
+
+  g_hash_table_iter_init (&iter, profile->weights);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    gfloat *w = value;
+    gboolean ran = g_hash_table_contains (is_running, key);
+
+    *w += rate * ((ran ? 1 : 0) - *w);
+    if (!ran && *w < PROFILE_MIN_WEIGHT)
+      g_hash_table_iter_remove (&iter);
+  }
+
+  g_hash_table_destroy (is_running);
+  profile_changed (profile);
+}
+
+static void
+switch_to (preload_profile_t *profile)
+{
+  g_debug ("workload profile %d active, was %d", profile->id, active ? active->id : -1);
+  active = profile;
+
+  /* a new one has nothing to read ahead yet */
+  if (profile->cycles)
+    preload_prophet_profile_switched (top_exes (profile));
+}
+
+void
+preload_profile_update (void)
+{
+  preload_profile_t *best = NULL, *want;
+  double sim, bestsim = 0;
+  GSList *running = state->running_exes;
+  int count = g_slist_length (running);
+  guint i;
+
+  if (conf->model.maxprofiles <= 0 || !count)
+    return;
+
+  for (i = 0; i < preload_profiles ()->len; i++) {
+    preload_profile_t *profile = g_ptr_array_index (profiles, i);
+
+    sim = similarity (profile, running, count);
+    if (!best || sim > bestsim) {
+      best = profile;
+      bestsim = sim;
+    }
+  }
+
+  /* none close enough: a new one, while there is room */
+  want = best;
+  if ((!best || bestsim * 100 < conf->model.profilesim)
+      && (int)profiles->len < conf->model.maxprofiles)
+    want = NULL;
+
+  if (active && want == active)
+    streak = 0;
+  else if (streak && want == candidate)
+    streak++;
+  else {
+    candidate = want;
+    streak = 1;
+  }
+
+  if (!active || streak >= PROFILE_SWITCH) {
+    switch_to (want ? want : preload_profile_new (0));
+    streak = 0;
+  }
+
+  learn (active, running);
+}
+
+
+void
+preload_profile_bid (void)
+{
+  GPtrArray *top;
+  guint i;
+
+  if (!active || conf->model.maxprofiles <= 0)
+    return;
+
+  top = top_exes (active);
+  for (i = 0; i < top->len; i++) {
+    preload_exe_t *exe = g_ptr_array_index (top, i);
+
+    if (!exe_is_running (exe))
+      exe->lnprob += log1p (-PROFILE_BID * weight_of (active, exe));
+  }
+}
+
+
+void
+preload_profile_forget (preload_exe_t *exe)
+{
+  guint i;
+
+  for (i = 0; profiles && i < profiles->len; i++) {
+    preload_profile_t *profile = g_ptr_array_index (profiles, i);
+
+    if (g_hash_table_remove (profile->weights, exe))
+      profile_changed (profile);
+  }
+}
+
+void
+preload_profile_free (void)
+{
+  if (profiles)
+    g_ptr_array_free (profiles, TRUE);
+  profiles = NULL;
+  active = candidate = NULL;
+  streak = 0;
+}
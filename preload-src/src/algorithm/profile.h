@@ -0,0 +1,53 @@
+/* profile.h - Workload profiles from the set of running exes
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <glib.h>
+
+/* Forward declarations */
+typedef struct _preload_exe_t preload_exe_t;
+
+/* preload_profile_t: a workload the machine is used for, as the share of
+ * the cycles it was active in that each exe was running in. */
+typedef struct _preload_profile_t
+{
+  int id; /* its index in preload_profiles (). */
+  int cycles; /* model updates it was active for. */
+  GHashTable *weights; /* exe -> gfloat *, share of those it was running in. */
+  double norm; /* euclidean norm of the weights. */
+  GPtrArray *top; /* its exes most often running, most first, or NULL if stale. */
+} preload_profile_t;
+
+/* matches the running exes against the profiles, switching to another
+ * one, or a new one, when they have kept matching it better.  the active
+ * profile then learns from them.  run once per model update. */
+void preload_profile_update (void);
+
+/* exes of the active profile that are not running bid in, over what the
+ * engine made of them */
+void preload_profile_bid (void);
+
+/* the active profile, or NULL */
+preload_profile_t * preload_profile_active (void);
+
+/* all profiles, by id */
+GPtrArray * preload_profiles (void);
+
+/* a new profile, active for cycles before */
+preload_profile_t * preload_profile_new (int cycles);
+
+/* sets the weight of exe in profile */
+void preload_profile_set (preload_profile_t *profile, preload_exe_t *exe, double weight);
+
+/* exe is going away */
+void preload_profile_forget (preload_exe_t *exe);
+
+void preload_profile_free (void);
+
+#endif /* PROFILE_H */
@@ -27,12 +27,40 @@
 #include "state.h"
 #include "readahead.h"
 #include "vomm.h"
+#include "frecency.h"
+#include "logistic.h"
 #include "exe.h"
 #include "markov.h"
+#include "spawn.h"
+#include "cluster.h"
+#include "profile.h"
+#include "madvise_utils.h"
+#include "stats.h"
+#include "trace.h"
+#include "timeline.h"
 
 #include <math.h>
 
 
+static preload_prophet_stats_t stats;
+
+/*
+ * Maps that most exes use (libc, ld.so, toolkit libraries) would get a
+ * bid from nearly every exe and top the ranking every cycle, though they
+ * are nearly always cached anyway.  Maps used by more than model.baseline
+ * percent of the exes are the baseline instead: they take no bids, and
+ * whatever of them is found not cached is read ahead first, ahead of the
+ * ranked maps.  Not below BASELINE_MIN_EXES exes, where any map shared by
+ * two would qualify.
+ */
+
+#define BASELINE_MIN_EXES 8
+
+static GPtrArray *baseline;
+static guint baseline_generation;
+static int baseline_share; /* model.baseline it was taken with */
+
+
 /* Computes the P(Y runs in next period | current state)
  * and bids in for the Y. Y should not be running.
  *
@@ -56,34 +84,31 @@ markov_bid_for_exe (preload_markov_t *markov,
 		    int ystate,
 		    double correlation)
 {
-  int state;
+  int markov_state;
   double p_state_change;
   double p_y_runs_next;
   double p_runs;
 
-  state = markov->state;
+  markov_state = markov->state;
 
-  if (!markov->weight[state][state] || !(markov->time_to_leave[state] > 1))
+  if (!markov->weight[markov_state][markov_state] || !(markov->time_to_leave[markov_state] > 1))
     return;
 
   /* p_state_change is the probability of the state of markov changing
-   * in the next period.  period is taken as 1.5 cycles.  it's computed
-   * as:
-   *                                            -λ.period
-   *   p(state changes in time < period) = 1 - e
-   *
-   * where λ is one over average time to leave the state.
+   * in the next period, given how long it has been in it.  period is
+   * taken as 1.5 cycles.  see preload_markov_leave_prob.
    */
-  p_state_change = -conf->model.cycle * 1.5 / markov->time_to_leave[state];
-  p_state_change = 1 - exp (p_state_change);
+  p_state_change = preload_markov_leave_prob (markov, markov_state,
+					      (double)(state->time - markov->change_timestamp),
+					      conf->model.cycle * 1.5);
 
   /* p_y_runs_next is the probability that X runs, given that a state
    * change occurs. it's computed linearly based on the number of times
    * transition has occured from this state to other states.
    */
   /* regularize a bit by adding something to denominator */
-  p_y_runs_next = markov->weight[state][ystate] + markov->weight[state][3];
-  p_y_runs_next /= markov->weight[state][state] + 0.01;
+  p_y_runs_next = markov->weight[markov_state][ystate] + markov->weight[markov_state][3];
+  p_y_runs_next /= markov->weight[markov_state][markov_state] + 0.01;
 
 
   /* FIXME: what should we do we correlation w.r.t. state? */
@@ -129,6 +154,36 @@ map_prob_compare (const preload_map_t **pa, const preload_map_t **pb)
 }
 
 
+static void
+update_baseline (void)
+{
+  guint exes = g_hash_table_size (state->exes);
+  guint i;
+
+  if (baseline && baseline_generation == state->model_generation
+      && baseline_share == conf->model.baseline)
+    return;
+
+  if (!baseline)
+    baseline = g_ptr_array_new ();
+  g_ptr_array_set_size (baseline, 0);
+  baseline_generation = state->model_generation;
+  baseline_share = conf->model.baseline;
+
+  for (i = 0; i < state->maps_arr->len; i++) {
+    preload_map_t *map = g_ptr_array_index (state->maps_arr, i);
+
+    /* a map is referenced once by each exe using it */
+    map->baseline = conf->model.baseline > 0 && exes >= BASELINE_MIN_EXES
+		    && map->refcount * 100 > (int)exes * conf->model.baseline;
+    if (map->baseline)
+      g_ptr_array_add (baseline, map);
+  }
+
+  g_debug ("%u maps used by over %d%% of %u exes", baseline->len, conf->model.baseline, exes);
+}
+
+
 static void
 exe_zero_prob (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer G_GNUC_UNUSED data)
 {
@@ -143,12 +198,13 @@ exe_zero_prob (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, gpointer G_GNUC_U
  *
  *   P(M=1) = 1 - P(M=0)
  *   P(M=0) = Π P(M=0|Xi)
- *   P(M=0|Xi) = P(Xi=0)
+ *   P(M=0|Xi) = 1 - P(Xi=1) * P(Xi maps M)
  *
- * So:
+ * where P(Xi maps M) is exemap->prob.  So:
  * 
- *   lnprob(M) = log(P(M=0)) = Σ log(P(M=0|Xi)) = Σ log(P(Xi=0)) = Σ lnprob(Xi)
+ *   lnprob(M) = Σ log(1 - (1 - exp(lnprob(Xi))) * prob)
  *
+ * which is Σ lnprob(Xi) for maps always mapped.
  */
 static void
 exemap_bid_in_maps (gpointer key, gpointer user_data)
@@ -157,13 +213,17 @@ exemap_bid_in_maps (gpointer key, gpointer user_data)
   struct { gpointer data; preload_exe_t *exe; } *ctx = user_data;
   preload_exe_t *exe = ctx->exe;
 
+  if (exemap->map->baseline)
+    return;
+
   if (exe_is_running (exe)) {
     /* if exe is running, we vote against the map,
      * since it's most prolly in the memory already. */
-    /* FIXME: use exemap->prob, needs some theory work. */
     exemap->map->lnprob += 1;
-  } else {
+  } else if (exemap->prob >= 1) {
     exemap->map->lnprob += exe->lnprob;
+  } else {
+    exemap->map->lnprob += log1p (expm1 (exe->lnprob) * exemap->prob);
   }
 }
 
@@ -196,17 +256,20 @@ map_prob_print (preload_map_t *map)
 #define max(a,b) ((a)>(b) ? (a) : (b))
 #define kb(v) ((int)(((v) + 1023) / 1024))
 
+/* maps at least this likely to be needed are the ones worth making room for */
+#define LIKELY_LNPROB (-0.6931471805599453) /* log (0.5) */
+
 /* input is the list of maps sorted on the need.
- * decide a cutoff based on memory conditions and readhead. */
-void
+ * decide a cutoff based on memory conditions and readhead.
+ * returns kilobytes of likely maps that did not fit. */
+int
 preload_prophet_readahead (GPtrArray *maps_arr)
 {
-  int i;
+  int i, j, uncached, shortfall = 0;
   int memavail, memavailtotal; /* in kilobytes */
-  preload_memory_t memstat;
+  const preload_memory_t *memstat = &state->memstat; /* this tick's */
   preload_map_t *map;
-
-  proc_get_memstat (&memstat);
+  GPtrArray *files;
 
   /*
    * Calculate memory available for prefetching.
@@ -224,31 +287,41 @@ preload_prophet_readahead (GPtrArray *maps_arr)
    *   Can contain dirty pages that need writeback first.
    *   We use the configured percentage.
    */
-  if (memstat.available > 0) {
+  if (memstat->available > 0) {
     /* Linux 3.14+ provides accurate available memory estimate */
-    memavail = memstat.available;
+    memavail = memstat->available;
     
     /* Apply configured percentage (can be negative to reserve memory) */
-    memavail = clamp_percent(conf->model.memtotal) * (memstat.total / 100)
+    memavail = clamp_percent(conf->model.memtotal) * (memstat->total / 100)
              + clamp_percent(conf->model.memfree)  * (memavail / 100);
   } else {
     /* Fallback for older kernels */
-    memavail  = clamp_percent(conf->model.memtotal)  * (memstat.total  / 100)
-              + clamp_percent(conf->model.memfree)   * (memstat.free   / 100);
+    memavail  = clamp_percent(conf->model.memtotal)  * (memstat->total  / 100)
+              + clamp_percent(conf->model.memfree)   * (memstat->free   / 100);
   }
   
   memavail  = max (0, memavail);
   
   /* Add configured portion of cached memory */
-  memavail += clamp_percent(conf->model.memcached) * (memstat.cached / 100);
+  memavail += clamp_percent(conf->model.memcached) * (memstat->cached / 100);
   
   /* Add configured portion of buffers memory */
-  memavail += clamp_percent(conf->model.membuffers) * (memstat.buffers / 100);
+  memavail += clamp_percent(conf->model.membuffers) * (memstat->buffers / 100);
 
   memavailtotal = memavail;
 
-  memcpy (&(state->memstat), &memstat, sizeof (memstat));
-  state->memstat_timestamp = state->time;
+  /* the baseline first, what of it dropped out of the cache */
+  files = g_ptr_array_new ();
+  uncached = baseline ? preload_readahead_uncached ((preload_map_t **)baseline->pdata, baseline->len) : 0;
+  for (j = 0; j < uncached; j++) {
+    map = g_ptr_array_index (baseline, j);
+    if (kb (map->length) <= memavail) {
+      memavail -= kb (map->length);
+      g_ptr_array_add (files, map);
+    }
+  }
+  if (uncached)
+    g_debug ("%d baseline maps not cached", uncached);
 
   i = 0;
   while (i < (int)(maps_arr->len) &&
@@ -265,61 +338,721 @@ preload_prophet_readahead (GPtrArray *maps_arr)
   g_debug ("%dkb available for preloading, using %dkb of it",
 	   memavailtotal, memavailtotal - memavail);
 
-  if (i) {
-    i = preload_readahead ((preload_map_t **)maps_arr->pdata, i);
+  stats.readahead_budget = memavailtotal;
+  stats.readahead_used = memavailtotal - memavail;
+  stats.prefetched_kb += memavailtotal - memavail;
+
+  for (j = 0; j < i; j++) {
+    map = g_ptr_array_index (maps_arr, j);
+    map->prefetched = TRUE;
+    g_ptr_array_add (files, map);
+  }
+
+  for (j = i; j < (int)(maps_arr->len); j++) {
+    map = g_ptr_array_index (maps_arr, j);
+    if (map->prefetched) {
+      /* dropped out of the prediction before anything used it */
+      map->prefetched = FALSE;
+      stats.wastes++;
+      stats.waste_kb += kb (map->length);
+    }
+    if (map->lnprob <= LIKELY_LNPROB)
+      shortfall += kb (map->length);
+  }
+
+  if (files->len) {
+    i = preload_readahead ((preload_map_t **)files->pdata, files->len);
     g_debug ("readahead %d files", i);
   } else {
     g_debug ("nothing to readahead");
   }
+
+  g_ptr_array_free (files, TRUE);
+  return shortfall;
+}
+
+
+static int
+exe_prob_compare (const preload_exe_t **pa, const preload_exe_t **pb)
+{
+  const preload_exe_t *a = *pa, *b = *pb;
+  return a->lnprob < b->lnprob ? -1 : a->lnprob > b->lnprob ? 1 : 0;
+}
+
+static void
+exe_collect_predicted (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, GPtrArray *exes)
+{
+  if (!exe_is_running (exe) && exe->lnprob < 0)
+    g_ptr_array_add (exes, exe);
+}
+
+/* Launching an app looks up far more files than it reads: libraries,
+ * locales, icons.  So before data readahead, the paths of exes that are
+ * likely enough to start, a lower bar than the one for data, are looked
+ * up to warm the dentry and inode caches. */
+static void
+warm_metadata (void)
+{
+  GPtrArray *exes, *paths;
+  GHashTable *seen;
+  double maxlnprob;
+  guint i, j;
+
+  if (conf->system.metabudget <= 0)
+    return;
+
+  /* P(needed) >= metaprob  <=>  lnprob <= log (1 - metaprob) */
+  maxlnprob = log (1 - clamp_percent (conf->model.metaprob) / 100.0);
+
+  exes = g_ptr_array_new ();
+  g_hash_table_foreach (state->exes, (GHFunc)exe_collect_predicted, exes);
+  g_ptr_array_sort (exes, (GCompareFunc)exe_prob_compare);
+
+  paths = g_ptr_array_new ();
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < exes->len && (int)paths->len < conf->system.metabudget; i++) {
+    preload_exe_t *exe = g_ptr_array_index (exes, i);
+
+    if (exe->lnprob > maxlnprob)
+      break;
+
+    if (g_hash_table_add (seen, exe->path))
+      g_ptr_array_add (paths, exe->path);
+    for (j = 0; j < exe->exemaps->len; j++) {
+      preload_exemap_t *exemap = g_ptr_array_index (exe->exemaps, j);
+      if (g_hash_table_add (seen, exemap->map->path))
+	g_ptr_array_add (paths, exemap->map->path);
+    }
+  }
+
+  preload_readahead_metadata (paths);
+
+  g_hash_table_destroy (seen);
+  g_ptr_array_free (paths, TRUE);
+  g_ptr_array_free (exes, TRUE);
+}
+
+
+/* Running exes are left out of the bids above, as their maps are most
+ * prolly in memory already.  But an app left idle for long may have had
+ * its memory swapped out, and turning back to it then stalls.  So we
+ * score how likely each running exe is to become active again, and page
+ * its evicted ranges back in, within a budget of its own.
+ *
+ * The other way around, when likely maps did not fit in memory, the
+ * apps least likely to become active and idle for long have their
+ * memory aged out, so the next rounds find room.
+ */
+typedef struct
+{
+  preload_exe_t *exe;
+  double prob;
+} advise_candidate_t;
+
+static gboolean swapin_unsupported = FALSE;
+static gboolean cold_unsupported = FALSE;
+
+/* Computes the P(Y becomes active again | current state) for a running Y,
+ * from its chains with exes that are not running:  an exe correlated to Y
+ * starting means the task Y belongs to is being picked up again.
+ *
+ *   P(Y=0) = Π (1 - P(X starts) * corr(Y,X))
+ *
+ * where P(X starts) is what the exes bid in above.
+ */
+static double
+markov_reactivation_prob (preload_exe_t *exe)
+{
+  double lnprob = 0;
+  guint i;
+
+  for (i = 0; i < exe->markovs->len; i++) {
+    preload_markov_t *markov = g_ptr_array_index (exe->markovs, i);
+    preload_exe_t *other = markov->a == exe ? markov->b : markov->a;
+    double correlation, p;
+
+    if (exe_is_running (other))
+      continue;
+
+    correlation = conf->model.usecorrelation ? fabs (preload_markov_correlation (markov)) : 1.0;
+    p = (1 - exp (other->lnprob)) * correlation;
+    lnprob += log (1 - MIN (p, 0.999));
+  }
+
+  return 1 - exp (lnprob);
+}
+
+static double
+reactivation_prob (preload_exe_t *exe)
+{
+  switch (preload_algorithm ()) {
+  case ALGORITHM_VOMM:
+    return vomm_transition_prob (exe);
+  case ALGORITHM_FRECENCY:
+    /* how often it starts, as the odds of it being used again */
+    return preload_frecency_prob (exe, state->time, preload_frecency_hour (),
+				  conf->model.cycle);
+  case ALGORITHM_LOGISTIC:
+    /* as if it stopped when it went idle */
+    return preload_logistic_resume_prob (exe, exe->idle_timestamp ? exe->idle_timestamp
+							   : state->time);
+  default:
+    return markov_reactivation_prob (exe);
+  }
+}
+
+static int
+candidate_prob_compare (const advise_candidate_t *a, const advise_candidate_t *b)
+{
+  return a->prob < b->prob ? -1 : a->prob > b->prob ? 1 : 0;
+}
+
+static int
+candidate_prob_compare_desc (const advise_candidate_t *a, const advise_candidate_t *b)
+{
+  return candidate_prob_compare (b, a);
+}
+
+/* applies advice to the ranges of exe picked by get_ranges, as far as they
+ * fit in budget.  returns kilobytes covered. */
+static int
+advise_exe (preload_exe_t *exe, int (*get_ranges) (pid_t, GArray *),
+	    int advice, const char *what, int budget, gboolean *unsupported)
+{
+  GArray *ranges;
+  struct iovec *iov;
+  int pidfd, kb = 0;
+  guint i, n = 0;
+
+  /* take the pidfd first, so the ranges read belong to the same process */
+  pidfd = preload_pidfd_open (exe->pid);
+  if (pidfd < 0) {
+    if (errno == ENOSYS) {
+      g_message ("pidfd_open not supported, disabling %s", what);
+      *unsupported = TRUE;
+    }
+    return 0;
+  }
+
+  /* and check, once the ranges are read, that the pid was not recycled
+   * since the scan: then neither the pidfd nor the ranges are of exe */
+  ranges = g_array_new (FALSE, FALSE, sizeof (preload_range_t));
+  if (get_ranges (exe->pid, ranges) > 0 && proc_cache_same_process (exe->pid)) {
+    iov = g_new (struct iovec, ranges->len);
+
+    for (i = 0; i < ranges->len; i++) {
+      preload_range_t *range = &g_array_index (ranges, preload_range_t, i);
+
+      iov[n].iov_base = (void *)range->start;
+      iov[n].iov_len = range->length;
+
+      /* the last range is cut to what is left of the budget */
+      if (range->kb > budget - kb) {
+	iov[n].iov_len = MIN (range->length, (size_t)(budget - kb) * 1024 & ~((size_t)getpagesize () - 1));
+	if (!iov[n].iov_len)
+	  break;
+	kb = budget;
+	n++;
+	break;
+      }
+
+      kb += range->kb;
+      n++;
+    }
+
+    if (n && preload_process_madvise (pidfd, iov, n, advice) < 0) {
+      if (errno == ENOSYS || errno == EINVAL || errno == EPERM) {
+	g_message ("process_madvise for %s failed: %s, disabling it",
+		   what, strerror (errno));
+	*unsupported = TRUE;
+      } else {
+	g_debug ("%s of %s (pid %d) failed: %s", what, exe->path, exe->pid, strerror (errno));
+      }
+      kb = 0;
+    } else if (n) {
+      g_debug ("[Prophet] %s: %s (pid %d), %dkb in %u ranges", what, exe->path, exe->pid, kb, n);
+    }
+
+    g_free (iov);
+  }
+
+  g_array_free (ranges, TRUE);
+  close (pidfd);
+
+  return kb;
+}
+
+void
+preload_prophet_swapin (void)
+{
+  GArray *candidates;
+  GSList *e;
+  int budget, budgettotal; /* in kilobytes */
+  double minprob;
+  guint i;
+
+  stats.swapin_budget = stats.swapin_used = 0;
+  if (conf->model.swapinbudget <= 0 || swapin_unsupported)
+    return;
+
+  /* never push the system into reclaim to do this */
+  budget = MIN (conf->model.swapinbudget / 1024, state->memstat.available);
+  budgettotal = budget;
+  minprob = clamp_percent (conf->model.swapinprob) / 100.0;
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (advise_candidate_t));
+  for (e = state->running_exes; e; e = e->next) {
+    advise_candidate_t c;
+
+    c.exe = e->data;
+    if (c.exe->pid <= 0)
+      continue;
+
+    c.prob = reactivation_prob (c.exe);
+    if (c.prob > 0 && c.prob >= minprob)
+      g_array_append_val (candidates, c);
+  }
+  g_array_sort (candidates, (GCompareFunc)candidate_prob_compare_desc);
+
+  for (i = 0; i < candidates->len && budget > 0 && !swapin_unsupported; i++)
+    budget -= advise_exe (g_array_index (candidates, advise_candidate_t, i).exe,
+			  proc_get_swapin_ranges, MADV_WILLNEED, "swap-in",
+			  budget, &swapin_unsupported);
+
+  if (candidates->len)
+    g_debug ("%dkb available for swap-in, using %dkb of it for %u candidates",
+	     budgettotal, budgettotal - budget, candidates->len);
+  stats.swapin_budget = budgettotal;
+  stats.swapin_used = budgettotal - budget;
+
+  g_array_free (candidates, TRUE);
+}
+
+/* follows cpu usage of running exes, to tell which are idle for how long */
+static void
+exe_update_idle (gpointer data, gpointer G_GNUC_UNUSED user_data)
+{
+  preload_exe_t *exe = (preload_exe_t *)data;
+  long long cputime;
+
+  if (exe->pid <= 0)
+    return;
+
+  cputime = proc_get_cputime (exe->pid);
+  if (cputime != exe->cputime || !exe->idle_timestamp) {
+    exe->cputime = cputime;
+    exe->idle_timestamp = state->time;
+  }
+}
+
+static gboolean
+cold_excluded (const char *path)
+{
+  char **p;
+
+  for (p = conf->system.coldexclude; p && *p; p++)
+    if (**p && !strncmp (path, *p, strlen (*p)))
+      return TRUE;
+
+  return FALSE;
+}
+
+void
+preload_prophet_coldpage (int shortfall)
+{
+  GArray *candidates;
+  GSList *e;
+  int budget, budgettotal; /* in kilobytes */
+  int advice;
+  double maxprob;
+  guint i;
+
+  stats.cold_budget = stats.cold_used = 0;
+  if (conf->model.coldbudget <= 0 || cold_unsupported)
+    return;
+
+  g_slist_foreach (state->running_exes, exe_update_idle, NULL);
+
+  if (shortfall <= 0)
+    return;
+
+  budget = MIN (conf->model.coldbudget / 1024, shortfall);
+  budgettotal = budget;
+  maxprob = clamp_percent (conf->model.coldprob) / 100.0;
+  advice = conf->model.coldpageout ? MADV_PAGEOUT : MADV_COLD;
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (advise_candidate_t));
+  for (e = state->running_exes; e; e = e->next) {
+    advise_candidate_t c;
+
+    c.exe = e->data;
+    if (c.exe->pid <= 0
+	|| state->time - c.exe->idle_timestamp < conf->model.coldidle
+	/* once per idle period is enough */
+	|| (c.exe->cold_timestamp && state->time - c.exe->cold_timestamp < conf->model.coldidle)
+	|| cold_excluded (c.exe->path))
+      continue;
+
+    c.prob = reactivation_prob (c.exe);
+    if (c.prob < maxprob)
+      g_array_append_val (candidates, c);
+  }
+  g_array_sort (candidates, (GCompareFunc)candidate_prob_compare);
+
+  for (i = 0; i < candidates->len && budget > 0 && !cold_unsupported; i++) {
+    preload_exe_t *exe = g_array_index (candidates, advise_candidate_t, i).exe;
+    int used;
+
+    used = advise_exe (exe, proc_get_resident_ranges, advice,
+		       advice == MADV_PAGEOUT ? "pageout" : "cold",
+		       budget, &cold_unsupported);
+    if (used)
+      exe->cold_timestamp = state->time;
+    budget -= used;
+  }
+
+  g_debug ("%dkb short for preloading, aged out %dkb of %u idle apps",
+	   shortfall, budgettotal - budget, candidates->len);
+  stats.cold_budget = budgettotal;
+  stats.cold_used = budgettotal - budget;
+
+  g_array_free (candidates, TRUE);
+}
+
+
+/* Prediction runs in phases over arrays of model items, so it can be cut
+ * into slices that run from the main loop when idle, each within a time
+ * budget (model.predictslice).  That keeps the loop responsive on big
+ * models.  Without a budget, all phases run in one go.  Exes, chains and
+ * maps that come while a prediction is sliced just wait for the next one,
+ * but the items held must stay alive: if an exe, chain or map is freed,
+ * the prediction starts over.
+ */
+
+typedef struct
+{
+  preload_prophet_phase_t phase;
+  GPtrArray *items;	/* markovs or exes, for the phase at hand */
+  guint next;		/* next item to handle */
+  guint generation;	/* free generation the items were taken from */
+  guint source;		/* idle source of a sliced prediction */
+  gint64 phase_time[PREDICT_PHASES]; /* microseconds spent in each phase */
+  gpointer data;
+} predict_job_t;
+
+static predict_job_t job;
+
+static void
+collect_item (gpointer data, gpointer user_data)
+{
+  g_ptr_array_add ((GPtrArray *)user_data, data);
+}
+
+static void
+collect_exe (gpointer G_GNUC_UNUSED key, gpointer value, gpointer user_data)
+{
+  g_ptr_array_add ((GPtrArray *)user_data, value);
+}
+
+static void
+set_items (preload_prophet_phase_t phase)
+{
+  job.phase = stats.phase = phase;
+  PRELOAD_TRACE (phase, preload_prophet_phase_name (phase));
+  job.next = 0;
+  g_ptr_array_set_size (job.items, 0);
+
+  if (phase == PREDICT_BID_EXES)
+    preload_markov_foreach (collect_item, job.items);
+  else if (phase == PREDICT_BID_MAPS)
+    g_hash_table_foreach (state->exes, collect_exe, job.items);
+
+  stats.done = 0;
+  stats.total = job.items->len;
+  preload_stats_publish ();
+}
+
+static void
+predict_restart (void)
+{
+  if (!job.items)
+    job.items = g_ptr_array_new ();
+  job.generation = state->free_generation;
+  memset (job.phase_time, 0, sizeof (job.phase_time));
+  set_items (PREDICT_START);
+}
+
+/* once the engine bid in exes, whichever it is */
+static void
+exes_bid_done (void)
+{
+  /* members of a cluster start when its leader does */
+  preload_cluster_share_probs ();
+  /* and the active workload profile bids over the engine */
+  preload_profile_bid ();
+  if (preload_log_level >= 9)
+    g_hash_table_foreach (state->exes, (GHFunc)exe_prob_print, job.data);
+  set_items (PREDICT_BID_MAPS);
+}
+
+/* runs phases until done or past deadline; returns TRUE when done */
+static gboolean
+predict_run (gint64 deadline)
+{
+  preload_prophet_phase_t phase;
+  gint64 now;
+  int shortfall;
+
+  while (job.phase != PREDICT_IDLE) {
+    now = g_get_monotonic_time ();
+    if (now >= deadline)
+      return FALSE;
+
+    switch (phase = job.phase) {
+    case PREDICT_START:
+      /* reset probabilities that we are gonna compute */
+      g_hash_table_foreach (state->exes, (GHFunc)exe_zero_prob, job.data);
+      g_ptr_array_foreach (state->maps_arr, (GFunc)map_zero_prob, job.data);
+      update_baseline ();
+
+      switch (preload_algorithm ()) {
+      case ALGORITHM_VOMM:
+	/* vomm bids in exes from its own context, in one go */
+	vomm_predict ();
+	break;
+      case ALGORITHM_FRECENCY:
+	/* so does frecency, from the starts of each */
+	preload_frecency_predict ();
+	break;
+      case ALGORITHM_LOGISTIC:
+	/* and logistic, from its model of each under the last context */
+	preload_logistic_predict ();
+	break;
+      case ALGORITHM_MARKOV:
+      default:
+	set_items (PREDICT_BID_EXES);
+	break;
+      }
+      if (job.phase == PREDICT_START)
+	exes_bid_done ();
+      break;
+
+    case PREDICT_BID_EXES:
+      /* markovs bid in exes */
+      while (job.next < job.items->len && g_get_monotonic_time () < deadline)
+	markov_bid_in_exes (g_ptr_array_index (job.items, job.next++), job.data);
+      stats.done = job.next;
+      if (job.next == job.items->len)
+	exes_bid_done ();
+      break;
+
+    case PREDICT_BID_MAPS:
+      /* exes bid in maps */
+      while (job.next < job.items->len && g_get_monotonic_time () < deadline) {
+	preload_exe_t *exe = g_ptr_array_index (job.items, job.next++);
+
+	PRELOAD_TRACE (exe_bid, exe->path, (long)(exe->lnprob * 1e6));
+	bid_in_exe_exemaps (NULL, exe, job.data);
+      }
+      stats.done = job.next;
+      if (job.next == job.items->len)
+	set_items (PREDICT_SORT);
+      break;
+
+    case PREDICT_SORT:
+      /* sort maps on probability */
+      g_ptr_array_sort (state->maps_arr, (GCompareFunc)map_prob_compare);
+      set_items (PREDICT_ACT);
+      break;
+
+    case PREDICT_ACT:
+      /* warm up their metadata, then read them in */
+      warm_metadata ();
+      shortfall = preload_prophet_readahead (state->maps_arr);
+
+      /* bring back running apps about to be used again, and make room
+       * for what did not fit */
+      preload_prophet_swapin ();
+      preload_prophet_coldpage (shortfall);
+      set_items (PREDICT_IDLE);
+      break;
+
+    case PREDICT_IDLE:
+    case PREDICT_PHASES:
+      break;
+    }
+
+    job.phase_time[phase] += g_get_monotonic_time () - now;
+    preload_timeline_span (TIMELINE_MAIN, preload_prophet_phase_name (phase), now);
+  }
+
+  return TRUE;
+}
+
+static void
+predict_finished (void)
+{
+  stats.completed++;
+  stats.duration = g_get_monotonic_time () - stats.started;
+  memcpy (stats.phase_time, job.phase_time, sizeof (stats.phase_time));
+  preload_timeline_counter ("budget",
+			    "readahead", (gint64)stats.readahead_budget,
+			    "readahead used", (gint64)stats.readahead_used,
+			    "swap-in used", (gint64)stats.swapin_used,
+			    "cold used", (gint64)stats.cold_used, NULL);
+  g_debug ("prediction done in %" G_GINT64_FORMAT "us, %u slices",
+	   stats.duration, stats.slices);
 }
 
+static gboolean
+predict_slice (gpointer G_GNUC_UNUSED user_data)
+{
+  if (job.generation != state->free_generation) {
+    g_debug ("model lost items during prediction, starting over");
+    stats.restarts++;
+    predict_restart ();
+  }
+
+  stats.slices++;
+  if (!predict_run (g_get_monotonic_time () + conf->model.predictslice * 1000))
+    return TRUE;
+
+  job.source = 0;
+  predict_finished ();
+  return FALSE;
+}
 
 void
 preload_prophet_predict (gpointer data)
 {
   g_debug("Running Prediction (algorithm: %s)...", 
         conf->system.prediction_algorithm ? conf->system.prediction_algorithm : "NULL");
-  if (preload_is_vomm_algorithm()) {
-      
-      /* Reset probabilities to avoid stale values */
-      g_hash_table_foreach (state->exes, (GHFunc)exe_zero_prob, data);
-      g_ptr_array_foreach (state->maps_arr, (GFunc)map_zero_prob, data);
-
-      /* For VOMM, we predict based on the last executed file. 
-         Ideally, we should track the current sequence context. 
-         vomm_predict uses the global context maintained by vomm_update.
-         We just pass NULL or current running exe if needed, but vomm_system tracks context.
-      */
-      vomm_predict();    
-      
-      /* After VOMM predicts (which modifies lnprobs), we propagate to maps */
-      g_hash_table_foreach (state->exes, (GHFunc)bid_in_exe_exemaps, data);
-
-      /* verify: print top exe probabilities for debugging */
-      if (preload_log_level >= 9)
-        g_hash_table_foreach (state->exes, (GHFunc)exe_prob_print, data);
 
-      g_ptr_array_sort (state->maps_arr, (GCompareFunc)map_prob_compare);
-      preload_prophet_readahead (state->maps_arr);
-      return;
+  if (job.source) {
+    /* the last one did not make it in time, this one supersedes it */
+    g_debug ("prediction still in %s, starting over",
+	     preload_prophet_phase_name (job.phase));
+    g_source_remove (job.source);
+    job.source = 0;
+    stats.restarts++;
   }
 
-  /* reset probabilities that we are gonna compute */
-  g_hash_table_foreach (state->exes, (GHFunc)exe_zero_prob, data);
-  g_ptr_array_foreach (state->maps_arr, (GFunc)map_zero_prob, data);
+  job.data = data;
+  predict_restart ();
+  stats.started = g_get_monotonic_time ();
+  stats.slices = 0;
+
+  if (conf->model.predictslice > 0) {
+    job.source = g_idle_add (predict_slice, NULL);
+    return;
+  }
 
-  /* markovs bid in exes */
-  preload_markov_foreach ((GFunc)markov_bid_in_exes, data);
+  stats.slices = 1;
+  predict_run (G_MAXINT64);
+  predict_finished ();
+}
 
-  if (preload_log_level >= 9)
-    g_hash_table_foreach (state->exes, (GHFunc)exe_prob_print, data);
+/* adds the maps of exe that fit in budget to files */
+static void
+add_exe_maps (GPtrArray *files, preload_exe_t *exe, int *budget)
+{
+  guint i;
+
+  for (i = 0; i < exe->exemaps->len; i++) {
+    preload_map_t *map = ((preload_exemap_t *)g_ptr_array_index (exe->exemaps, i))->map;
+
+    if (!map->baseline && kb (map->length) <= *budget) {
+      *budget -= kb (map->length);
+      g_ptr_array_add (files, map);
+    }
+  }
+}
+
+/* an exe just started reads in the children it is likely to start
+ * within a cycle, out of what the last prediction left of its budget.
+ * the ones it starts later are the prediction's business. */
+static void
+prefetch_children (preload_exe_t *exe)
+{
+  GPtrArray *files;
+  int budget = stats.readahead_budget - stats.readahead_used;
+  guint i;
+
+  if (conf->model.spawnprob <= 0 || !exe->spawns->len)
+    return;
+
+  files = g_ptr_array_new ();
+  for (i = 0; i < exe->spawns->len; i++) {
+    preload_spawn_t *spawn = g_ptr_array_index (exe->spawns, i);
+
+    if (exe_is_running (spawn->child) || spawn->delay > conf->model.cycle
+	|| preload_spawn_prob (spawn) * 100 < conf->model.spawnprob)
+      continue;
+
+    add_exe_maps (files, spawn->child, &budget);
+  }
 
-  /* exes bid in maps */
-  g_hash_table_foreach (state->exes, (GHFunc)bid_in_exe_exemaps, data);
+  if (files->len) {
+    stats.readahead_used = stats.readahead_budget - budget;
+    g_debug ("%s started, readahead %d files of its children", exe->path,
+	     preload_readahead_now ((preload_map_t **)files->pdata, files->len));
+  }
+  g_ptr_array_free (files, TRUE);
+}
+
+void
+preload_prophet_exe_started (preload_exe_t *exe)
+{
+  guint i;
+
+  for (i = 0; i < exe->exemaps->len; i++) {
+    preload_map_t *map = ((preload_exemap_t *)g_ptr_array_index (exe->exemaps, i))->map;
 
-  /* sort maps on probability */
-  g_ptr_array_sort (state->maps_arr, (GCompareFunc)map_prob_compare);
+    if (map->prefetched) {
+      map->prefetched = FALSE;
+      stats.hits++;
+      stats.hit_kb += kb (map->length);
+    }
+  }
 
-  /* read them in */
-  preload_prophet_readahead (state->maps_arr);
+  prefetch_children (exe);
+}
+
+void
+preload_prophet_profile_switched (GPtrArray *exes)
+{
+  GPtrArray *files;
+  int budget = stats.readahead_budget - stats.readahead_used;
+  guint i;
+
+  files = g_ptr_array_new ();
+  for (i = 0; i < exes->len; i++) {
+    preload_exe_t *exe = g_ptr_array_index (exes, i);
+
+    if (!exe_is_running (exe))
+      add_exe_maps (files, exe, &budget);
+  }
+
+  if (files->len) {
+    stats.readahead_used = stats.readahead_budget - budget;
+    g_debug ("workload profile switched, readahead %d files of its exes",
+	     preload_readahead_now ((preload_map_t **)files->pdata, files->len));
+  }
+  g_ptr_array_free (files, TRUE);
+}
+
+const char *
+preload_prophet_phase_name (preload_prophet_phase_t phase)
+{
+  static const char * const names[] = {
+    "idle", "start", "exe bidding", "map bidding", "sort", "prefetch"
+  };
+
+  return phase < G_N_ELEMENTS (names) ? names[phase] : "?";
+}
+
+const preload_prophet_stats_t *
+preload_prophet_stats (void)
+{
+  return &stats;
 }
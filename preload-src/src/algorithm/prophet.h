@@ -1,7 +1,65 @@
 #ifndef PROPHET_H
 #define PROPHET_H
 
+#include <glib.h>
+#include "exe.h"
+
+/* phases of a prediction, in order */
+typedef enum
+{
+  PREDICT_IDLE,		/* not predicting */
+  PREDICT_START,	/* resetting probabilities, vomm bidding */
+  PREDICT_BID_EXES,	/* markovs bidding in exes */
+  PREDICT_BID_MAPS,	/* exes bidding in maps */
+  PREDICT_SORT,		/* sorting maps */
+  PREDICT_ACT,		/* prefetch, swap-in, aging out */
+  PREDICT_PHASES
+} preload_prophet_phase_t;
+
+/* progress of the current prediction, and how the last one went */
+typedef struct _preload_prophet_stats_t
+{
+  preload_prophet_phase_t phase;
+  guint done;		/* items of the phase handled */
+  guint total;		/* items of the phase */
+  guint slices;		/* slices used so far */
+  guint completed;	/* predictions finished */
+  guint restarts;	/* predictions started over */
+  gint64 started;	/* monotonic time the current one started */
+  gint64 duration;	/* microseconds the last one took */
+  gint64 phase_time[PREDICT_PHASES]; /* microseconds the last one spent in each phase */
+
+  /* budgets of the last cycle and how much of them went, in kilobytes */
+  int readahead_budget;
+  int readahead_used;
+  int swapin_budget;
+  int swapin_used;
+  int cold_budget;
+  int cold_used;
+
+  /* since start: maps read ahead, and what came of them.  a prefetched
+   * map is a hit once an exe using it starts, and a waste if it drops out
+   * of the prediction before that. */
+  guint64 prefetched_kb;
+  guint64 hits;
+  guint64 hit_kb;
+  guint64 wastes;
+  guint64 waste_kb;
+} preload_prophet_stats_t;
+
 void preload_prophet_predict (gpointer data);
-void preload_prophet_readahead (GPtrArray *maps_arr);
+int preload_prophet_readahead (GPtrArray *maps_arr);
+void preload_prophet_swapin (void);
+void preload_prophet_coldpage (int shortfall);
+
+/* settles the prefetched maps of an exe that just started as hits */
+void preload_prophet_exe_started (preload_exe_t *exe);
+
+/* reads in the exes of a workload profile just switched to, most often
+ * running first, out of what the last prediction left of its budget */
+void preload_prophet_profile_switched (GPtrArray *exes);
+
+const preload_prophet_stats_t *preload_prophet_stats (void);
+const char *preload_prophet_phase_name (preload_prophet_phase_t phase);
 
 #endif
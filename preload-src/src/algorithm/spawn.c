@@ -0,0 +1,138 @@
+/* spawn.c - Parent to child spawn model for preload prediction
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "spawn.h"
+#include "exe.h"
+#include "state.h"
+
+/*
+ * Many exes are started by others: a shell starts make, make starts cc
+ * and ld, an IDE its language servers.  The parent of every exe seen
+ * starting is read from /proc, and each exe keeps, per child, how many
+ * of its runs started it and how long after its own start.  When a
+ * parent starts, its likely children can be read ahead before they exec,
+ * which catches bursts far quicker than a cycle.
+ *
+ * Counts are halved once a parent has SPAWN_MAX_STARTS starts, so the
+ * model follows changing habits.
+ */
+
+#define SPAWN_MAX_STARTS 64
+#define SPAWN_DELAY_WEIGHT 8	/* runs the mean delay is taken over, about */
+
+/* Access to global state */
+extern preload_state_t state[1];
+
+
+preload_spawn_t *
+preload_spawn_new (preload_exe_t *parent, preload_exe_t *child)
+{
+  preload_spawn_t *spawn;
+
+  g_return_val_if_fail (parent, NULL);
+  g_return_val_if_fail (child, NULL);
+
+  spawn = g_malloc0 (sizeof (*spawn));
+  spawn->child = child;
+  g_ptr_array_add (parent->spawns, spawn);
+  return spawn;
+}
+
+
+void
+preload_spawn_free (gpointer data, gpointer G_GNUC_UNUSED user_data)
+{
+  g_free (data);
+}
+
+
+void
+preload_spawn_observe (preload_exe_t *parent, preload_exe_t *child, double delay)
+{
+  preload_spawn_t *spawn = NULL;
+  guint i;
+
+  g_return_if_fail (parent);
+  g_return_if_fail (child);
+
+  if (parent == child)
+    return;
+
+  for (i = 0; i < parent->spawns->len && !spawn; i++)
+    if (((preload_spawn_t *)g_ptr_array_index (parent->spawns, i))->child == child)
+      spawn = g_ptr_array_index (parent->spawns, i);
+
+  if (!spawn) {
+    spawn = preload_spawn_new (parent, child);
+    spawn->starts = 1;
+    spawn->delay = delay;
+  }
+
+  /* the parent start may be counted right after, in the same scan */
+  spawn->count = MIN (spawn->count + 1, spawn->starts + 1);
+  spawn->delay += (delay - spawn->delay) / MIN (spawn->count, SPAWN_DELAY_WEIGHT);
+}
+
+
+void
+preload_spawn_parent_started (preload_exe_t *parent)
+{
+  guint i;
+
+  g_return_if_fail (parent);
+
+  for (i = 0; i < parent->spawns->len; i++) {
+    preload_spawn_t *spawn = g_ptr_array_index (parent->spawns, i);
+
+    if (++spawn->starts > SPAWN_MAX_STARTS) {
+      spawn->starts /= 2;
+      spawn->count /= 2;
+    }
+  }
+}
+
+
+double
+preload_spawn_prob (const preload_spawn_t *spawn)
+{
+  g_return_val_if_fail (spawn, 0);
+
+  if (spawn->starts <= 0)
+    return 0;
+  return MIN (1.0, (double)spawn->count / spawn->starts);
+}
+
+
+static void
+forget_child (gpointer G_GNUC_UNUSED key, preload_exe_t *parent, preload_exe_t *child)
+{
+  guint i;
+
+  for (i = parent->spawns->len; i-- > 0; ) {
+    preload_spawn_t *spawn = g_ptr_array_index (parent->spawns, i);
+
+    if (spawn->child == child) {
+      g_ptr_array_remove_index_fast (parent->spawns, i);
+      preload_spawn_free (spawn, NULL);
+    }
+  }
+}
+
+void
+preload_spawn_forget (preload_exe_t *exe)
+{
+  g_return_if_fail (exe);
+
+  if (state->exes)
+    g_hash_table_foreach (state->exes, (GHFunc)forget_child, exe);
+}
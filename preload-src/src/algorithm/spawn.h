@@ -0,0 +1,42 @@
+/* spawn.h - Parent to child spawn model declarations
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <glib.h>
+
+/* Forward declarations */
+typedef struct _preload_exe_t preload_exe_t;
+
+/* preload_spawn_t: how often an exe starts another, kept in the
+ * spawns of the parent. */
+typedef struct _preload_spawn_t
+{
+  preload_exe_t *child;
+  int starts; /* times the parent was seen starting since. */
+  int count; /* times the child was seen started by the parent since. */
+  double delay; /* mean seconds from the parent's start to the child's. */
+} preload_spawn_t;
+
+/* Functions */
+preload_spawn_t * preload_spawn_new (preload_exe_t *parent, preload_exe_t *child);
+void preload_spawn_free (gpointer data, gpointer user_data);
+
+/* child was seen started by parent, delay seconds after it */
+void preload_spawn_observe (preload_exe_t *parent, preload_exe_t *child, double delay);
+
+/* parent was seen starting */
+void preload_spawn_parent_started (preload_exe_t *parent);
+
+/* probability that the parent starts the child when it runs */
+double preload_spawn_prob (const preload_spawn_t *spawn);
+
+/* drops the spawns of other exes that have exe as child */
+void preload_spawn_forget (preload_exe_t *exe);
+
+#endif /* SPAWN_H */
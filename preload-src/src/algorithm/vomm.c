@@ -332,6 +332,52 @@ void vomm_predict(void) {
     }
 }
 
+/* Probability that @node's children continue with @exe */
+static double child_prob(vomm_node_t *node, preload_exe_t *exe) {
+    GHashTableIter iter;
+    gpointer key, value;
+    vomm_node_t *target;
+    int total = 0;
+
+    if (!node || !(target = g_hash_table_lookup(node->children, exe->path)))
+        return 0.0;
+
+    g_hash_table_iter_init(&iter, node->children);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        total += ((vomm_node_t *)value)->count;
+
+    return total > 0 ? (double)target->count / total : 0.0;
+}
+
+/*
+ * Probability that @exe is the next one the user turns to, given the
+ * recent history, regardless of whether it is running already.  Combines
+ * the bigram transitions from every history item and the deep context as
+ * independent evidence:  P = 1 - Π (1 - p_i)
+ */
+double vomm_transition_prob(preload_exe_t *exe) {
+    GList *hist_iter;
+    double lnprob_not = 0.0;
+
+    if (!vomm_system.root || !exe || !exe->path)
+        return 0.0;
+
+    for (hist_iter = vomm_system.history; hist_iter != NULL; hist_iter = hist_iter->next) {
+        preload_exe_t *hist_exe = (preload_exe_t *)hist_iter->data;
+        if (!hist_exe || hist_exe == exe || !hist_exe->path) continue;
+
+        double p = child_prob(g_hash_table_lookup(vomm_system.root->children, hist_exe->path), exe);
+        lnprob_not += log(1.0 - fmin(p, 0.999));
+    }
+
+    if (vomm_system.current_context && vomm_system.current_context != vomm_system.root) {
+        double p = child_prob(vomm_system.current_context, exe);
+        lnprob_not += log(1.0 - fmin(p, 0.999));
+    }
+
+    return 1.0 - exp(lnprob_not);
+}
+
 /* 
  * Hydrate VOMM model from legacy Markov state 
  * This allows VOMM to work immediately after restart by using the 
@@ -40,6 +40,12 @@ void vomm_update(preload_exe_t *exe);
  */
 void vomm_predict(void);
 
+/* 
+ * Probability that @exe is turned to next given the current context.
+ * Unlike vomm_predict(), running executables are scored too.
+ */
+double vomm_transition_prob(preload_exe_t *exe);
+
 /* Persistence */
 typedef void (*VommNodeWriter)(gint64 id, gint64 exe_seq, int count, gint64 parent_id, gpointer user_data);
 void vomm_export_state(VommNodeWriter writer, gpointer user_data);
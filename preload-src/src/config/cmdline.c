@@ -38,6 +38,7 @@ static const struct option opts[] = {
   {"conffile", 1, 0, 'c'},
   {"statefile", 1, 0, 's'},
   {"logfile", 1, 0, 'l'},
+  {"statsfile", 1, 0, 't'},
   {"foreground", 0, 0, 'f'},
   {"nice", 1, 0, 'n'},
   {"verbose", 1, 0, 'V'},
@@ -52,6 +53,7 @@ static const char *opts_help[] = {
   "Set configuration file. Empty string means no conf file.",	/* conffile */
   "Set state file to load/save. Empty string means no state.",	/* statefile */
   "Set log file. Empty string means to log to stderr.",	/* logfile */
+  "Set file to publish statistics in. Empty string means none.",	/* statsfile */
   "Run in foreground, do not daemonize.",	/* foreground */
   "Nice level.",	/* nice */
   "Set the verbosity level.  Levels 0 to 10 are recognized.",	/* verbose */
@@ -63,6 +65,7 @@ static const char *opts_default[] = {
   DEFAULT_CONFFILE,	/* conffile */
   DEFAULT_STATEFILE,	/* statefile */
   DEFAULT_LOGFILE,	/* logfile */
+  DEFAULT_STATSFILE,	/* statsfile */
   NULL,	/* foreground */
   DEFAULT_NICELEVEL_STRING,	/* nice */
   DEFAULT_LOGLEVEL_STRING,	/* verbose */
@@ -80,7 +83,7 @@ preload_cmdline_parse (preload_ctx_t *ctx, int *argc, char ***argv)
   for (;;)
     {
       int i;
-      i = getopt_long (*argc, *argv, "hHvc:s:l:fn:V:d", opts, NULL);
+      i = getopt_long (*argc, *argv, "hHvc:s:l:t:fn:V:d", opts, NULL);
       if (i == -1)
 	{
 	  break;
@@ -99,6 +102,10 @@ preload_cmdline_parse (preload_ctx_t *ctx, int *argc, char ***argv)
 	  g_free(ctx->logfile);
 	  ctx->logfile = g_strdup(optarg);
 	  break;
+	case 't':
+	  g_free(ctx->statsfile);
+	  ctx->statsfile = g_strdup(optarg);
+	  break;
 	case 'f':
 	  ctx->foreground = TRUE;
 	  break;
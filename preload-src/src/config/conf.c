@@ -102,7 +102,11 @@ preload_conf_load (const char *conffile, gboolean fail)
   /* free the old configuration */
   g_strfreev (conf->system.mapprefix);
   g_strfreev (conf->system.exeprefix);
+  g_strfreev (conf->system.canonprefix);
+  g_strfreev (conf->system.coldexclude);
+  g_strfreev (conf->system.ephemeralexe);
   g_free (conf->system.prediction_algorithm);
+  g_free (conf->system.tracefile);
 
   *conf = newconf;
 }
@@ -147,21 +151,43 @@ preload_conf_dump_log (void)
   g_debug ("conf log dump done");
 }
 
-gboolean
-preload_is_vomm_algorithm (void)
+preload_algorithm_t
+preload_algorithm (void)
 {
   const char *algo = conf->system.prediction_algorithm;
-  
+
   if (!algo)
-    return FALSE;
-  
-  /* Handle both "VOMM" (exact) and quoted values like "\"VOMM\"" from config file */
-  if (g_str_equal(algo, "VOMM"))
-    return TRUE;
-  
-  /* Check if VOMM appears in the value (handles quoted strings from GKeyFile) */
-  if (g_strstr_len(algo, -1, "VOMM") != NULL)
-    return TRUE;
-  
-  return FALSE;
+    return ALGORITHM_MARKOV;
+
+  /* match anywhere in the value, which handles quoted strings from GKeyFile */
+  if (g_strstr_len (algo, -1, "VOMM"))
+    return ALGORITHM_VOMM;
+  if (g_strstr_len (algo, -1, "Frecency") || g_strstr_len (algo, -1, "frecency"))
+    return ALGORITHM_FRECENCY;
+  if (g_strstr_len (algo, -1, "Logistic") || g_strstr_len (algo, -1, "logistic"))
+    return ALGORITHM_LOGISTIC;
+
+  return ALGORITHM_MARKOV;
+}
+
+const char *
+preload_algorithm_name (preload_algorithm_t algorithm)
+{
+  switch (algorithm) {
+  case ALGORITHM_VOMM:
+    return "VOMM";
+  case ALGORITHM_FRECENCY:
+    return "Frecency";
+  case ALGORITHM_LOGISTIC:
+    return "Logistic";
+  case ALGORITHM_MARKOV:
+  default:
+    return "Markov";
+  }
+}
+
+gboolean
+preload_is_vomm_algorithm (void)
+{
+  return preload_algorithm () == ALGORITHM_VOMM;
 }
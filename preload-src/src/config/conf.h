@@ -14,6 +14,14 @@
 
 #define processes	   1
 
+#define lookups		   1
+
+#define mappings	   1
+
+#define milliseconds	   1
+
+#define workloads	   1
+
 
 typedef struct _preload_conf_t
 {
@@ -26,23 +34,58 @@ typedef struct _preload_conf_t
     gboolean usecorrelation;
 
     int minsize;
+    int maprefresh; /* how often maps of a running exe are read again */
+    int baseline;   /* share of exes using a map that makes it baseline, percent */
 
     /* memory usage adjustment (signed percentages) */
     int memtotal;
     int memfree;
     int memcached;
     int membuffers;  /* percentage of buffers to consider reclaimable (default: 50%) */
+
+    /* swap-in of running apps predicted to be used again */
+    int swapinbudget; /* budget per cycle, separate from the readahead one */
+    int swapinprob;   /* minimum reactivation probability, percent */
+
+    int metaprob;     /* minimum P(needed) for metadata warming, percent */
+    int spawnprob;    /* minimum P(started by parent) to read a child ahead */
+    int clustersim;   /* running-time similarity that merges exes, percent */
+    int maxprofiles;  /* workload profiles told apart, 0 for none */
+    int profilesim;   /* running-set similarity to stay in a profile, percent */
+
+    /* the frecency engine */
+    int frecencyhalflife;     /* age at which a start counts half */
+    gboolean frecencyhourly;  /* weigh starts by the hour of day */
+
+    /* aging out memory of idle apps when prefetch runs out of room */
+    int coldbudget;   /* per cycle, 0 disables */
+    int coldidle;     /* how long an app must not have used cpu */
+    int coldprob;     /* maximum reactivation probability, percent */
+    gboolean coldpageout; /* reclaim right away instead of deprioritizing */
+    int predictslice; /* main loop time a prediction may take at once */
   } model;
 
   struct _conf_system {
     gboolean doscan;
     gboolean dopredict;
+    gboolean asyncscan; /* list processes on a worker thread */
     int autosave;
 
     char **mapprefix;
     char **exeprefix;
+    char **canonprefix;  /* install prefixes whose paths carry hash/version */
+    char **coldexclude;  /* exes never to age out */
+    char **ephemeralexe;  /* exes never to put in the model */
 
     int maxprocs;
+    int prefetchtimeout;  /* deadline of a single prefetch request */
+    int remoteprocs;  /* readers at a time on network and FUSE filesystems */
+    int remotetimeout;  /* deadline of a prefetch request on those */
+    int remotebudget;  /* bytes read from those per round */
+    int compressedbudget;  /* bytes read from compressed filesystems per round */
+    int cancelpressure;   /* PSI memory "some avg10" that aborts prefetch */
+    int metabudget;       /* files and directories to warm per cycle */
+    int prefetchrecheck;  /* expired cached maps looked up per cycle */
     enum {
       SORT_NONE  = 0,
       SORT_PATH  = 1,
@@ -50,7 +93,10 @@ typedef struct _preload_conf_t
       SORT_BLOCK = 3
     } sortstrategy;
     
-    char *prediction_algorithm;  /* "Markov" or "VOMM" */
+    char *prediction_algorithm;  /* "Markov", "VOMM", "Frecency" or "Logistic" */
+
+    char *tracefile;      /* timeline of what the daemon does, NULL for none */
+    int tracesize;        /* at which the timeline is rotated */
   } system;
 
 } preload_conf_t;
@@ -61,6 +107,19 @@ extern preload_conf_t conf[1];
 void preload_conf_load (const char *conffile, gboolean fail);
 void preload_conf_dump_log (void);
 
+/* the engines prediction_algorithm selects; anything unknown is Markov */
+typedef enum
+{
+  ALGORITHM_MARKOV,
+  ALGORITHM_VOMM,
+  ALGORITHM_FRECENCY,
+  ALGORITHM_LOGISTIC
+} preload_algorithm_t;
+
+/* the selected engine (handles NULL and quoted values) */
+preload_algorithm_t preload_algorithm (void);
+const char * preload_algorithm_name (preload_algorithm_t algorithm);
+
 /* Helper to check if VOMM algorithm is selected (handles NULL and quoted values) */
 gboolean preload_is_vomm_algorithm (void);
 
@@ -1,15 +1,45 @@
 confkey(model,	integer,	cycle,		     20,	seconds)
 confkey(model,	boolean,	usecorrelation,	   true,	-)
 confkey(model,	integer,	minsize,	2000000,	bytes)
+confkey(model,	integer,	maprefresh,	     10,	minutes)
+confkey(model,	integer,	baseline,	     50,	signed_integer_percent)
 confkey(model,	integer,	memtotal,	    -10,	signed_integer_percent)
 confkey(model,	integer,	memfree,	     50,	signed_integer_percent)
 confkey(model,	integer,	memcached,	      0,	signed_integer_percent)
 confkey(model,	integer,	membuffers,	     50,	signed_integer_percent)
+confkey(model,	integer,	swapinbudget,	      0,	kilobytes)
+confkey(model,	integer,	swapinprob,	     30,	signed_integer_percent)
+confkey(model,	integer,	metaprob,	     20,	signed_integer_percent)
+confkey(model,	integer,	spawnprob,	     50,	signed_integer_percent)
+confkey(model,	integer,	clustersim,	     90,	signed_integer_percent)
+confkey(model,	integer,	maxprofiles,	      8,	workloads)
+confkey(model,	integer,	profilesim,	     50,	signed_integer_percent)
+confkey(model,	integer,	frecencyhalflife,    72,	hours)
+confkey(model,	boolean,	frecencyhourly,	   true,	-)
+confkey(model,	integer,	coldbudget,	      0,	kilobytes)
+confkey(model,	integer,	coldidle,	     10,	minutes)
+confkey(model,	integer,	coldprob,	      5,	signed_integer_percent)
+confkey(model,	boolean,	coldpageout,	  false,	-)
+confkey(model,	integer,	predictslice,	      0,	milliseconds)
 confkey(system,	boolean,	doscan,		   true,	-)
 confkey(system,	boolean,	dopredict,	   true,	-)
+confkey(system,	boolean,	asyncscan,	   true,	-)
 confkey(system,	integer,	autosave,	   3600,	seconds)
 confkey(system,	string_list,	mapprefix,	   NULL,	-)
 confkey(system,	string_list,	exeprefix,	   NULL,	-)
+confkey(system,	string_list,	canonprefix,	   NULL,	-)
+confkey(system,	string_list,	coldexclude,	   NULL,	-)
+confkey(system,	string_list,	ephemeralexe,	   NULL,	-)
 confkey(system,	string,		prediction_algorithm,	"VOMM",	-)
 confkey(system,	integer,	maxprocs,	     30,	processes)
+confkey(system,	integer,	prefetchtimeout,     15,	seconds)
+confkey(system,	integer,	remoteprocs,	      2,	processes)
+confkey(system,	integer,	remotetimeout,	      5,	seconds)
+confkey(system,	integer,	remotebudget,	  32768,	kilobytes)
+confkey(system,	integer,	compressedbudget, 131072,	kilobytes)
+confkey(system,	integer,	cancelpressure,	     20,	signed_integer_percent)
+confkey(system,	integer,	metabudget,	   4000,	lookups)
+confkey(system,	integer,	prefetchrecheck,      8,	mappings)
 confkey(system,	enum,		sortstrategy,	      3,	-)
+confkey(system,	string,		tracefile,	   NULL,	-)
+confkey(system,	integer,	tracesize,	  16384,	kilobytes)
@@ -28,7 +28,11 @@
 #include "cmdline.h"
 #include "conf.h"
 #include "state.h"
+#include "proc.h"
 #include "context.h"
+#include "readahead.h"
+#include "stats.h"
+#include "timeline.h"
 
 #include <signal.h>
 #include <grp.h>
@@ -92,6 +96,9 @@ sig_handler_sync (gpointer data)
   switch (GPOINTER_TO_INT (data)) {
     case SIGHUP:
       preload_conf_load (ctx->conffile, FALSE);
+      preload_timeline_open (conf->system.tracefile, conf->system.tracesize);
+      proc_cache_flush ();
+      preload_readahead_cancel ("reload");
       preload_log_reopen (ctx->logfile);
       break;
     case SIGUSR1:
@@ -147,14 +154,21 @@ main (int argc, char **argv)
     g_warning ("%s", strerror (errno));
   g_debug ("starting up");
   preload_state_load (ctx->statefile);
+  preload_stats_open (ctx->statsfile);
+  preload_timeline_open (conf->system.tracefile, conf->system.tracesize);
 
   /* main loop */
   ctx->main_loop = g_main_loop_new (NULL, FALSE);
   preload_state_run (ctx->statefile);
   g_main_loop_run (ctx->main_loop);
 
-  /* clean up */
+  /* clean up; the scan worker may still be walking /proc and the
+   * shared cache, so it is joined before the state is saved */
+  preload_state_stop ();
+  preload_readahead_cancel ("exit");
   preload_state_save (ctx->statefile);
+  preload_stats_close ();
+  preload_timeline_close ();
   if (preload_is_debugging ())
     preload_state_free ();
   g_debug ("exiting");
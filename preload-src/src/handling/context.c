@@ -10,6 +10,7 @@ preload_context_new(void)
   ctx->conffile = g_strdup(DEFAULT_CONFFILE);
   ctx->statefile = g_strdup(DEFAULT_STATEFILE);
   ctx->logfile = g_strdup(DEFAULT_LOGFILE);
+  ctx->statsfile = g_strdup(DEFAULT_STATSFILE);
   ctx->nicelevel = DEFAULT_NICELEVEL;
   ctx->foreground = FALSE;
   
@@ -28,6 +29,7 @@ preload_context_free(preload_ctx_t *ctx)
   g_free(ctx->conffile);
   g_free(ctx->statefile);
   g_free(ctx->logfile);
+  g_free(ctx->statsfile);
   
   if (ctx->main_loop)
       g_main_loop_unref(ctx->main_loop);
@@ -10,6 +10,7 @@ typedef struct _preload_ctx_t {
     char *conffile;
     char *statefile;
     char *logfile;
+    char *statsfile;
     
     /* Settings */
     int nicelevel;
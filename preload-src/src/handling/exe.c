@@ -25,7 +25,11 @@
 #include "exe.h"
 #include "map.h"
 #include "markov.h"
+#include "spawn.h"
+#include "cluster.h"
+#include "profile.h"
 #include "state.h"
+#include "proc.h"
 
 
 /* Check if executable is currently running */
@@ -102,8 +106,22 @@ preload_exe_new (const char *path, gboolean running, GPtrArray *exemaps)
   else
     exe->exemaps = exemaps;
   exe->lnprob = 0.0;
+  exe->pid = 0;
+  exe->cputime = 0;
+  exe->idle_timestamp = exe->cold_timestamp = 0;
+  exe->pidfd = -1;
+  exe->exit_watch = 0;
+  exe->maps_timestamp = 0;
+  exe->seen_timestamp = -1;
+  exe->frecency = 0;
+  exe->frecency_time = 0;
+  memset (exe->frecency_hour, 0, sizeof (exe->frecency_hour));
+  exe->logistic = NULL;
+  exe->logistic_since = -1;
+  exe->cluster = NULL;
   g_ptr_array_foreach (exe->exemaps, (GFunc)exe_add_map_size, exe);
   exe->markovs = g_ptr_array_new ();
+  exe->spawns = g_ptr_array_new ();
   return exe;
 }
 
@@ -113,6 +131,10 @@ preload_exe_free (preload_exe_t *exe)
 {
   g_return_if_fail (exe);
 
+  if (exe->exit_watch)
+    g_source_remove (exe->exit_watch);
+  if (exe->pidfd >= 0)
+    close (exe->pidfd);
   if (exe->exemaps) {
     g_ptr_array_foreach (exe->exemaps, (GFunc)preload_exemap_free, NULL);
     g_ptr_array_free (exe->exemaps, TRUE);
@@ -123,6 +145,13 @@ preload_exe_free (preload_exe_t *exe)
     g_ptr_array_free (exe->markovs, TRUE);
     exe->markovs = NULL;
   }
+  if (exe->spawns) {
+    g_ptr_array_foreach (exe->spawns, preload_spawn_free, NULL);
+    g_ptr_array_free (exe->spawns, TRUE);
+    exe->spawns = NULL;
+  }
+  g_free (exe->logistic);
+  exe->logistic = NULL;
   if (exe->path) {
     g_free (exe->path);
     exe->path = NULL;
@@ -146,10 +175,75 @@ preload_exemap_new_from_exe (preload_exe_t *exe, preload_map_t *map)
 }
 
 
+/* An exe's maps are first read when it is first seen, but it may map
+ * more later (plugins, dlopen()ed libraries, JIT caches) and stop using
+ * some.  So later snapshots are folded in: the prob of every exemap moves
+ * EXEMAP_RATE of the way towards whether the snapshot has its map, maps
+ * seen for the first time join at that rate, and exemaps whose prob falls
+ * below EXEMAP_MIN_PROB are dropped. */
+#define EXEMAP_RATE 0.2
+#define EXEMAP_MIN_PROB 0.05
+
+gboolean
+preload_exe_update_exemaps (preload_exe_t *exe, GPtrArray *snapshot)
+{
+  GHashTable *current, *known;
+  gboolean changed = FALSE;
+  guint i;
+
+  g_return_val_if_fail (exe, FALSE);
+  g_return_val_if_fail (snapshot, FALSE);
+
+  current = g_hash_table_new (NULL, NULL);
+  known = g_hash_table_new (NULL, NULL);
+
+  /* maps are shared through state->maps, so pointers compare */
+  for (i = 0; i < snapshot->len; i++)
+    g_hash_table_add (current, ((preload_exemap_t *)g_ptr_array_index (snapshot, i))->map);
+
+  for (i = exe->exemaps->len; i-- > 0; ) {
+    preload_exemap_t *exemap = g_ptr_array_index (exe->exemaps, i);
+    gboolean present = g_hash_table_contains (current, exemap->map);
+
+    exemap->prob += EXEMAP_RATE * ((present ? 1.0 : 0.0) - exemap->prob);
+    if (!present && exemap->prob < EXEMAP_MIN_PROB) {
+      exe->size -= preload_map_get_size (exemap->map);
+      g_ptr_array_remove_index_fast (exe->exemaps, i);
+      preload_exemap_free (exemap, NULL);
+      changed = TRUE;
+    } else {
+      g_hash_table_add (known, exemap->map);
+    }
+  }
+
+  for (i = 0; i < snapshot->len; i++) {
+    preload_exemap_t *exemap = g_ptr_array_index (snapshot, i);
+
+    if (g_hash_table_add (known, exemap->map)) {
+      exemap->prob = EXEMAP_RATE;
+      g_ptr_array_add (exe->exemaps, exemap);
+      exe_add_map_size (exemap, exe);
+      changed = TRUE;
+    } else {
+      preload_exemap_free (exemap, NULL);
+    }
+  }
+
+  g_ptr_array_free (snapshot, TRUE);
+  g_hash_table_destroy (known);
+  g_hash_table_destroy (current);
+
+  if (changed)
+    state->model_generation++;
+  return changed;
+}
+
+
 static void
 shift_preload_markov_new (gpointer G_GNUC_UNUSED key, preload_exe_t *a, preload_exe_t *b)
 {
-  if (a != b)
+  /* members of a cluster have no chains, their leader's stand for them */
+  if (a != b && !a->cluster)
     preload_markov_new (a, b, TRUE);
 }
 
@@ -164,8 +258,11 @@ preload_state_register_exe (preload_exe_t *exe, gboolean create_markovs)
   g_return_if_fail (!g_hash_table_lookup (state->exes, exe->path));
 
   exe->seq = ++(state->exe_seq);
+  state->model_generation++;
   if (create_markovs && state->exes) {
     g_hash_table_foreach (state->exes, (GHFunc)shift_preload_markov_new, exe);
+  } else {
+    state->chainless = TRUE;
   }
   g_hash_table_insert (state->exes, exe->path, exe);
 }
@@ -179,6 +276,12 @@ preload_state_unregister_exe (preload_exe_t *exe)
   g_return_if_fail (g_hash_table_lookup (state->exes, exe->path));
 
   g_hash_table_steal (state->exes, exe->path);
+  state->model_generation++;
+  state->free_generation++;
+  proc_cache_forget (exe);
+  preload_spawn_forget (exe);
+  preload_cluster_forget (exe);
+  preload_profile_forget (exe);
 
   preload_exe_free (exe);
 }
@@ -10,6 +10,7 @@
 #define EXE_H
 
 #include <time.h>
+#include <sys/types.h>
 #include <glib.h>
 #include "map.h"
 
@@ -32,9 +33,15 @@ typedef struct _preload_exe_t
 {
   char *path; /* absolute path of the executable. */
   time_t time; /* total time that this has been running, ever. */
-  time_t update_time; /* last time it was probed. */
+  time_t update_time; /* last time it was seen running. */
   GPtrArray *markovs; /* set of markov chains with other exes. */
   GPtrArray *exemaps; /* set of exemap structures. */
+  GPtrArray *spawns; /* children it was seen starting, preload_spawn_t. */
+  double frecency; /* starts, decayed to frecency_time. */
+  int frecency_time; /* state time frecency was last decayed to. */
+  float frecency_hour[24]; /* frecency by local hour of day of the start. */
+  float *logistic; /* weights of the logistic engine, or NULL. */
+  struct _preload_exe_t *cluster; /* leader of the cluster it is in, or NULL. */
 
   /* runtime: */
   size_t size; /* sum of the size of the maps, in bytes. */
@@ -42,6 +49,16 @@ typedef struct _preload_exe_t
   time_t change_timestamp; /* time started/stopped running. */
   double lnprob; /* log-probability of NOT being needed in next period. */
   gint64 seq; /* unique exe sequence number. */
+  pid_t pid; /* a process of it seen by the last scan. */
+  long long cputime; /* cpu time of pid, in clock ticks. */
+  time_t idle_timestamp; /* last time pid was seen using cpu. */
+  time_t cold_timestamp; /* last time its memory was aged out. */
+  int pidfd; /* a process of it we get notified about exiting, or -1. */
+  guint exit_watch; /* main loop source watching pidfd. */
+  unsigned int exit_scan; /* latest scan taken when pidfd saw it stop. */
+  time_t maps_timestamp; /* last time its maps were read from pid. */
+  int logistic_since; /* its time-since-run feature, -1 if it was running. */
+  time_t seen_timestamp; /* time it was first seen, -1 if not known. */
 } preload_exe_t;
 
 /* Check if executable is currently running (implemented in exe.c) */
@@ -52,6 +69,9 @@ gboolean exe_is_running(preload_exe_t *exe);
 preload_exe_t * preload_exe_new (const char *path, gboolean running, GPtrArray *exemaps);
 void preload_exe_free (preload_exe_t *exe);
 preload_exemap_t * preload_exemap_new_from_exe (preload_exe_t *exe, preload_map_t *map);
+/* folds a later snapshot of the exe's maps into its exemaps; consumes
+ * snapshot.  returns whether the set of exemaps changed. */
+gboolean preload_exe_update_exemaps (preload_exe_t *exe, GPtrArray *snapshot);
 
 /* Exemap functions */
 preload_exemap_t * preload_exemap_new (preload_map_t *map);
@@ -15,6 +15,19 @@
 #include "log.h"
 
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/syscall.h>
+
+/* syscall numbers are the same on all architectures using the generic table */
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_process_madvise
+#define SYS_process_madvise 440
+#endif
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
 /* Static flag for MADV_FREE support (cached after first check) */
 static int madv_free_checked = 0;
@@ -117,3 +130,61 @@ preload_evacuate_file_pages(int fd, off_t offset, off_t length)
   return ENOSYS;
 #endif
 }
+
+int
+preload_file_residency(int fd, off_t offset, size_t length)
+{
+  size_t page_size = getpagesize();
+  off_t aligned_offset = offset & ~(off_t)(page_size - 1);
+  size_t pages, resident = 0, i;
+  unsigned char *vec;
+  void *addr;
+  int ret = -1;
+
+  length += offset - aligned_offset;
+  pages = (length + page_size - 1) / page_size;
+  if (!pages)
+    return 100;
+
+  addr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, aligned_offset);
+  if (addr == MAP_FAILED)
+    return -1;
+
+  vec = g_malloc(pages);
+  if (mincore(addr, length, vec) == 0) {
+    for (i = 0; i < pages; i++)
+      resident += vec[i] & 1;
+    ret = (int)(resident * 100 / pages);
+  }
+
+  g_free(vec);
+  munmap(addr, length);
+  return ret;
+}
+
+int
+preload_pidfd_open(pid_t pid)
+{
+  return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+ssize_t
+preload_process_madvise(int pidfd, const struct iovec *iov, size_t n, int advice)
+{
+  ssize_t total = 0;
+  
+  while (n > 0) {
+    size_t batch = n > IOV_MAX ? IOV_MAX : n;
+    ssize_t ret;
+    
+    ret = syscall(SYS_process_madvise, pidfd, iov, batch, advice, 0);
+    if (ret < 0)
+      return total ? total : -1;
+    
+    total += ret;
+    iov += batch;
+    n -= batch;
+  }
+  
+  return total;
+}
@@ -14,6 +14,8 @@
 #define MADVISE_UTILS_H
 
 #include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include <stddef.h>
 
 /*
@@ -72,4 +74,60 @@ int preload_evacuate_file_pages(int fd, off_t offset, off_t length);
  */
 int preload_check_madv_free_support(void);
 
+/*
+ * preload_file_residency - Measure how much of a file range is cached
+ *
+ * Maps the range and asks mincore(2) which of its pages are in the page
+ * cache.  Nothing is read.  Since Linux 5.2 mincore only reports the page
+ * cache for files the caller may write to (root may); for others it sees
+ * no page resident.
+ *
+ * @fd:     File descriptor
+ * @offset: Start offset in file
+ * @length: Length of region in bytes
+ *
+ * Returns: percentage of pages resident, or -1 on error (check errno)
+ */
+int preload_file_residency(int fd, off_t offset, size_t length);
+
+/*
+ * Remote memory advice.
+ *
+ * process_madvise(2) (Linux 5.10+) applies advice to another process'
+ * address space through a pidfd.  With MADV_WILLNEED this faults swapped
+ * out anonymous pages back in and starts readahead on file ranges, so a
+ * running but idle application does not stall when the user returns to
+ * it; MADV_COLD/MADV_PAGEOUT age out memory of an application that is
+ * not expected back.  Requires CAP_SYS_NICE and ptrace read access to
+ * the target.
+ */
+
+/* Reclaim hints for process_madvise (Linux 5.4+) */
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+/*
+ * preload_pidfd_open - Obtain a pidfd for @pid
+ *
+ * Returns: pidfd on success, -1 on error (check errno)
+ */
+int preload_pidfd_open(pid_t pid);
+
+/*
+ * preload_process_madvise - Apply @advice to ranges of another process
+ *
+ * @pidfd:  pidfd of the target process
+ * @iov:    Ranges in the target's address space
+ * @n:      Number of ranges (batched internally to IOV_MAX)
+ * @advice: MADV_* advice, e.g. MADV_WILLNEED
+ *
+ * Returns: bytes advised, or -1 on error (check errno).  ENOSYS/EINVAL
+ * mean the kernel does not support the call or the advice.
+ */
+ssize_t preload_process_madvise(int pidfd, const struct iovec *iov, size_t n, int advice);
+
 #endif /* MADVISE_UTILS_H */
@@ -24,6 +24,7 @@
 #include "common.h"
 #include "map.h"
 #include "state.h"
+#include "readahead.h"
 
 /* Access to global state */
 extern preload_state_t state[1];
@@ -36,6 +37,7 @@ preload_state_register_map (preload_map_t *map)
   g_return_if_fail (!g_hash_table_lookup (state->maps, map));
 
   map->seq = ++(state->map_seq);
+  state->model_generation++;
   g_hash_table_insert (state->maps, map, GINT_TO_POINTER (1));
   g_ptr_array_add (state->maps_arr, map);
 }
@@ -48,6 +50,8 @@ preload_state_unregister_map (preload_map_t *map)
 
   g_ptr_array_remove (state->maps_arr, map);
   g_hash_table_remove (state->maps, map);
+  state->model_generation++;
+  state->free_generation++;
 }
 
 
@@ -76,6 +80,7 @@ preload_map_free (preload_map_t *map)
   g_return_if_fail (map->refcount == 0);
   g_return_if_fail (map->path);
 
+  preload_readahead_forget_map (map);
   g_free (map->path);
   map->path = NULL;
   g_free (map);
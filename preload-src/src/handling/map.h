@@ -30,6 +30,12 @@ typedef struct _preload_map_t
   gint64 seq; /* unique map sequence number. */
   int block; /* on-disk location of the start of the map. */
   int priv; /* for private local use of functions. */
+  gboolean prefetched; /* read ahead, and neither used nor dropped since. */
+  gint64 cached; /* monotonic time it was last read ahead or found cached, or 0. */
+  dev_t cached_dev; /* identity of the file then, so a replaced one is read again. */
+  ino_t cached_ino;
+  time_t cached_mtime;
+  gboolean baseline; /* used by most exes, so kept cached instead of bid in. */
 } preload_map_t;
 
 
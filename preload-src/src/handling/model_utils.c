@@ -10,9 +10,15 @@
 #include "log.h"
 #include "state.h"
 #include "exe.h"
+#include "canon.h"
+#include "ephemeral.h"
 
 #include <sys/stat.h>
 
+/* how long a canonical exe whose real path is gone is kept after it last
+ * ran, waiting for its new version to show up */
+#define CANON_GONE_KEEP (14 * 24 * 3600)
+
 int
 preload_validate_exe(const char *path, ino_t last_inode, time_t last_mtime)
 {
@@ -101,7 +107,17 @@ check_exe_validity(gpointer key, preload_exe_t *exe, cleanup_context_t *ctx)
   }
 
   /* Validate the executable */
-  status = preload_validate_exe(exe->path, 0, 0);
+  status = preload_validate_exe(preload_canon_realpath(exe->path), 0, 0);
+
+  if (status == -1 && preload_canon_is_key(exe->path)
+      && state->time - exe->update_time < CANON_GONE_KEEP) {
+    /* Versioned install (e.g. nix store): the old path goes away on every
+     * upgrade.  Keep what we learned until the new version shows up, but
+     * not for packages that are gone for good. */
+    g_debug("Canonical exe %s not found at %s, keeping it",
+            exe->path, preload_canon_realpath(exe->path));
+    return;
+  }
   
   if (status == -1) {
     /* File no longer exists - mark for removal */
@@ -143,6 +159,8 @@ remove_invalid_exe(preload_exe_t *exe, cleanup_context_t *ctx)
   }
 
   g_message("Removing deleted executable from model: %s", exe->path);
+  preload_ephemeral_vanished(exe->path, exe->seen_timestamp < 0 ? -1
+                             : (int)(state->time - exe->seen_timestamp));
   preload_state_unregister_exe(exe);
   ctx->removed_count++;
 }
@@ -24,9 +24,15 @@
 #include "readahead.h"
 #include "log.h"
 #include "conf.h"
+#include "canon.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "timeline.h"
+#include "madvise_utils.h"
 
 #include <sys/ioctl.h>
 #include <sys/wait.h>
+#include <signal.h>
 #include <linux/fs.h>
 #include <sys/syscall.h>
 #include <unistd.h>
@@ -45,7 +51,7 @@ set_block(preload_map_t *file, gboolean use_inode)
   /* in case we can get block, set to 0 to not retry */
   file->block = 0;
 
-  fd = open(file->path, O_RDONLY);
+  fd = open(preload_canon_realpath(file->path), O_RDONLY);
   if (fd < 0)
     return;
   
@@ -107,18 +113,579 @@ map_block_compare (const preload_map_t **pa, const preload_map_t **pb)
   return i;
 }
 
-static int procs = 0;
+/*
+ * Prefetch requests are queued and handed to forked readers, and the main
+ * loop only learns about their exit through child watches, so it never
+ * waits on prefetch I/O.  Every reader has a deadline; one that misses it
+ * is killed, and a mount whose readers keep timing out (hung NFS, failing
+ * disk) is quarantined for a while.  Queued and in-flight work can be
+ * dropped at any time with preload_readahead_cancel().
+ */
+
+#define QUARANTINE_TIMEOUTS 3	/* timeouts within a period before quarantine */
+#define QUARANTINE_PERIOD 600	/* seconds */
+
+/*
+ * Not every filesystem is worth the same effort, so each mount gets a
+ * class from the filesystem type mountinfo lists for it.  Files on tmpfs
+ * and ramfs are in memory already and are left alone.  Reading from
+ * squashfs, erofs or a compressed btrfs costs CPU to decompress, so those
+ * reads share compressedbudget per round.  Network filesystems and FUSE
+ * may stall or cost traffic: their reads share remotebudget, at most
+ * remoteprocs of them run at a time, and each gets remotetimeout.  Only
+ * readers touch their files: the daemon neither stats, probes nor looks
+ * up blocks of them, so a hung server cannot stall its loop.
+ */
+
+typedef enum
+{
+  FS_LOCAL,
+  FS_MEMORY,	/* tmpfs, ramfs */
+  FS_COMPRESSED,	/* squashfs, erofs, compressed btrfs */
+  FS_REMOTE	/* network filesystems and FUSE */
+} fs_class_t;
+
+typedef struct
+{
+  char *dir;
+  fs_class_t fsclass;
+} mountpoint_t;
+
+static const mountpoint_t *find_mount (const char *path);
+
+/*
+ * The same maps top the prediction cycle after cycle, and reading them
+ * again while they are still cached costs an open and a readahead each
+ * for nothing.  So a map read ahead is not read again until it is likely
+ * to have been evicted, that is for cache_ttl.  The TTL is learnt: once
+ * it runs out for a map, up to prefetchrecheck such maps per cycle, most
+ * likely first, are looked up with mincore(2) instead of read.  One still
+ * cached lived at least that long and stretches the TTL, and is left
+ * alone for another TTL; one gone shortens it and is read.  Expired maps
+ * beyond that sample are read without looking.  Maps left alone still
+ * take their share of the prefetch budget, which the caller computes.
+ */
+
+#define CACHE_TTL_INITIAL 3	/* cycles */
+#define CACHE_TTL_MAX 3600	/* seconds */
+#define CACHE_RESIDENT 90	/* percent of pages cached to count as cached */
+#define RESIDENCY_CHECKS 64	/* baseline maps looked up per round, at most */
+
+typedef struct
+{
+  char *path;
+  char *file; /* real path of path, resolved before the reader is forked */
+  size_t offset, length;
+  GPtrArray *maps; /* maps the range covers, stamped cached once read */
+  char *mount; /* mount point the file lives on */
+  fs_class_t fsclass; /* of that mount */
+
+  /* metadata warming requests have these instead of a path */
+  char **statpaths; /* files to look up */
+  char **listdirs; /* directories to read */
+} prefetch_request_t;
+
+typedef struct
+{
+  pid_t pid;
+  prefetch_request_t *req;
+  gint64 started; /* monotonic, microseconds */
+  gint64 deadline; /* monotonic, microseconds */
+  gboolean killed;
+} prefetch_child_t;
+
+typedef struct
+{
+  int timeouts; /* since @since */
+  gint64 since; /* monotonic, microseconds */
+  gint64 until; /* monotonic, microseconds; 0 if not quarantined */
+} mount_health_t;
+
+static GQueue pending = G_QUEUE_INIT;
+static GHashTable *inflight; /* pid -> prefetch_child_t */
+static GHashTable *mounts_health; /* mount point -> mount_health_t */
+static GPtrArray *mountpoints; /* of mountpoint_t, in mountinfo order */
+static guint watchdog;
+static gint64 cache_ttl; /* microseconds */
 
 static void
-wait_for_children (void)
+request_free (prefetch_request_t *req)
 {
-  /* wait for child processes to terminate */
-  while (procs > 0)
-    {
-      int status;
-      if (wait (&status) > 0)
-	procs--;
+  g_free (req->path);
+  g_free (req->file);
+  if (req->maps)
+    g_ptr_array_free (req->maps, TRUE);
+  g_free (req->mount);
+  g_strfreev (req->statpaths);
+  g_strfreev (req->listdirs);
+  g_free (req);
+}
+
+static gboolean
+map_is_remote (const preload_map_t *map)
+{
+  return find_mount (preload_canon_realpath (map->path))->fsclass == FS_REMOTE;
+}
+
+/* map was read ahead, or found cached, at now: stamps it, with the
+ * identity of the file it is in.  remote files are stamped blind. */
+static void
+mark_cached (preload_map_t *map, gint64 now)
+{
+  struct stat st;
+
+  if (map_is_remote (map)) {
+    map->cached = now;
+    map->cached_dev = map->cached_ino = map->cached_mtime = 0;
+    return;
+  }
+
+  if (0 > stat (preload_canon_realpath (map->path), &st)) {
+    map->cached = 0;
+    return;
+  }
+
+  map->cached = now;
+  map->cached_dev = st.st_dev;
+  map->cached_ino = st.st_ino;
+  map->cached_mtime = st.st_mtime;
+}
+
+/* whether the file map is in is still the one it was stamped cached
+ * from; a replaced one has nothing of it in the cache.  remote files are
+ * trusted for their TTL. */
+static gboolean
+same_file (const preload_map_t *map)
+{
+  struct stat st;
+
+  if (map_is_remote (map))
+    return TRUE;
+
+  return 0 == stat (preload_canon_realpath (map->path), &st)
+	 && st.st_dev == map->cached_dev && st.st_ino == map->cached_ino
+	 && st.st_mtime == map->cached_mtime;
+}
+
+/* what a request was for may not have made it into the cache */
+static void
+request_uncache (prefetch_request_t *req)
+{
+  guint i;
+
+  for (i = 0; req->maps && i < req->maps->len; i++)
+    ((preload_map_t *)g_ptr_array_index (req->maps, i))->cached = 0;
+}
+
+/* drops queued data requests, or metadata ones */
+static void
+drop_pending (gboolean metadata)
+{
+  GQueue keep = G_QUEUE_INIT;
+  prefetch_request_t *req;
+
+  while ((req = g_queue_pop_head (&pending))) {
+    if (!req->statpaths == !metadata) {
+      request_uncache (req);
+      request_free (req);
+    } else
+      g_queue_push_tail (&keep, req);
+  }
+
+  pending = keep;
+}
+
+static void
+mountpoint_free (mountpoint_t *mnt)
+{
+  g_free (mnt->dir);
+  g_free (mnt);
+}
+
+static gboolean
+is_one_of (const char *fstype, const char * const *types)
+{
+  for (; *types; types++)
+    if (!strcmp (fstype, *types))
+      return TRUE;
+  return FALSE;
+}
+
+static fs_class_t
+fs_class (const char *fstype, const char *options)
+{
+  static const char * const memory[] = { "tmpfs", "ramfs", NULL };
+  static const char * const compressed[] = { "squashfs", "erofs", "cramfs", NULL };
+  static const char * const remote[] = { "nfs", "nfs4", "cifs", "smb3", "smbfs", "9p",
+					 "ceph", "glusterfs", "afs", "lustre", "fuse", "fuseblk", NULL };
+
+  if (is_one_of (fstype, memory))
+    return FS_MEMORY;
+  if (is_one_of (fstype, compressed)
+      || (!strcmp (fstype, "btrfs") && strstr (options, "compress")))
+    return FS_COMPRESSED;
+  if (is_one_of (fstype, remote) || g_str_has_prefix (fstype, "fuse."))
+    return FS_REMOTE;
+  return FS_LOCAL;
+}
+
+/* mount points from /proc/self/mountinfo, with the class of what is
+ * mounted there.  looking a path up here never touches the filesystem,
+ * which may be the one that hangs. */
+static void
+load_mountpoints (void)
+{
+  FILE *in;
+  char buffer[4096];
+
+  if (mountpoints)
+    g_ptr_array_set_size (mountpoints, 0);
+  else
+    mountpoints = g_ptr_array_new_with_free_func ((GDestroyNotify)mountpoint_free);
+
+  in = fopen ("/proc/self/mountinfo", "r");
+  if (!in)
+    return;
+
+  while (fgets (buffer, sizeof (buffer), in)) {
+    char mnt[FILELEN], opts[1024], fstype[64], superopts[1024];
+    char *src, *dst, *rest;
+    mountpoint_t *mount;
+
+    if (2 != sscanf (buffer, "%*d %*d %*u:%*u %*s %"FILELENSTR"s %1023s", mnt, opts))
+      continue;
+
+    /* optional fields end with a lone dash, the type comes next */
+    *fstype = *superopts = '\0';
+    if ((rest = strstr (buffer, " - ")))
+      sscanf (rest, " - %63s %*s %1023s", fstype, superopts);
+
+    /* unescape \040 and friends */
+    for (src = dst = mnt; *src; dst++) {
+      if (src[0] == '\\' && src[1] >= '0' && src[1] <= '3'
+	  && src[2] >= '0' && src[2] <= '7' && src[3] >= '0' && src[3] <= '7') {
+	*dst = (char)((src[1] - '0') * 64 + (src[2] - '0') * 8 + (src[3] - '0'));
+	src += 4;
+      } else {
+	*dst = *src++;
+      }
+    }
+    *dst = '\0';
+
+    mount = g_new (mountpoint_t, 1);
+    mount->dir = g_strdup (mnt);
+    mount->fsclass = fs_class (fstype, superopts);
+    if (mount->fsclass == FS_LOCAL)
+      mount->fsclass = fs_class (fstype, opts);
+    g_ptr_array_add (mountpoints, mount);
+  }
+
+  fclose (in);
+}
+
+/* the mount path lives on; of those stacked on the same point, the last
+ * mounted */
+static const mountpoint_t *
+find_mount (const char *path)
+{
+  static const mountpoint_t root = { "/", FS_LOCAL };
+  const mountpoint_t *best = &root;
+  size_t bestlen = 0;
+  guint i;
+
+  for (i = 0; mountpoints && i < mountpoints->len; i++) {
+    const mountpoint_t *mnt = g_ptr_array_index (mountpoints, i);
+    size_t len = strlen (mnt->dir);
+
+    if (len >= bestlen && !strncmp (path, mnt->dir, len)
+	&& (len == 1 || path[len] == '/' || !path[len])) {
+      best = mnt;
+      bestlen = len;
+    }
+  }
+
+  return best;
+}
+
+static mount_health_t *
+mount_health (const char *mount)
+{
+  mount_health_t *health;
+
+  if (!mounts_health)
+    mounts_health = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  health = g_hash_table_lookup (mounts_health, mount);
+  if (!health) {
+    health = g_new0 (mount_health_t, 1);
+    g_hash_table_insert (mounts_health, g_strdup (mount), health);
+  }
+
+  return health;
+}
+
+gboolean
+preload_readahead_quarantined (const char *mount, gint64 now)
+{
+  mount_health_t *health;
+
+  if (!mounts_health || !(health = g_hash_table_lookup (mounts_health, mount)))
+    return FALSE;
+
+  if (health->until && health->until <= now) {
+    g_message ("prefetch quarantine of %s lifted", mount);
+    health->until = 0;
+    health->timeouts = 0;
+    health->since = 0;
+  }
+
+  return health->until != 0;
+}
+
+void
+preload_readahead_timed_out (const char *mount, gint64 now)
+{
+  mount_health_t *health = mount_health (mount);
+  gint64 period = (gint64)QUARANTINE_PERIOD * G_USEC_PER_SEC;
+
+  /* readers that do finish don't clear the count: a failing disk serves
+   * some reads fine and hangs on others */
+  if (now - health->since > period) {
+    health->since = now;
+    health->timeouts = 0;
+  }
+
+  if (++health->timeouts >= QUARANTINE_TIMEOUTS && !health->until) {
+    g_warning ("prefetch on %s timed out %d times, quarantining it for %ds",
+	       mount, health->timeouts, QUARANTINE_PERIOD);
+    health->until = now + period;
+  }
+}
+
+static void
+set_idle_ioprio (void)
+{
+  /* Set IO Priority to IDLE to avoid slowing down foreground apps */
+  syscall(SYS_ioprio_set, 1, 0, (IOPRIO_CLASS_IDLE << 13) | 7);
+}
+
+static void dispatch (void);
+static int process_file (const char *file, size_t offset, size_t length);
+static void process_metadata (char * const *statpaths, char * const *listdirs);
+
+static void
+child_exited (GPid pid, gint status, gpointer G_GNUC_UNUSED user_data)
+{
+  prefetch_child_t *child;
+  gint64 now = g_get_monotonic_time ();
+  guint i;
+
+  g_spawn_close_pid (pid);
+
+  if (inflight && (child = g_hash_table_lookup (inflight, GINT_TO_POINTER (pid)))) {
+    /* only a reader that got through read its maps in */
+    if (!child->killed && WIFEXITED (status) && WEXITSTATUS (status) == 0)
+      for (i = 0; child->req->maps && i < child->req->maps->len; i++)
+	mark_cached (g_ptr_array_index (child->req->maps, i), now);
+    else
+      request_uncache (child->req);
+
+    PRELOAD_TRACE (prefetch_done, child->req->path, child->req->offset, child->req->length,
+		   g_get_monotonic_time () - child->started, child->killed);
+    preload_timeline_request (child->req->mount ? child->req->mount : "metadata", pid, child->started,
+			      child->req->path, child->req->offset, child->req->length, child->killed);
+    g_hash_table_remove (inflight, GINT_TO_POINTER (pid));
+  }
+  dispatch ();
+}
+
+static void
+kill_child (gpointer G_GNUC_UNUSED key, gpointer value, gpointer G_GNUC_UNUSED user_data)
+{
+  prefetch_child_t *child = (prefetch_child_t *)value;
+
+  if (!child->killed) {
+    kill (child->pid, SIGKILL);
+    child->killed = TRUE;
+  }
+}
+
+static gboolean
+watchdog_check (gpointer G_GNUC_UNUSED user_data)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  gint64 now = g_get_monotonic_time ();
+
+  if (conf->system.cancelpressure > 0
+      && preload_telemetry_memory_pressure () >= conf->system.cancelpressure) {
+    preload_readahead_cancel ("memory pressure");
+    return G_SOURCE_CONTINUE; /* until killed readers are reaped */
+  }
+
+  g_hash_table_iter_init (&iter, inflight);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    prefetch_child_t *child = (prefetch_child_t *)value;
+
+    if (child->killed || now < child->deadline)
+      continue;
+
+    g_debug ("prefetch of %s timed out, killing reader %d",
+	     child->req->path ? child->req->path : "metadata", child->pid);
+    kill_child (key, child, NULL);
+    if (child->req->mount)
+      preload_readahead_timed_out (child->req->mount, now);
+  }
+
+  if (g_hash_table_size (inflight) || !g_queue_is_empty (&pending))
+    return G_SOURCE_CONTINUE;
+
+  watchdog = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void
+child_free (gpointer data)
+{
+  prefetch_child_t *child = (prefetch_child_t *)data;
+
+  request_free (child->req);
+  g_free (child);
+}
+
+/* takes the first queued request that may start now: one on a remote
+ * filesystem waits while remoteprocs readers of those are running */
+static prefetch_request_t *
+next_request (void)
+{
+  GQueue waiting = G_QUEUE_INIT;
+  GHashTableIter iter;
+  gpointer value;
+  prefetch_request_t *req, *wait;
+  int remote = 0;
+
+  g_hash_table_iter_init (&iter, inflight);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    if (((prefetch_child_t *)value)->req->fsclass == FS_REMOTE)
+      remote++;
+
+  while ((req = g_queue_pop_head (&pending))
+	 && req->fsclass == FS_REMOTE && remote >= conf->system.remoteprocs)
+    g_queue_push_tail (&waiting, req);
+
+  /* those keep their place */
+  while ((wait = g_queue_pop_tail (&waiting)))
+    g_queue_push_head (&pending, wait);
+
+  return req;
+}
+
+/* hands queued requests to readers, up to maxprocs of them at a time */
+static void
+dispatch (void)
+{
+  int maxprocs = conf->system.maxprocs;
+  prefetch_request_t *req;
+
+  if (!inflight)
+    inflight = g_hash_table_new_full (NULL, NULL, NULL, child_free);
+
+  while ((int)g_hash_table_size (inflight) < maxprocs && (req = next_request ())) {
+    prefetch_child_t *child;
+    int timeout;
+    pid_t pid;
+
+    if (req->mount && preload_readahead_quarantined (req->mount, g_get_monotonic_time ())) {
+      request_uncache (req);
+      request_free (req);
+      continue;
+    }
+
+    pid = fork ();
+    if (pid == -1) {
+      /* ignore error, try again next time */
+      g_queue_push_head (&pending, req);
+      break;
     }
+
+    if (pid == 0) {
+      /* reader: do the work and leave without touching parent state.
+       * the scan thread may hold locks (malloc, stdio, GLib, the proc
+       * cache), so only raw syscalls on what the request carries may be
+       * made here: every path was resolved before the fork. */
+      if (req->statpaths)
+	process_metadata (req->statpaths, req->listdirs);
+      else if (0 > process_file (req->file, req->offset, req->length))
+	_exit (1);
+      _exit (0);
+    }
+
+    child = g_new0 (prefetch_child_t, 1);
+    child->pid = pid;
+    child->req = req;
+    child->started = g_get_monotonic_time ();
+    timeout = req->fsclass == FS_REMOTE ? conf->system.remotetimeout : conf->system.prefetchtimeout;
+    child->deadline = child->started + (gint64)MAX (timeout, 1) * G_USEC_PER_SEC;
+    PRELOAD_TRACE (prefetch_issue, req->path, req->offset, req->length, pid);
+    g_hash_table_insert (inflight, GINT_TO_POINTER (pid), child);
+    g_child_watch_add (pid, child_exited, NULL);
+  }
+
+  if (!watchdog && (g_hash_table_size (inflight) || !g_queue_is_empty (&pending)))
+    watchdog = g_timeout_add_seconds (1, watchdog_check, NULL);
+}
+
+void
+preload_readahead_cancel (const char *reason)
+{
+  guint dropped = g_queue_get_length (&pending);
+  guint killed = inflight ? g_hash_table_size (inflight) : 0;
+  guint i;
+
+  if (!dropped && !killed)
+    return;
+
+  g_debug ("cancelling prefetch (%s): %u queued, %u in flight", reason, dropped, killed);
+
+  /* whatever those were for may not have made it into the cache */
+  for (i = 0; state->maps_arr && i < state->maps_arr->len; i++)
+    ((preload_map_t *)g_ptr_array_index (state->maps_arr, i))->cached = 0;
+
+  drop_pending (FALSE);
+  drop_pending (TRUE);
+
+  /* readers are reaped by their child watch as they die */
+  if (inflight)
+    g_hash_table_foreach (inflight, kill_child, NULL);
+}
+
+static void
+request_forget_map (prefetch_request_t *req, preload_map_t *map)
+{
+  if (req->maps)
+    while (g_ptr_array_remove_fast (req->maps, map))
+      ;
+}
+
+void
+preload_readahead_forget_map (preload_map_t *map)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  g_queue_foreach (&pending, (GFunc)request_forget_map, map);
+  if (!inflight)
+    return;
+
+  g_hash_table_iter_init (&iter, inflight);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    request_forget_map (((prefetch_child_t *)value)->req, map);
+}
+
+int
+preload_readahead_inflight (void)
+{
+  return (inflight ? g_hash_table_size (inflight) : 0) + g_queue_get_length (&pending);
 }
 
 /*
@@ -187,55 +754,231 @@ try_readahead_with_fallback(int fd, off_t offset, size_t length)
   return ret;
 }
 
-static void
-process_file(const char *path, size_t offset, size_t length)
+/* file is a real path; may run in a forked reader, so syscalls only.
+ * returns 0 if the range was read ahead, -1 if not */
+static int
+process_file (const char *file, size_t offset, size_t length)
 {
   int fd = -1;
-  int maxprocs = conf->system.maxprocs;
+  int ret = -1;
+
+  fd = open(file,
+	      O_RDONLY
+	    | O_NOCTTY
+#ifdef O_NOATIME
+	    | O_NOATIME
+#endif
+	   );
+  if (fd >= 0)
+    {
+      /* Use readahead with madvise fallback */
+      ret = try_readahead_with_fallback(fd, offset, length);
+
+      close (fd);
+    }
+
+  return ret;
+}
 
-  if (procs >= maxprocs)
-    wait_for_children ();
+/* looking files up pulls their dentries and inodes, and those of every
+ * directory on the way, into the caches.  reading the directories they
+ * are in also makes lookups of their siblings (locales, icons, plugins)
+ * cheap, negative ones included. */
+static void
+process_metadata (char * const *statpaths, char * const *listdirs)
+{
+  char buf[32768];
 
-  if (maxprocs > 0)
+  for (; statpaths && *statpaths; statpaths++)
     {
-      /* parallel reading */
+#ifdef STATX_BASIC_STATS
+      struct statx stx;
+      statx (AT_FDCWD, *statpaths, AT_NO_AUTOMOUNT | AT_SYMLINK_NOFOLLOW,
+	     STATX_BASIC_STATS, &stx);
+#else
+      struct stat st;
+      lstat (*statpaths, &st);
+#endif
+    }
 
-      int status = fork();
+  for (; listdirs && *listdirs; listdirs++)
+    {
+      int fd = open (*listdirs, O_RDONLY | O_DIRECTORY | O_NOCTTY
+#ifdef O_NOATIME
+		     | O_NOATIME
+#endif
+		    );
+      if (fd < 0)
+	continue;
+      while (syscall (SYS_getdents64, fd, buf, sizeof (buf)) > 0)
+	;
+      close (fd);
+    }
+}
+
+/* the paths of a metadata round that live on one mount */
+typedef struct
+{
+  const mountpoint_t *mount;
+  GPtrArray *statpaths;
+  GPtrArray *listdirs;
+} metadata_batch_t;
+
+/* whether paths on mount are left out of a metadata round */
+static gboolean
+metadata_skipped (const mountpoint_t *mount)
+{
+  return mount->fsclass == FS_MEMORY
+	 || (mount->fsclass == FS_REMOTE && conf->system.remoteprocs <= 0 && conf->system.maxprocs > 0)
+	 || preload_readahead_quarantined (mount->dir, g_get_monotonic_time ());
+}
 
-      if (status == -1)
+static metadata_batch_t *
+metadata_batch (GPtrArray *batches, const mountpoint_t *mount)
+{
+  metadata_batch_t *batch;
+  guint i;
+
+  for (i = 0; i < batches->len; i++)
+    {
+      batch = g_ptr_array_index (batches, i);
+      if (batch->mount == mount)
+	return batch;
+    }
+
+  batch = g_new0 (metadata_batch_t, 1);
+  batch->mount = mount;
+  batch->statpaths = g_ptr_array_new ();
+  batch->listdirs = g_ptr_array_new ();
+  g_ptr_array_add (batches, batch);
+  return batch;
+}
+
+int
+preload_readahead_metadata (GPtrArray *paths)
+{
+  GHashTable *seen;
+  GPtrArray *batches;
+  GQueue reqs = G_QUEUE_INIT;
+  prefetch_request_t *req;
+  int budget = conf->system.metabudget;
+  int queued = 0;
+  guint i;
+
+  set_idle_ioprio ();
+
+  /* a new round supersedes what was not started last time */
+  drop_pending (TRUE);
+
+  if (budget <= 0 || !paths->len)
+    return 0;
+
+  load_mountpoints ();
+
+  /* one request per mount, so a hung one times out and is quarantined
+   * alone, and remote ones count against remoteprocs */
+  seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  batches = g_ptr_array_new ();
+
+  for (i = 0; i < paths->len && queued < budget; i++)
+    {
+      const char *path = preload_canon_realpath (g_ptr_array_index (paths, i));
+      const mountpoint_t *mount = find_mount (path);
+      char *dir;
+
+      if (g_hash_table_contains (seen, path) || metadata_skipped (mount))
+	continue;
+
+      g_hash_table_add (seen, g_strdup (path));
+      g_ptr_array_add (metadata_batch (batches, mount)->statpaths, g_strdup (path));
+      queued++;
+
+      dir = g_path_get_dirname (path);
+      mount = find_mount (dir);
+      if (!g_hash_table_contains (seen, dir) && queued < budget && !metadata_skipped (mount))
         {
-	  /* ignore error, return */
-	  return;
+	  g_hash_table_add (seen, g_strdup (dir));
+	  g_ptr_array_add (metadata_batch (batches, mount)->listdirs, dir);
+	  queued++;
 	}
+      else
+	g_free (dir);
+    }
+
+  g_hash_table_destroy (seen);
 
-      /* return immediately in the parent */
-      if (status > 0)
+  g_debug ("warming metadata of %d paths on %u mounts", queued, batches->len);
+
+  for (i = 0; i < batches->len; i++)
+    {
+      metadata_batch_t *batch = g_ptr_array_index (batches, i);
+
+      g_ptr_array_add (batch->statpaths, NULL);
+      g_ptr_array_add (batch->listdirs, NULL);
+
+      if (conf->system.maxprocs <= 0)
+        {
+	  /* no parallel reading, done in-process as before */
+	  process_metadata ((char **)batch->statpaths->pdata, (char **)batch->listdirs->pdata);
+	  g_strfreev ((char **)g_ptr_array_free (batch->statpaths, FALSE));
+	  g_strfreev ((char **)g_ptr_array_free (batch->listdirs, FALSE));
+	}
+      else
         {
-	  procs++;
-	  return;
+	  req = g_new0 (prefetch_request_t, 1);
+	  req->statpaths = (char **)g_ptr_array_free (batch->statpaths, FALSE);
+	  req->listdirs = (char **)g_ptr_array_free (batch->listdirs, FALSE);
+	  req->mount = g_strdup (batch->mount->dir);
+	  req->fsclass = batch->mount->fsclass;
+	  g_queue_push_tail (&reqs, req);
 	}
+      g_free (batch);
     }
+  g_ptr_array_free (batches, TRUE);
 
-  fd = open(path,
-	      O_RDONLY
-	    | O_NOCTTY
-#ifdef O_NOATIME
-	    | O_NOATIME
-#endif
-	   );
-  if (fd >= 0)
+  if (!g_queue_is_empty (&reqs))
     {
-      /* Use readahead with madvise fallback */
-      try_readahead_with_fallback(fd, offset, length);
-
-      close (fd);
+      /* cheap, and data readahead goes faster with it done, so first */
+      while ((req = g_queue_pop_tail (&reqs)))
+	g_queue_push_head (&pending, req);
+      dispatch ();
     }
 
-  if (maxprocs > 0)
+  return queued;
+}
+
+/* queues the range of path covering maps; takes maps */
+static void
+queue_file (GQueue *queue, const char *path, size_t offset, size_t length, GPtrArray *maps)
+{
+  prefetch_request_t *req;
+  const mountpoint_t *mount;
+  /* canonical keys are read from wherever the file lives right now */
+  const char *file = preload_canon_realpath (path);
+  gint64 now;
+  guint i;
+
+  if (conf->system.maxprocs <= 0)
     {
-      /* we're in a child process, exit */
-      exit (0);
+      /* no parallel reading, done in-process as before */
+      now = g_get_monotonic_time ();
+      if (0 == process_file (file, offset, length))
+	for (i = 0; i < maps->len; i++)
+	  mark_cached (g_ptr_array_index (maps, i), now);
+      g_ptr_array_free (maps, TRUE);
+      return;
     }
+
+  mount = find_mount (file);
+  req = g_new0 (prefetch_request_t, 1);
+  req->path = g_strdup (path);
+  req->file = g_strdup (file);
+  req->offset = offset;
+  req->length = length;
+  req->maps = maps;
+  req->mount = g_strdup (mount->dir);
+  req->fsclass = mount->fsclass;
+  g_queue_push_tail (queue, req);
 }
 
 static void
@@ -259,7 +1002,13 @@ sort_by_block_or_inode (preload_map_t **files, int file_count)
 
       for (i=0; i<file_count; i++)
 	if (files[i]->block == -1)
-	  set_block (files[i], conf->system.sortstrategy == SORT_INODE);
+	  {
+	    /* remote files go first, in path order, unlooked-up */
+	    if (map_is_remote (files[i]))
+	      files[i]->block = 0;
+	    else
+	      set_block (files[i], conf->system.sortstrategy == SORT_INODE);
+	  }
     }
 
   /* Sorting by block. */
@@ -291,16 +1040,215 @@ sort_files (preload_map_t **files, int file_count)
   }
 }
 
+static int
+map_residency (const preload_map_t *map)
+{
+  int fd, ret;
+
+  fd = open (preload_canon_realpath (map->path), O_RDONLY | O_NOCTTY);
+  if (fd < 0)
+    return -1;
+
+  ret = preload_file_residency (fd, map->offset, map->length);
+  close (fd);
+  return ret;
+}
+
+/* a map still cached at age lived at least that long, one gone less.
+ * readahead of what is cached is cheap next to a miss on startup, so the
+ * TTL is pulled down harder than it is pushed up. */
+static void
+observe_lifetime (gint64 age, gboolean cached)
+{
+  gint64 estimate = cached ? age * 3 / 2 : age / 2;
+
+  cache_ttl += (estimate - cache_ttl) / 4;
+  cache_ttl = CLAMP (cache_ttl, (gint64)conf->model.cycle * G_USEC_PER_SEC,
+		     (gint64)CACHE_TTL_MAX * G_USEC_PER_SEC);
+}
+
+/* the baseline is looked up on its own terms, whether prefetchrecheck is
+ * on or not: a map found cached, or read, is trusted for the TTL learnt,
+ * or for the first guess at it before, and at most RESIDENCY_CHECKS of the
+ * others are looked up per round.  the rest wait for the next round. */
 int
-preload_readahead (preload_map_t **files, int file_count)
+preload_readahead_uncached (preload_map_t **maps, int count)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 ttl = cache_ttl;
+  int i, checked = 0, uncached = 0;
+
+  if (!ttl)
+    ttl = (gint64)CACHE_TTL_INITIAL * MAX (conf->model.cycle, 1) * G_USEC_PER_SEC;
+
+  for (i = 0; i < count; i++)
+    {
+      preload_map_t *map = maps[i];
+
+      if (map->cached && now - map->cached < ttl && same_file (map))
+	continue;
+
+      if (!map_is_remote (map))
+        {
+	  int resident;
+
+	  if (checked >= RESIDENCY_CHECKS)
+	    continue;
+	  checked++;
+
+	  /* one that cannot be looked up is not read blindly either */
+	  resident = map_residency (map);
+	  if (resident < 0)
+	    continue;
+	  if (resident >= CACHE_RESIDENT)
+	    {
+	      mark_cached (map, now);
+	      continue;
+	    }
+	}
+
+      /* known gone, so read without looking again */
+      map->cached = 0;
+      maps[i] = maps[uncached];
+      maps[uncached++] = map;
+    }
+
+  return uncached;
+}
+
+/* moves maps still likely cached past the returned count */
+static int
+skip_cached (preload_map_t **files, int file_count)
+{
+  gint64 now = g_get_monotonic_time ();
+  int i, checked = 0, skipped;
+
+  if (conf->system.prefetchrecheck <= 0)
+    return file_count;
+
+  if (!cache_ttl)
+    cache_ttl = (gint64)CACHE_TTL_INITIAL * conf->model.cycle * G_USEC_PER_SEC;
+
+  for (i = 0, skipped = 0; i < file_count - skipped; )
+    {
+      preload_map_t *map = files[i];
+      gboolean skip = FALSE;
+
+      if (map->cached)
+        {
+	  gint64 age = now - map->cached;
+
+	  if (age < cache_ttl)
+	    skip = same_file (map);
+	  else if (checked < conf->system.prefetchrecheck && !map_is_remote (map))
+	    {
+	      int resident = map_residency (map);
+
+	      checked++;
+	      if (resident >= 0)
+	        {
+		  skip = resident >= CACHE_RESIDENT;
+		  observe_lifetime (age, skip);
+		  if (skip)
+		    mark_cached (map, now);
+		}
+	    }
+	}
+
+      if (skip)
+        {
+	  skipped++;
+	  files[i] = files[file_count - skipped];
+	  files[file_count - skipped] = map;
+	}
+      else
+        {
+	  /* stamped once its reader got through */
+	  map->cached = 0;
+	  i++;
+	}
+    }
+
+  if (skipped || checked)
+    g_debug ("%d maps still cached, %d looked up, TTL %" G_GINT64_FORMAT "s",
+	     skipped, checked, cache_ttl / G_USEC_PER_SEC);
+
+  return file_count - skipped;
+}
+
+/* keeps files on compressed and remote filesystems within their budgets
+ * for the round, most wanted first; moves the rest past the returned count */
+static int
+fit_fs_budgets (preload_map_t **files, int file_count)
+{
+  gint64 compressed = conf->system.compressedbudget;
+  gint64 remote = conf->system.remotebudget;
+  int i, kept = 0, dropped;
+
+  for (i = 0; i < file_count; i++)
+    {
+      preload_map_t *map = files[i];
+      gint64 *budget = NULL;
+
+      switch (find_mount (preload_canon_realpath (map->path))->fsclass) {
+	case FS_COMPRESSED: budget = &compressed; break;
+	case FS_REMOTE: budget = &remote; break;
+	default: break;
+      }
+
+      /* a negative budget is no limit */
+      if (budget && *budget >= 0)
+        {
+	  if ((gint64)map->length > *budget)
+	    {
+	      /* not read after all, so not cached either */
+	      map->cached = 0;
+	      continue;
+	    }
+	  *budget -= map->length;
+	}
+
+      files[i] = files[kept];
+      files[kept++] = map;
+    }
+
+  dropped = file_count - kept;
+  if (dropped)
+    g_debug ("%d maps left out, over compressed or remote filesystem budgets", dropped);
+
+  return kept;
+}
+
+/* merges files into requests at the tail of queue, returns their number */
+static int
+queue_maps (preload_map_t **files, int file_count, GQueue *queue)
 {
   int i;
   const char *path = NULL;
   size_t offset = 0, length = 0;
+  GPtrArray *maps = NULL;
   int processed = 0;
 
-  /* Set IO Priority to IDLE to avoid slowing down foreground apps */
-  syscall(SYS_ioprio_set, 1, 0, (IOPRIO_CLASS_IDLE << 13) | 7);
+  /* keep files on quarantined mounts, and those in memory anyway, out
+   * before anything touches them */
+  for (i = 0; i < file_count; )
+    {
+      const mountpoint_t *mount = find_mount (preload_canon_realpath (files[i]->path));
+
+      if (mount->fsclass == FS_MEMORY
+	  || (mount->fsclass == FS_REMOTE && conf->system.remoteprocs <= 0 && conf->system.maxprocs > 0)
+	  || (mounts_health && preload_readahead_quarantined (mount->dir, g_get_monotonic_time ())))
+        {
+	  preload_map_t *tmp = files[i];
+	  files[i] = files[--file_count];
+	  files[file_count] = tmp;
+	}
+      else
+	i++;
+    }
+
+  file_count = skip_cached (files, file_count);
+  file_count = fit_fs_budgets (files, file_count);
 
   sort_files (files, file_count);
   for (i=0; i<file_count; i++)
@@ -311,13 +1259,14 @@ preload_readahead (preload_map_t **files, int file_count)
 	  0 == strcmp (path, files[i]->path))
         {
 	  /* merge requests */
-	  length = files[i]->offset + files[i]->length - offset;
+	  length = MAX (offset + length, files[i]->offset + files[i]->length) - offset;
+	  g_ptr_array_add (maps, files[i]);
 	  continue;
 	}
 
       if (path)
         {
-	  process_file(path, offset, length);
+	  queue_file(queue, path, offset, length, maps);
 	  processed++;
 	  path = NULL;
 	}
@@ -325,16 +1274,52 @@ preload_readahead (preload_map_t **files, int file_count)
       path   = files[i]->path;
       offset = files[i]->offset;
       length = files[i]->length;
+      maps = g_ptr_array_new ();
+      g_ptr_array_add (maps, files[i]);
     }
 
   if (path)
     {
-      process_file(path, offset, length);
+      queue_file(queue, path, offset, length, maps);
       processed++;
       path = NULL;
     }
 
-  wait_for_children ();
+  return processed;
+}
+
+int
+preload_readahead (preload_map_t **files, int file_count)
+{
+  int processed;
+
+  set_idle_ioprio ();
+
+  /* what was not started last time has been superseded by this round */
+  drop_pending (FALSE);
+
+  load_mountpoints ();
+  processed = queue_maps (files, file_count, &pending);
+  dispatch ();
+
+  return processed;
+}
+
+int
+preload_readahead_now (preload_map_t **files, int file_count)
+{
+  GQueue urgent = G_QUEUE_INIT;
+  prefetch_request_t *req;
+  int processed;
+
+  set_idle_ioprio ();
+  load_mountpoints ();
+  processed = queue_maps (files, file_count, &urgent);
+
+  /* ahead of what is queued, which stays */
+  while ((req = g_queue_pop_tail (&urgent)))
+    g_queue_push_head (&pending, req);
+  dispatch ();
 
   return processed;
 }
@@ -3,6 +3,38 @@
 
 #include <state.h>
 
+/* queues the files for prefetch and returns right away; returns the
+ * number of requests made after merging */
 int preload_readahead (preload_map_t **files, int file_count);
 
+/* the same, ahead of what is queued and without superseding it */
+int preload_readahead_now (preload_map_t **files, int file_count);
+
+/* queues a metadata warming pass over the files at paths (model paths,
+ * most wanted first) and their directories, within the metabudget.  it
+ * runs ahead of data readahead.  returns the number of lookups queued. */
+int preload_readahead_metadata (GPtrArray *paths);
+
+/* moves the maps not in the page cache to the front of maps and returns
+ * their number.  maps found cached are not looked up again for a while,
+ * and those that cannot be looked up count as cached. */
+int preload_readahead_uncached (preload_map_t **maps, int count);
+
+/* drops queued prefetch requests and kills readers in flight */
+void preload_readahead_cancel (const char *reason);
+
+/* map is going away: requests stop referring to it */
+void preload_readahead_forget_map (preload_map_t *map);
+
+/* number of prefetch requests queued or in flight */
+int preload_readahead_inflight (void);
+
+/* a reader of a file on mount missed its deadline at now (monotonic,
+ * microseconds).  a mount whose readers keep missing theirs is
+ * quarantined: nothing on it is prefetched for a while. */
+void preload_readahead_timed_out (const char *mount, gint64 now);
+
+/* whether mount is quarantined at now, lifting an expired quarantine */
+gboolean preload_readahead_quarantined (const char *mount, gint64 now);
+
 #endif
@@ -30,8 +30,16 @@
 #include "spy.h"
 #include "prophet.h"
 #include "vomm.h"
+#include "cluster.h"
+#include "profile.h"
 #include "model_utils.h"
 #include "power.h"
+#include "canon.h"
+#include "ephemeral.h"
+#include "telemetry.h"
+#include "stats.h"
+#include "trace.h"
+#include "timeline.h"
 
 
 /* Global state singleton */
@@ -39,6 +47,20 @@ preload_state_t state[1];
 static char *autosave_statefile;
 
 
+/* one snapshot of the system per tick, for everything decided in it */
+static void
+sample_telemetry (void)
+{
+  preload_telemetry_sample ();
+  state->memstat = preload_telemetry ()->mem;
+  state->memstat_timestamp = state->time;
+
+  preload_timeline_counter ("memory",
+			    "available", (gint64)state->memstat.available,
+			    "cached", (gint64)state->memstat.cached,
+			    "free", (gint64)state->memstat.free, NULL);
+}
+
 
 /* Callback to set running processes after state load */
 static void
@@ -100,8 +122,7 @@ preload_state_load (const char *statefile)
   /* Recompute markov states based on running processes */
   preload_markov_foreach ((GFunc)update_markov_state_callback, NULL);
 
-  proc_get_memstat (&(state->memstat));
-  state->memstat_timestamp = state->time;
+  sample_telemetry ();
 }
 
 
@@ -115,8 +136,17 @@ true_func (gpointer G_GNUC_UNUSED key, gpointer G_GNUC_UNUSED value, gpointer G_
 void
 preload_state_save (const char *statefile)
 {
+  gint64 start = g_get_monotonic_time ();
+
+  /* merge exes that run together, before their chains are written */
+  if (preload_cluster_update ())
+    state->dirty = TRUE;
+  preload_timeline_span (TIMELINE_MAIN, "cluster", start);
+
+  start = g_get_monotonic_time ();
   if (state->dirty && statefile && *statefile) {
     char *errmsg = preload_state_write_file (statefile);
+    preload_timeline_span (TIMELINE_MAIN, "save", start);
     if (errmsg) {
       g_critical ("failed saving state: %s", errmsg);
       g_free (errmsg);
@@ -126,13 +156,22 @@ preload_state_save (const char *statefile)
   }
 
   /* Clean up deleted executables/maps from model */
+  start = g_get_monotonic_time ();
   preload_cleanup_invalid_entries(state->exes, state->maps);
+  preload_canon_prune ();
+  preload_timeline_span (TIMELINE_MAIN, "validate", start);
 
   /* clean up bad exes once in a while */
   g_hash_table_foreach_remove (state->bad_exes, (GHRFunc)true_func, NULL);
 }
 
 
+void
+preload_state_stop (void)
+{
+  preload_spy_stop ();
+}
+
 void
 preload_state_free (void)
 {
@@ -149,6 +188,11 @@ preload_state_free (void)
   state->running_exes = NULL;
   g_ptr_array_free (state->maps_arr, TRUE);
   vomm_cleanup();
+  preload_canon_free ();
+  preload_ephemeral_free ();
+  preload_profile_free ();
+  preload_telemetry_free ();
+  preload_spy_stop ();
   g_free (autosave_statefile);
   g_debug ("freeing state memory done");
 }
@@ -165,6 +209,23 @@ preload_state_dump_log (void)
   fprintf (stderr, "num maps = %d\n", g_hash_table_size (state->maps));
   fprintf (stderr, "runtime state stats:\n");
   fprintf (stderr, "num running exes = %d\n", g_slist_length (state->running_exes));
+  fprintf (stderr, "prediction %s, %u/%u done in %u slices\n",
+	   preload_prophet_phase_name (preload_prophet_stats ()->phase),
+	   preload_prophet_stats ()->done, preload_prophet_stats ()->total,
+	   preload_prophet_stats ()->slices);
+  fprintf (stderr, "predictions completed = %u, restarted = %u, last took %" G_GINT64_FORMAT "us\n",
+	   preload_prophet_stats ()->completed, preload_prophet_stats ()->restarts,
+	   preload_prophet_stats ()->duration);
+  fprintf (stderr, "prefetched = %" G_GUINT64_FORMAT "kb, hits = %" G_GUINT64_FORMAT " (%" G_GUINT64_FORMAT "kb), wastes = %" G_GUINT64_FORMAT " (%" G_GUINT64_FORMAT "kb)\n",
+	   preload_prophet_stats ()->prefetched_kb,
+	   preload_prophet_stats ()->hits, preload_prophet_stats ()->hit_kb,
+	   preload_prophet_stats ()->wastes, preload_prophet_stats ()->waste_kb);
+  fprintf (stderr, "system stats at time %d:\n", preload_telemetry ()->time);
+  fprintf (stderr, "memory available = %dkb\n", preload_telemetry ()->mem.available);
+  fprintf (stderr, "memory pressure = %.2f%%\n", preload_telemetry ()->memory_some);
+  fprintf (stderr, "io pressure = %.2f%%\n", preload_telemetry ()->io_some);
+  fprintf (stderr, "disk read = %dkb/s\n", preload_telemetry ()->disk_read_rate);
+  fprintf (stderr, "disk utilization = %d%%\n", preload_telemetry ()->disk_util);
   g_debug ("state log dump done");
 }
 
@@ -175,24 +236,107 @@ preload_state_dump_log (void)
 
 static gboolean preload_state_tick (gpointer data);
 
+/* the step state->time was last advanced by, and when */
+static int step_base, step_length, step_delay;
+static gint64 step_start;
+
+/* when the scan in progress started */
+static gint64 scan_start;
+
+
+static void
+advance_time (int length, int delay)
+{
+  step_base = state->time;
+  step_length = length;
+  step_delay = delay;
+  step_start = g_get_monotonic_time ();
+  state->time += length;
+}
+
+
+int
+preload_state_now (void)
+{
+  gint64 elapsed;
+  int offset;
+
+  if (!step_start || step_length <= 0 || step_delay <= 0)
+    return state->time;
+
+  elapsed = g_get_monotonic_time () - step_start;
+  offset = (int)(elapsed * step_length / ((gint64)step_delay * G_USEC_PER_SEC));
+
+  return step_base + CLAMP (offset, 0, step_length - 1);
+}
+
 
 static gboolean
 preload_state_tick2 (gpointer data)
 {
   if (state->model_dirty) {
+    gint64 start = g_get_monotonic_time ();
+
     g_debug ("state updating begin");
+    PRELOAD_TRACE (update_begin);
     preload_spy_update_model (data);
     state->model_dirty = FALSE;
+    PRELOAD_TRACE (update_end);
     g_debug ("state updating end");
+    preload_timeline_span (TIMELINE_MAIN, "update model", start);
+    preload_stats_publish ();
   }
+  preload_timeline_flush ();
 
   /* increase time and reschedule */
-  state->time += (conf->model.cycle + 1) / 2;
+  advance_time ((conf->model.cycle + 1) / 2, (conf->model.cycle + 1) / 2);
   g_timeout_add_seconds ((conf->model.cycle + 1) / 2, preload_state_tick, data);
   return FALSE;
 }
 
 
+static void
+scanned (void)
+{
+  if (preload_is_debugging())
+    preload_state_dump_log ();
+  state->dirty = state->model_dirty = TRUE;
+  PRELOAD_TRACE (scan_end);
+  g_debug ("state scanning end");
+  preload_timeline_span (TIMELINE_SCAN, "scan", scan_start);
+  preload_stats_publish ();
+}
+
+
+static void
+predict (gpointer data)
+{
+  if (conf->system.dopredict) {
+    g_debug ("state predicting begin");
+    preload_prophet_predict (data);
+    g_debug ("state predicting end");
+  }
+}
+
+
+static void
+end_tick (gpointer data)
+{
+  /* increase time and reschedule */
+  advance_time (conf->model.cycle / 2, conf->model.cycle / 2);
+  g_timeout_add_seconds (conf->model.cycle / 2, preload_state_tick2, data);
+  preload_timeline_flush ();
+}
+
+
+static void
+scan_done (gpointer data, gpointer G_GNUC_UNUSED user_data)
+{
+  scanned ();
+  end_tick (data);
+}
+
+
 static gboolean
 preload_state_tick (gpointer data)
 {
@@ -200,28 +344,33 @@ preload_state_tick (gpointer data)
   if (preload_on_battery()) {
       g_debug("Running on battery. Skipping IO intensive operations and slowing down cycle.");
       /* Increase cycle time to save power (double the normal cycle) */
-      state->time += conf->model.cycle; 
+      advance_time (conf->model.cycle, conf->model.cycle * 2);
       g_timeout_add_seconds (conf->model.cycle * 2, preload_state_tick2, data);
       return FALSE;
   }
 
+  sample_telemetry ();
+
+  if (conf->system.doscan && conf->system.asyncscan) {
+    /* the scan runs in the background while we predict on the model as
+     * the previous one left it; the tick ends once it is applied */
+    g_debug ("state scanning begin");
+    PRELOAD_TRACE (scan_begin);
+    scan_start = g_get_monotonic_time ();
+    preload_spy_scan_async (scan_done, data);
+    predict (data);
+    return FALSE;
+  }
+
   if (conf->system.doscan) {
     g_debug ("state scanning begin");
+    PRELOAD_TRACE (scan_begin);
+    scan_start = g_get_monotonic_time ();
     preload_spy_scan (data);
-    if (preload_is_debugging())
-      preload_state_dump_log ();
-    state->dirty = state->model_dirty = TRUE;
-    g_debug ("state scanning end");
+    scanned ();
   }
-  if (conf->system.dopredict) {
-    g_debug ("state predicting begin");
-    preload_prophet_predict (data);
-    g_debug ("state predicting end");
-  }
-
-  /* increase time and reschedule */
-  state->time += conf->model.cycle / 2;
-  g_timeout_add_seconds (conf->model.cycle / 2, preload_state_tick2, data);
+  predict (data);
+  end_tick (data);
   return FALSE;
 }
 
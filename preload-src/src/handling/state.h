@@ -47,6 +47,9 @@ typedef struct _preload_state_t
 
   gint64 map_seq; /* increasing sequence of unique numbers to assign to maps. */
   gint64 exe_seq; /* increasing sequence of unique numbers to assign to exes. */
+  guint model_generation; /* bumped whenever exes or maps come or go. */
+  guint free_generation; /* bumped whenever exes, chains or maps are freed. */
+  gboolean chainless; /* whether exes were registered without their chains. */
 
   time_t last_running_timestamp; /* last time we checked for processes running. */
   time_t last_accounting_timestamp; /* last time we did accounting on running times, etc. */
@@ -69,6 +72,13 @@ void preload_state_load (const char *statefile);
 void preload_state_save (const char *statefile);
 void preload_state_dump_log (void);
 void preload_state_run (const char *statefile);
+/* stops background work on the state, the scan worker; the state stays */
+void preload_state_stop (void);
+
+/* state->time runs ahead in half-cycle steps; this interpolates the time
+ * within the current step from the wall clock, for events noticed between
+ * ticks.  always less than state->time once the step started. */
+int preload_state_now (void);
 void preload_state_free (void);
 
 
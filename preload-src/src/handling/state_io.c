@@ -29,7 +29,12 @@
 #include "exe.h"
 #include "exe.h"
 #include "markov.h"
+#include "spawn.h"
+#include "logistic.h"
 #include "vomm.h"
+#include "canon.h"
+#include "ephemeral.h"
+#include "profile.h"
 #include "log.h"
 
 
@@ -43,6 +48,14 @@
 #define TAG_EXEMAP      "EXEMAP"
 #define TAG_MARKOV      "MARKOV"
 #define TAG_VOMM_NODE   "VOMMNODE"
+#define TAG_SPAWN       "SPAWN"
+#define TAG_FRECENCY    "FRECENCY"
+#define TAG_LOGISTIC    "LOGISTIC"
+#define TAG_CLUSTER     "CLUSTER"
+#define TAG_EPHEMERAL   "EPHEMERAL"
+#define TAG_SEEN        "SEEN"
+#define TAG_PROFILE     "PROFILE"
+#define TAG_PROFILEEXE  "PROFILEEXE"
 
 
 #define READ_TAG_ERROR			"invalid tag"
@@ -66,6 +79,25 @@ typedef struct _read_context_t
 
 
 
+/* MAP and EXE lines may carry a trailing uri: the real path behind a
+ * canonical key.  older versions simply ignore it. */
+static void
+read_canon_realpath (read_context_t *rc, const char *rest, const char *key)
+{
+  char *realpath;
+
+  if (1 > sscanf (rest, " %"FILELENSTR"s", rc->filebuf))
+    return;
+
+  realpath = g_filename_from_uri (rc->filebuf, NULL, NULL);
+  if (!realpath)
+    return;
+
+  preload_canon_register (key, realpath);
+  g_free (realpath);
+}
+
+
 static void
 read_map (read_context_t *rc)
 {
@@ -75,10 +107,11 @@ read_map (read_context_t *rc)
   long offset, length;
   char *path;
   long long t_update_time;
+  int n = 0;
 
   if (6 > sscanf (rc->line,
-		  "%" G_GINT64_FORMAT " %lld %lu %lu %d %"FILELENSTR"s",
-		  &i, &t_update_time, &offset, &length, &expansion, rc->filebuf)) {
+		  "%" G_GINT64_FORMAT " %lld %lu %lu %d %"FILELENSTR"s%n",
+		  &i, &t_update_time, &offset, &length, &expansion, rc->filebuf, &n)) {
     rc->errmsg = READ_SYNTAX_ERROR;
     return;
   }
@@ -101,6 +134,7 @@ read_map (read_context_t *rc)
   map->update_time = (time_t)t_update_time;
   preload_map_ref (map);
   g_hash_table_insert (rc->maps, (gpointer)i, map);
+  read_canon_realpath (rc, rc->line + n, map->path);
   return;
 
 err:
@@ -152,10 +186,11 @@ read_exe (read_context_t *rc)
   // For now, let's assume we want to read them as integers but store in time_t, or parse into a temp 64-bit var.
   // Let's use temporary variables for scanning to be safe against size mismatches.
   long long t_update_time, t_time;
+  int n = 0;
 
   if (5 > sscanf (rc->line,
-		  "%" G_GINT64_FORMAT " %lld %lld %d %"FILELENSTR"s",
-		  &i, &t_update_time, &t_time, &expansion, rc->filebuf)) {
+		  "%" G_GINT64_FORMAT " %lld %lld %d %"FILELENSTR"s%n",
+		  &i, &t_update_time, &t_time, &expansion, rc->filebuf, &n)) {
     rc->errmsg = READ_SYNTAX_ERROR;
     return;
   }
@@ -180,6 +215,7 @@ read_exe (read_context_t *rc)
   exe->time = (time_t)t_time;
   g_hash_table_insert (rc->exes, (gpointer)i, exe);
   preload_state_register_exe (exe, FALSE);
+  read_canon_realpath (rc, rc->line + n, exe->path);
   return;
 
 err:
@@ -223,7 +259,7 @@ read_markov (read_context_t *rc)
   gint64 ia, ib;
   preload_exe_t *a, *b;
   preload_markov_t *markov;
-  int n;
+  int i, n;
 
   n = 0;
   if (3 > sscanf (rc->line,
@@ -270,6 +306,23 @@ read_markov (read_context_t *rc)
       markov->weight[markov_state][state_new] = x;
     }
   }
+
+  /* dwell histograms follow, unless written before they were kept */
+  for (markov_state = 0; markov_state < 4; markov_state++) {
+    for (i = 0; i < MARKOV_DWELL_BUCKETS; i++) {
+      int x;
+      if (1 > sscanf (rc->line,
+		      "%d%n",
+		      &x, &n)) {
+	if (markov_state || i)
+	  rc->errmsg = READ_SYNTAX_ERROR;
+	return;
+      }
+
+      rc->line += n;
+      markov->dwell[markov_state][i] = CLAMP (x, 0, MARKOV_DWELL_MAX);
+    }
+  }
 }
 
 static void
@@ -296,6 +349,230 @@ read_vomm_node (read_context_t *rc)
 }
 
 
+static void
+read_spawn (read_context_t *rc)
+{
+  gint64 iparent, ichild;
+  preload_exe_t *parent, *child;
+  preload_spawn_t *spawn;
+  int starts, count;
+  double delay;
+
+  if (5 > sscanf (rc->line,
+		  "%" G_GINT64_FORMAT " %" G_GINT64_FORMAT " %d %d %lg",
+		  &iparent, &ichild, &starts, &count, &delay)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  parent = g_hash_table_lookup (rc->exes, (gpointer)iparent);
+  child = g_hash_table_lookup (rc->exes, (gpointer)ichild);
+  if (!parent || !child || parent == child) {
+    rc->errmsg = READ_INDEX_ERROR;
+    return;
+  }
+
+  spawn = preload_spawn_new (parent, child);
+  spawn->starts = starts;
+  spawn->count = count;
+  spawn->delay = delay;
+}
+
+
+static void
+read_frecency (read_context_t *rc)
+{
+  gint64 iexe;
+  preload_exe_t *exe;
+  double frecency, hour;
+  int t_time, i, n;
+  const char *p;
+
+  if (3 > sscanf (rc->line,
+		  "%" G_GINT64_FORMAT " %d %lg%n",
+		  &iexe, &t_time, &frecency, &n)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  exe = g_hash_table_lookup (rc->exes, (gpointer)iexe);
+  if (!exe) {
+    rc->errmsg = READ_INDEX_ERROR;
+    return;
+  }
+
+  exe->frecency_time = t_time;
+  exe->frecency = frecency;
+  for (i = 0, p = rc->line + n; i < 24; i++, p += n) {
+    if (1 > sscanf (p, " %lg%n", &hour, &n)) {
+      rc->errmsg = READ_SYNTAX_ERROR;
+      return;
+    }
+    exe->frecency_hour[i] = hour;
+  }
+}
+
+
+static void
+read_logistic (read_context_t *rc)
+{
+  gint64 iexe;
+  preload_exe_t *exe;
+  float *weights;
+  double weight;
+  int i, n;
+  const char *p;
+
+  if (1 > sscanf (rc->line, "%" G_GINT64_FORMAT "%n", &iexe, &n)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  exe = g_hash_table_lookup (rc->exes, (gpointer)iexe);
+  if (!exe) {
+    rc->errmsg = READ_INDEX_ERROR;
+    return;
+  }
+
+  weights = g_new (float, LOGISTIC_WEIGHTS);
+  for (i = 0, p = rc->line + n; i < LOGISTIC_WEIGHTS; i++, p += n) {
+    if (1 > sscanf (p, " %lg%n", &weight, &n)) {
+      rc->errmsg = READ_SYNTAX_ERROR;
+      g_free (weights);
+      return;
+    }
+    weights[i] = weight;
+  }
+  g_free (exe->logistic);
+  exe->logistic = weights;
+}
+
+
+static void
+read_cluster (read_context_t *rc)
+{
+  gint64 imember, ileader;
+  preload_exe_t *member, *leader;
+
+  if (2 > sscanf (rc->line,
+		  "%" G_GINT64_FORMAT " %" G_GINT64_FORMAT,
+		  &imember, &ileader)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  member = g_hash_table_lookup (rc->exes, (gpointer)imember);
+  leader = g_hash_table_lookup (rc->exes, (gpointer)ileader);
+  if (!member || !leader || member == leader || leader->cluster) {
+    rc->errmsg = READ_INDEX_ERROR;
+    return;
+  }
+
+  /* members have no chains saved */
+  member->cluster = leader;
+}
+
+
+static void
+read_profile (read_context_t *rc)
+{
+  int id, cycles;
+
+  if (2 > sscanf (rc->line,
+		  "%d %d",
+		  &id, &cycles)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  /* written in order of id */
+  if (id != (int)preload_profiles ()->len || cycles < 0) {
+    rc->errmsg = READ_INDEX_ERROR;
+    return;
+  }
+
+  preload_profile_new (cycles);
+}
+
+
+static void
+read_profile_exe (read_context_t *rc)
+{
+  int id;
+  gint64 iexe;
+  double weight;
+  preload_exe_t *exe;
+  GPtrArray *profiles = preload_profiles ();
+
+  if (3 > sscanf (rc->line,
+		  "%d %" G_GINT64_FORMAT " %lg",
+		  &id, &iexe, &weight)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  exe = g_hash_table_lookup (rc->exes, (gpointer)iexe);
+  if (id < 0 || id >= (int)profiles->len || !exe) {
+    rc->errmsg = READ_INDEX_ERROR;
+    return;
+  }
+
+  preload_profile_set (g_ptr_array_index (profiles, id), exe, weight);
+}
+
+
+/* a directory exes were seen vanishing from.  older versions wrote only
+ * one count, and no time. */
+static void
+read_ephemeral (read_context_t *rc)
+{
+  int count, nested = 0, t_time = state->time;
+  char *dir;
+
+  if (4 > sscanf (rc->line,
+		  "%d %d %d %"FILELENSTR"s",
+		  &count, &nested, &t_time, rc->filebuf)
+      && 2 > sscanf (rc->line,
+		     "%d %"FILELENSTR"s",
+		     &count, rc->filebuf)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  dir = g_filename_from_uri (rc->filebuf, NULL, &(rc->err));
+  if (!dir)
+    return;
+
+  preload_ephemeral_learn_dir (dir, count, nested, t_time);
+  g_free (dir);
+}
+
+
+/* when an exe was first seen, to tell how long it lived if it vanishes */
+static void
+read_seen (read_context_t *rc)
+{
+  gint64 iexe;
+  preload_exe_t *exe;
+  long long t_seen;
+
+  if (2 > sscanf (rc->line,
+		  "%" G_GINT64_FORMAT " %lld",
+		  &iexe, &t_seen)) {
+    rc->errmsg = READ_SYNTAX_ERROR;
+    return;
+  }
+
+  exe = g_hash_table_lookup (rc->exes, (gpointer)iexe);
+  if (!exe) {
+    rc->errmsg = READ_INDEX_ERROR;
+    return;
+  }
+
+  exe->seen_timestamp = (time_t)t_seen;
+}
+
+
 static void
 set_markov_state_callback (gpointer data, gpointer G_GNUC_UNUSED user_data)
 {
@@ -382,6 +659,14 @@ read_state (GIOChannel *f)
     else if (!strcmp (tag, TAG_EXEMAP))	read_exemap (&rc);
     else if (!strcmp (tag, TAG_MARKOV))	read_markov (&rc);
     else if (!strcmp (tag, TAG_VOMM_NODE)) read_vomm_node (&rc);
+    else if (!strcmp (tag, TAG_SPAWN))	read_spawn (&rc);
+    else if (!strcmp (tag, TAG_FRECENCY))	read_frecency (&rc);
+    else if (!strcmp (tag, TAG_LOGISTIC))	read_logistic (&rc);
+    else if (!strcmp (tag, TAG_CLUSTER))	read_cluster (&rc);
+    else if (!strcmp (tag, TAG_EPHEMERAL))	read_ephemeral (&rc);
+    else if (!strcmp (tag, TAG_SEEN))	read_seen (&rc);
+    else if (!strcmp (tag, TAG_PROFILE))	read_profile (&rc);
+    else if (!strcmp (tag, TAG_PROFILEEXE))	read_profile_exe (&rc);
     else if (linebuf->str[0] && linebuf->str[0] != '#') {
       rc.errmsg = READ_TAG_ERROR;
       break;
@@ -467,6 +752,22 @@ typedef struct _write_context_t
 
 
 
+static void
+append_canon_realpath (GString *line, const char *path)
+{
+  char *uri;
+
+  if (!preload_canon_is_key (path))
+    return;
+
+  uri = g_filename_to_uri (preload_canon_realpath (path), NULL, NULL);
+  if (uri) {
+    g_string_append_printf (line, "\t%s", uri);
+    g_free (uri);
+  }
+}
+
+
 static void
 write_header (write_context_t *wc)
 {
@@ -492,6 +793,7 @@ write_map (preload_map_t *map, gpointer G_GNUC_UNUSED data, write_context_t *wc)
   g_string_printf (wc->line,
 		   "%" G_GINT64_FORMAT "\t%lld\t%lu\t%lu\t%d\t%s",
 		   map->seq, (long long)map->update_time, (long)map->offset, (long)map->length, -1/*expansion*/, uri);
+  append_canon_realpath (wc->line, map->path);
   write_string (wc->line);
   write_ln ();
 
@@ -536,6 +838,7 @@ write_exe (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, write_context_t *wc)
   g_string_printf (wc->line,
 		   "%" G_GINT64_FORMAT "\t%lld\t%lld\t%d\t%s",
 		   exe->seq, (long long)exe->update_time, (long long)exe->time, -1/*expansion*/, uri);
+  append_canon_realpath (wc->line, exe->path);
   write_string (wc->line);
   write_ln ();
 
@@ -570,7 +873,7 @@ write_exe_exemaps(gpointer G_GNUC_UNUSED key, preload_exe_t *exe, write_context_
 static void
 write_markov (preload_markov_t *markov, write_context_t *wc)
 {
-  int markov_state, state_new;
+  int markov_state, state_new, i;
 
   write_tag (TAG_MARKOV);
   g_string_printf (wc->line,
@@ -592,8 +895,147 @@ write_markov (preload_markov_t *markov, write_context_t *wc)
       write_string (wc->line);
     }
   }
+  for (markov_state = 0; markov_state < 4; markov_state++) {
+    for (i = 0; i < MARKOV_DWELL_BUCKETS; i++) {
+      g_string_printf (wc->line,
+		       "\t%d",
+		       markov->dwell[markov_state][i]);
+      write_string (wc->line);
+    }
+  }
+
+  write_ln ();
+}
+
+static void
+write_spawn (gpointer data, gpointer user_data)
+{
+  preload_spawn_t *spawn = (preload_spawn_t *)data;
+  struct { write_context_t *wc; preload_exe_t *exe; } *ctx = user_data;
+  write_context_t *wc = ctx->wc;
+
+  write_tag (TAG_SPAWN);
+  g_string_printf (wc->line,
+		   "%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%d\t%d\t%lg",
+		   ctx->exe->seq, spawn->child->seq, spawn->starts, spawn->count, spawn->delay);
+  write_string (wc->line);
+  write_ln ();
+}
+
+static void
+write_exe_spawns (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, write_context_t *wc)
+{
+  struct { write_context_t *wc; preload_exe_t *exe; } ctx = { wc, exe };
+  g_ptr_array_foreach (exe->spawns, write_spawn, &ctx);
+}
+
+static void
+write_frecency (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, write_context_t *wc)
+{
+  int i;
+
+  if (exe->frecency <= 0)
+    return;
+
+  write_tag (TAG_FRECENCY);
+  g_string_printf (wc->line,
+		   "%" G_GINT64_FORMAT "\t%d\t%lg",
+		   exe->seq, exe->frecency_time, exe->frecency);
+  for (i = 0; i < 24; i++)
+    g_string_append_printf (wc->line, "\t%g", exe->frecency_hour[i]);
+  write_string (wc->line);
+  write_ln ();
+}
+
+static void
+write_seen (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, write_context_t *wc)
+{
+  if (exe->seen_timestamp < 0)
+    return;
+
+  write_tag (TAG_SEEN);
+  g_string_printf (wc->line,
+		   "%" G_GINT64_FORMAT "\t%lld",
+		   exe->seq, (long long)exe->seen_timestamp);
+  write_string (wc->line);
+  write_ln ();
+}
+
+static void
+write_logistic (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, write_context_t *wc)
+{
+  int i;
+
+  if (!exe->logistic)
+    return;
+
+  write_tag (TAG_LOGISTIC);
+  g_string_printf (wc->line, "%" G_GINT64_FORMAT, exe->seq);
+  for (i = 0; i < LOGISTIC_WEIGHTS; i++)
+    g_string_append_printf (wc->line, "\t%.9g", exe->logistic[i]);
+  write_string (wc->line);
+  write_ln ();
+}
+
+static void
+write_cluster (gpointer G_GNUC_UNUSED key, preload_exe_t *exe, write_context_t *wc)
+{
+  if (!exe->cluster)
+    return;
+
+  write_tag (TAG_CLUSTER);
+  g_string_printf (wc->line,
+		   "%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT,
+		   exe->seq, exe->cluster->seq);
+  write_string (wc->line);
+  write_ln ();
+}
+
+static void
+write_profile (preload_profile_t *profile, write_context_t *wc)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  write_tag (TAG_PROFILE);
+  g_string_printf (wc->line,
+		   "%d\t%d",
+		   profile->id, profile->cycles);
+  write_string (wc->line);
+  write_ln ();
+
+  g_hash_table_iter_init (&iter, profile->weights);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    write_tag (TAG_PROFILEEXE);
+    g_string_printf (wc->line,
+		     "%d\t%" G_GINT64_FORMAT "\t%.9g",
+		     profile->id, ((preload_exe_t *)key)->seq, *(gfloat *)value);
+    write_string (wc->line);
+    write_ln ();
+  }
+}
+
+static void
+write_ephemeral (const char *dir, int count, int nested, int time, gpointer user_data)
+{
+  write_context_t *wc = (write_context_t *)user_data;
+  char *uri;
+
+  if (wc->err)
+    return;
 
+  uri = g_filename_to_uri (dir, NULL, &(wc->err));
+  if (!uri)
+    return;
+
+  write_tag (TAG_EPHEMERAL);
+  g_string_printf (wc->line,
+		   "%d\t%d\t%d\t%s",
+		   count, nested, time, uri);
+  write_string (wc->line);
   write_ln ();
+
+  g_free (uri);
 }
 
 static void
@@ -622,8 +1064,15 @@ write_state (GIOChannel *f)
   if (!wc.err) g_hash_table_foreach   (state->maps, (GHFunc)write_map, &wc);
   if (!wc.err) g_hash_table_foreach   (state->bad_exes, (GHFunc)write_badexe, &wc);
   if (!wc.err) g_hash_table_foreach   (state->exes, (GHFunc)write_exe, &wc);
+  if (!wc.err) g_hash_table_foreach   (state->exes, (GHFunc)write_seen, &wc);
   if (!wc.err) g_hash_table_foreach   (state->exes, (GHFunc)write_exe_exemaps, &wc);
   if (!wc.err) preload_markov_foreach ((GFunc)write_markov, &wc);
+  if (!wc.err) g_hash_table_foreach   (state->exes, (GHFunc)write_exe_spawns, &wc);
+  if (!wc.err) g_hash_table_foreach   (state->exes, (GHFunc)write_frecency, &wc);
+  if (!wc.err) g_hash_table_foreach   (state->exes, (GHFunc)write_logistic, &wc);
+  if (!wc.err) g_hash_table_foreach   (state->exes, (GHFunc)write_cluster, &wc);
+  if (!wc.err) preload_ephemeral_foreach_dir (write_ephemeral, &wc);
+  if (!wc.err) g_ptr_array_foreach (preload_profiles (), (GFunc)write_profile, &wc);
   if (!wc.err) vomm_export_state (write_vomm_node_callback, &wc);
 
   g_string_free (wc.line, TRUE);
@@ -0,0 +1,167 @@
+/* stats.c - Shared-memory statistics segment
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "stats.h"
+#include "log.h"
+#include "conf.h"
+#include "state.h"
+#include "prophet.h"
+
+#include <stddef.h>
+
+_Static_assert (PRELOAD_STATS_PHASES == PREDICT_PHASES,
+		"stats segment phases out of sync with the prophet");
+
+/* everything after the header is written under seq */
+#define BODY offsetof (preload_stats_segment_t, updated)
+
+static preload_stats_segment_t *segment;
+static char *segment_path;
+
+
+gboolean
+preload_stats_open (const char *path)
+{
+  void *addr;
+  int fd;
+
+  preload_stats_close ();
+  if (!path || !*path)
+    return TRUE;
+
+  fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    g_warning ("cannot open stats segment %s: %s", path, strerror (errno));
+    return FALSE;
+  }
+
+  /* whatever a previous run left is zeroed out */
+  if (0 > ftruncate (fd, 0) || 0 > ftruncate (fd, sizeof (preload_stats_segment_t))) {
+    g_warning ("cannot size stats segment %s: %s", path, strerror (errno));
+    close (fd);
+    return FALSE;
+  }
+
+  addr = mmap (NULL, sizeof (preload_stats_segment_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (addr == MAP_FAILED) {
+    g_warning ("cannot map stats segment %s: %s", path, strerror (errno));
+    return FALSE;
+  }
+
+  segment = addr;
+  segment->version = PRELOAD_STATS_VERSION;
+  segment->size = sizeof (preload_stats_segment_t);
+  segment->pid = getpid ();
+  __atomic_store_n (&segment->magic, PRELOAD_STATS_MAGIC, __ATOMIC_RELEASE);
+  segment_path = g_strdup (path);
+
+  g_debug ("publishing stats in %s", path);
+  preload_stats_publish ();
+  return TRUE;
+}
+
+
+void
+preload_stats_publish (void)
+{
+  const preload_prophet_stats_t *prophet;
+  preload_stats_segment_t body;
+  uint32_t seq;
+  int i;
+
+  if (!segment)
+    return;
+
+  prophet = preload_prophet_stats ();
+
+  memset (&body, 0, sizeof (body));
+  body.updated = g_get_real_time ();
+  body.model_time = state->time;
+  body.phase = prophet->phase;
+  g_strlcpy (body.engine, preload_algorithm_name (preload_algorithm ()), sizeof (body.engine));
+
+  body.exes = state->exes ? g_hash_table_size (state->exes) : 0;
+  body.bad_exes = state->bad_exes ? g_hash_table_size (state->bad_exes) : 0;
+  body.maps = state->maps ? g_hash_table_size (state->maps) : 0;
+  body.running_exes = g_slist_length (state->running_exes);
+
+  body.predictions = prophet->completed;
+  body.restarts = prophet->restarts;
+  body.predict_time = prophet->duration;
+  for (i = 0; i < PRELOAD_STATS_PHASES; i++)
+    body.phase_time[i] = prophet->phase_time[i];
+
+  body.readahead_budget = prophet->readahead_budget;
+  body.readahead_used = prophet->readahead_used;
+  body.swapin_budget = prophet->swapin_budget;
+  body.swapin_used = prophet->swapin_used;
+  body.cold_budget = prophet->cold_budget;
+  body.cold_used = prophet->cold_used;
+
+  body.prefetched_kb = prophet->prefetched_kb;
+  body.hits = prophet->hits;
+  body.hit_kb = prophet->hit_kb;
+  body.wastes = prophet->wastes;
+  body.waste_kb = prophet->waste_kb;
+
+  /* readers that see seq odd, or changed across their copy, try again */
+  seq = segment->seq;
+  __atomic_store_n (&segment->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+  memcpy ((char *)segment + BODY, (char *)&body + BODY, sizeof (body) - BODY);
+  __atomic_store_n (&segment->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+gboolean
+preload_stats_read (const preload_stats_segment_t *seg, preload_stats_segment_t *out)
+{
+  uint32_t seq;
+  int tries;
+
+  if (__atomic_load_n (&seg->magic, __ATOMIC_ACQUIRE) != PRELOAD_STATS_MAGIC
+      || seg->version != PRELOAD_STATS_VERSION
+      || seg->size < sizeof (preload_stats_segment_t))
+    return FALSE;
+
+  for (tries = 0; tries < 1000; tries++) {
+    seq = __atomic_load_n (&seg->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+      continue;
+
+    memcpy (out, seg, sizeof (*out));
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    if (__atomic_load_n (&seg->seq, __ATOMIC_RELAXED) == seq)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+void
+preload_stats_close (void)
+{
+  if (!segment)
+    return;
+
+  munmap (segment, sizeof (preload_stats_segment_t));
+  segment = NULL;
+
+  /* monitors tell a stopped daemon by the file going away */
+  if (0 > unlink (segment_path))
+    g_debug ("cannot remove %s: %s", segment_path, strerror (errno));
+  g_free (segment_path);
+  segment_path = NULL;
+}
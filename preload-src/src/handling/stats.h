@@ -0,0 +1,90 @@
+/* stats.h - Shared-memory statistics segment
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <glib.h>
+
+/*
+ * The daemon publishes its statistics in a small file it keeps mapped,
+ * /run/preload.stats by default, rewritten in place at the end of every
+ * phase of a tick.  Monitors map the file read-only and sample it as often
+ * as they like, without talking to the daemon and without ever making it
+ * wait.
+ *
+ * The layout below is fixed-width and native-endian.  Fields are only ever
+ * added at the end, bumping the version; readers should check magic and
+ * version, and that size covers what they read.
+ *
+ * The body is guarded by a sequence count, odd while being written.  To
+ * read, see preload_stats_read(): load seq, retry if odd, copy the
+ * segment, load seq again, and retry if it changed.
+ */
+
+#define PRELOAD_STATS_MAGIC	0x53444c50	/* "PLDS" */
+#define PRELOAD_STATS_VERSION	1
+#define PRELOAD_STATS_PHASES	6		/* preload_prophet_phase_t */
+
+typedef struct _preload_stats_segment_t
+{
+  /* set once when the file is created */
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;		/* of the segment, in bytes */
+  uint32_t seq;			/* odd while the rest is being written */
+  int64_t pid;			/* of the daemon */
+
+  int64_t updated;		/* wall clock of the last update, microseconds since epoch */
+  int32_t model_time;		/* state->time */
+  int32_t phase;		/* of the prediction in progress, 0 if none */
+  char engine[16];		/* prediction algorithm, nul-terminated */
+
+  /* model sizes */
+  uint32_t exes;
+  uint32_t bad_exes;
+  uint32_t maps;
+  uint32_t running_exes;
+
+  /* predictions */
+  uint32_t predictions;		/* completed */
+  uint32_t restarts;		/* started over */
+  int64_t predict_time;		/* microseconds the last one took */
+  int64_t phase_time[PRELOAD_STATS_PHASES]; /* and in each phase */
+
+  /* budgets of the last cycle and how much of them went, in kilobytes */
+  int32_t readahead_budget;
+  int32_t readahead_used;
+  int32_t swapin_budget;
+  int32_t swapin_used;
+  int32_t cold_budget;
+  int32_t cold_used;
+
+  /* since the daemon started */
+  uint64_t prefetched_kb;	/* asked to be read ahead */
+  uint64_t hits;		/* prefetched maps used by an exe starting */
+  uint64_t hit_kb;
+  uint64_t wastes;		/* prefetched maps dropped from the prediction unused */
+  uint64_t waste_kb;
+} preload_stats_segment_t;
+
+/* creates and maps path; empty or NULL publishes nothing.  returns FALSE
+ * if the file could not be set up, which is not fatal. */
+gboolean preload_stats_open (const char *path);
+
+/* copies the current statistics to the segment, if open */
+void preload_stats_publish (void);
+
+/* a consistent copy of seg into out; FALSE if the writer kept it busy or
+ * the segment is not one we understand */
+gboolean preload_stats_read (const preload_stats_segment_t *seg, preload_stats_segment_t *out);
+
+/* unmaps the segment and removes the file */
+void preload_stats_close (void);
+
+#endif
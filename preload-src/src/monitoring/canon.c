@@ -0,0 +1,207 @@
+/* canon.c - Path canonicalization for versioned install locations
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "canon.h"
+#include "log.h"
+#include "state.h"
+
+#include <ctype.h>
+
+/* canonical key -> real path it was last seen at */
+static GHashTable *aliases;
+
+#define NIX_HASH_LEN 32
+static const char nix_base32[] = "0123456789abcdfghijklmnpqrsvwxyz";
+
+/* length of a leading "<nix hash>-" in the component, or 0 */
+static size_t
+nix_hash_length (const char *comp, const char *end)
+{
+  int i;
+
+  if (end - comp <= NIX_HASH_LEN + 1 || comp[NIX_HASH_LEN] != '-')
+    return 0;
+
+  for (i = 0; i < NIX_HASH_LEN; i++)
+    if (!comp[i] || !strchr (nix_base32, comp[i]))
+      return 0;
+
+  return NIX_HASH_LEN + 1;
+}
+
+/* first "-<digit>" in the component, following the Nix name/version split */
+static const char *
+find_version (const char *name, const char *end)
+{
+  const char *p;
+
+  for (p = name; p + 1 < end; p++)
+    if (*p == '-' && isdigit ((unsigned char)p[1]))
+      return p;
+
+  return NULL;
+}
+
+/* end of the version starting at ver: all the "-<digit>..." parts in a
+ * row, so release and revision go together */
+static const char *
+version_end (const char *ver, const char *end)
+{
+  const char *p = ver;
+
+  while (p + 1 < end && *p == '-' && isdigit ((unsigned char)p[1]))
+    for (p++; p < end && *p != '-'; p++)
+      ;
+
+  return p;
+}
+
+gboolean
+preload_canon_rewrite (const char *path, char * const *prefix, char *key, size_t keylen)
+{
+  const char *comp, *end, *name, *ver, *verend;
+  int len;
+
+  if (!path || !prefix)
+    return FALSE;
+
+  for (; *prefix; prefix++) {
+    const char *p = *prefix;
+    size_t plen;
+
+    if (*p == '!') {
+      if (*++p && !strncmp (path, p, strlen (p)))
+	return FALSE;
+      continue;
+    }
+
+    plen = strlen (p);
+    if (!plen || strncmp (path, p, plen))
+      continue;
+
+    comp = path + plen;
+    while (*comp == '/')
+      comp++;
+
+    /* only directories below the prefix are install locations */
+    end = strchr (comp, '/');
+    if (!end || end == comp)
+      return FALSE;
+
+    name = comp + nix_hash_length (comp, end);
+
+    ver = find_version (name, end);
+    if (ver) {
+      verend = version_end (ver, end);
+      /* a component that is nothing but a version stays as is */
+      if (ver == name && verend == end)
+	ver = verend = end;
+    } else {
+      ver = verend = end;
+    }
+
+    if (name == comp && ver == end)
+      return FALSE; /* nothing to strip */
+
+    len = g_snprintf (key, keylen, "%.*s%.*s%.*s%s",
+		      (int)(comp - path), path,
+		      (int)(ver - name), name,
+		      (int)(end - verend), verend,
+		      end);
+    return len > 0 && (size_t)len < keylen;
+  }
+
+  return FALSE;
+}
+
+gboolean
+preload_canon_register (const char *key, const char *realpath)
+{
+  const char *old;
+
+  g_return_val_if_fail (key && realpath, FALSE);
+
+  if (!aliases)
+    aliases = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  old = g_hash_table_lookup (aliases, key);
+  if (old && !strcmp (old, realpath))
+    return TRUE;
+
+  /* both versions are installed: not an upgrade */
+  if (old && !access (old, F_OK)) {
+    g_debug ("[Canon] %s is at %s, keeping %s apart", key, old, realpath);
+    return FALSE;
+  }
+
+  if (old)
+    g_debug ("[Canon] %s moved from %s to %s", key, old, realpath);
+
+  g_hash_table_replace (aliases, g_strdup (key), g_strdup (realpath));
+  return TRUE;
+}
+
+const char *
+preload_canon_realpath (const char *path)
+{
+  const char *realpath;
+
+  if (!aliases || !path)
+    return path;
+
+  realpath = g_hash_table_lookup (aliases, path);
+  return realpath ? realpath : path;
+}
+
+gboolean
+preload_canon_is_key (const char *path)
+{
+  return aliases && path && g_hash_table_contains (aliases, path);
+}
+
+void
+preload_canon_prune (void)
+{
+  GHashTable *live;
+  GHashTableIter iter;
+  gpointer key, value;
+  guint i;
+
+  if (!aliases || !g_hash_table_size (aliases))
+    return;
+
+  live = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_hash_table_iter_init (&iter, state->exes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_hash_table_add (live, ((preload_exe_t *)value)->path);
+
+  for (i = 0; i < state->maps_arr->len; i++)
+    g_hash_table_add (live, ((preload_map_t *)g_ptr_array_index (state->maps_arr, i))->path);
+
+  g_hash_table_iter_init (&iter, aliases);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (!g_hash_table_contains (live, key))
+      g_hash_table_iter_remove (&iter);
+
+  g_hash_table_destroy (live);
+}
+
+void
+preload_canon_free (void)
+{
+  if (aliases) {
+    g_hash_table_destroy (aliases);
+    aliases = NULL;
+  }
+}
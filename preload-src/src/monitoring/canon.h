@@ -0,0 +1,61 @@
+/* canon.h - Path canonicalization for versioned install locations
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ */
+
+#ifndef CANON_H
+#define CANON_H
+
+#include <glib.h>
+
+/*
+ * Package managers like Nix (and versioned /opt layouts) embed a hash or a
+ * version in every path, so each upgrade would otherwise look like a brand
+ * new set of exes and maps to the model.  Paths below a configured prefix
+ * are rewritten to a stable key by dropping the hash and version from the
+ * first path component after the prefix:
+ *
+ *   /nix/store/<hash>-firefox-120.0.1/bin/firefox -> /nix/store/firefox/bin/firefox
+ *   /nix/store/<hash>-glib-2.78.0-bin/bin/gio     -> /nix/store/glib-bin/bin/gio
+ *   /nix/store/<hash>-glibc-2.38-44/lib/libc.so.6 -> /nix/store/glibc/lib/libc.so.6
+ *   /opt/app-1.2.3/lib/libapp.so                  -> /opt/app/lib/libapp.so
+ *
+ * The model is keyed by the canonical path.  The real path last seen for a
+ * key is remembered, so prefetch and validation still touch actual files.
+ * A new version takes the key over once the old one is gone; while both
+ * are installed, the new one is known by its real path.
+ */
+
+/*
+ * preload_canon_rewrite - Compute the canonical key of a path
+ *
+ * @path:   Absolute path of a file
+ * @prefix: Rule list, same syntax as mapprefix ('!' rejects); may be NULL
+ * @key:    Output buffer for the canonical key
+ * @keylen: Size of @key
+ *
+ * Returns: TRUE if @path was rewritten into @key, FALSE if no rule applies
+ * (in which case @key is left untouched).
+ */
+gboolean preload_canon_rewrite (const char *path, char * const *prefix, char *key, size_t keylen);
+
+/* Remember @realpath as the current on-disk location of @key.  Returns
+ * FALSE, leaving @key alone, if it is known at another real path that
+ * still exists. */
+gboolean preload_canon_register (const char *key, const char *realpath);
+
+/* Returns the real path last seen for @path, or @path itself if it is
+ * not a canonical key. */
+const char * preload_canon_realpath (const char *path);
+
+/* Returns TRUE if @path is a canonical key with a known real path. */
+gboolean preload_canon_is_key (const char *path);
+
+/* Drop remembered real paths for keys no longer referenced by the model. */
+void preload_canon_prune (void);
+
+void preload_canon_free (void);
+
+#endif /* CANON_H */
@@ -0,0 +1,249 @@
+/* ephemeral.c - Exes that come and go, kept out of the model
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "ephemeral.h"
+#include "log.h"
+#include "conf.h"
+#include "canon.h"
+#include "state.h"
+
+#include <sys/vfs.h>
+#include <linux/magic.h>
+
+#define EPHEMERAL_MAX_EXES 256	/* paths remembered as ephemeral */
+#define EPHEMERAL_MAX_DIRS 64	/* directories learning is kept for */
+#define EPHEMERAL_VANISHED 3	/* exes vanishing that make a directory ephemeral */
+#define EPHEMERAL_LIFETIME (24 * 3600)	/* vanishing sooner than this counts */
+#define EPHEMERAL_HALFLIFE (7 * 24 * 3600)	/* counts halve unless renewed */
+
+/* what is learned of a directory; both tables hold records that start
+ * with the state time they were last touched at */
+typedef struct
+{
+  int time;	/* counts are aged to this time */
+  int count;	/* exes vanished from it */
+  int nested;	/* exes vanished with a directory of their own in it */
+} ephemeral_dir_t;
+
+/* path -> state time last seen running, an int */
+static GHashTable *exes;
+/* directory -> ephemeral_dir_t */
+static GHashTable *dirs;
+
+
+/* drops the entry of table touched longest ago, to make room */
+static void
+evict (GHashTable *table)
+{
+  GHashTableIter iter;
+  gpointer key, value, oldest = NULL;
+  int min = G_MAXINT;
+
+  g_hash_table_iter_init (&iter, table);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (*(int *)value < min) {
+      min = *(int *)value;
+      oldest = key;
+    }
+  if (oldest)
+    g_hash_table_remove (table, oldest);
+}
+
+gboolean
+preload_ephemeral_known (const char *path)
+{
+  int *seen;
+
+  if (!exes || !(seen = g_hash_table_lookup (exes, path)))
+    return FALSE;
+
+  *seen = state->time;
+  return TRUE;
+}
+
+
+/* what was learned of dir, aged to now; NULL if nothing is left of it */
+static ephemeral_dir_t *
+lookup_dir (const char *dir)
+{
+  ephemeral_dir_t *d;
+  int halvings;
+
+  if (!dirs || !(d = g_hash_table_lookup (dirs, dir)))
+    return NULL;
+
+  halvings = (state->time - d->time) / EPHEMERAL_HALFLIFE;
+  if (halvings > 0) {
+    d->count >>= MIN (halvings, 30);
+    d->nested >>= MIN (halvings, 30);
+    d->time += halvings * EPHEMERAL_HALFLIFE;
+  }
+  if (!d->count && !d->nested) {
+    g_hash_table_remove (dirs, dir);
+    return NULL;
+  }
+  return d;
+}
+
+static gboolean
+on_tmpfs (const char *path)
+{
+  struct statfs fs;
+
+  if (0 > statfs (preload_canon_realpath (path), &fs))
+    return FALSE;
+  return fs.f_type == TMPFS_MAGIC || fs.f_type == RAMFS_MAGIC;
+}
+
+/* exes in a directory they kept vanishing from, or in a directory of
+ * their own next to ones that kept vanishing with theirs */
+static gboolean
+in_learned_dir (const char *path)
+{
+  char *parent, *grandparent;
+  ephemeral_dir_t *d;
+  gboolean found;
+
+  if (!dirs)
+    return FALSE;
+
+  parent = g_path_get_dirname (path);
+  grandparent = g_path_get_dirname (parent);
+  found = ((d = lookup_dir (parent)) && d->count >= EPHEMERAL_VANISHED)
+	  || ((d = lookup_dir (grandparent)) && d->nested >= EPHEMERAL_VANISHED);
+  g_free (grandparent);
+  g_free (parent);
+  return found;
+}
+
+static const char *
+why_ephemeral (const char *path)
+{
+  char * const *pattern;
+
+  for (pattern = conf->system.ephemeralexe; pattern && *pattern; pattern++)
+    if (g_pattern_match_simple (*pattern, path))
+      return "matches ephemeralexe";
+  if (in_learned_dir (path))
+    return "exes keep vanishing from its directory";
+  if (on_tmpfs (path))
+    return "on tmpfs";
+  return NULL;
+}
+
+gboolean
+preload_ephemeral_classify (const char *path)
+{
+  const char *why;
+  int *seen;
+
+  g_return_val_if_fail (path, FALSE);
+
+  if (preload_ephemeral_known (path))
+    return TRUE;
+  if (!(why = why_ephemeral (path)))
+    return FALSE;
+
+  g_debug ("%s is ephemeral, %s", path, why);
+  if (!exes)
+    exes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  if (g_hash_table_size (exes) >= EPHEMERAL_MAX_EXES)
+    evict (exes);
+  seen = g_new (int, 1);
+  *seen = state->time;
+  g_hash_table_insert (exes, g_strdup (path), seen);
+  return TRUE;
+}
+
+
+static void
+count_dir (const char *dir, int count, int nested, int time)
+{
+  ephemeral_dir_t *d;
+
+  if (!dirs)
+    dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  if (!(d = lookup_dir (dir))) {
+    if (g_hash_table_size (dirs) >= EPHEMERAL_MAX_DIRS)
+      evict (dirs);
+    d = g_new0 (ephemeral_dir_t, 1);
+    d->time = time;
+    g_hash_table_insert (dirs, g_strdup (dir), d);
+  }
+  d->count += count;
+  d->nested += nested;
+}
+
+void
+preload_ephemeral_vanished (const char *path, int lifetime)
+{
+  char *parent, *grandparent;
+
+  g_return_if_fail (path);
+
+  /* an app that was uninstalled had a long life */
+  if (lifetime < 0 || lifetime > EPHEMERAL_LIFETIME)
+    return;
+
+  parent = g_path_get_dirname (path);
+  if (strcmp (parent, "/")) {
+    count_dir (parent, 1, 0, state->time);
+
+    /* a directory of its own that went away with it, like the ones
+     * launchers unpack to: what holds those is the one to learn */
+    grandparent = g_path_get_dirname (parent);
+    if (strcmp (grandparent, "/") && !g_file_test (preload_canon_realpath (parent), G_FILE_TEST_EXISTS))
+      count_dir (grandparent, 0, 1, state->time);
+    g_free (grandparent);
+  }
+  g_free (parent);
+}
+
+
+void
+preload_ephemeral_foreach_dir (void (*func) (const char *dir, int count, int nested,
+					      int time, gpointer user_data),
+			       gpointer user_data)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  if (!dirs)
+    return;
+
+  g_hash_table_iter_init (&iter, dirs);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    ephemeral_dir_t *d = value;
+    func (key, d->count, d->nested, d->time, user_data);
+  }
+}
+
+void
+preload_ephemeral_learn_dir (const char *dir, int count, int nested, int time)
+{
+  g_return_if_fail (dir);
+
+  if (count > 0 || nested > 0)
+    count_dir (dir, MAX (count, 0), MAX (nested, 0), MIN (time, state->time));
+}
+
+
+void
+preload_ephemeral_free (void)
+{
+  if (exes)
+    g_hash_table_destroy (exes);
+  if (dirs)
+    g_hash_table_destroy (dirs);
+  exes = dirs = NULL;
+}
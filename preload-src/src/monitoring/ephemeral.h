@@ -0,0 +1,48 @@
+/* ephemeral.h - Exes that come and go, kept out of the model
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#ifndef EPHEMERAL_H
+#define EPHEMERAL_H
+
+#include <glib.h>
+
+/*
+ * Temporary copies of programs (Proton and game launchers unpacking to a
+ * temporary directory, per-build test binaries, sandbox copies) run once
+ * under a path never seen again.  Registering them costs a chain with
+ * every other exe, and the cleanup at save time removes them again.
+ *
+ * Such exes are told apart before they get registered, and kept in a
+ * small side table instead, so they are passed over on later scans.  An
+ * exe is ephemeral when its path matches a pattern in
+ * system.ephemeralexe, when it lives on tmpfs or ramfs, or when its
+ * directory is learned to hold them: one exes kept vanishing from shortly
+ * after they were first seen, or one holding directories that kept
+ * vanishing with theirs.  What is learned fades unless renewed.
+ */
+
+/* TRUE if path was classified ephemeral before; does not classify */
+gboolean preload_ephemeral_known (const char *path);
+
+/* classifies the path of an exe about to be registered; TRUE if it is
+ * ephemeral, and then remembered as such */
+gboolean preload_ephemeral_classify (const char *path);
+
+/* an exe of the model vanished with its file, lifetime seconds after it
+ * was first seen, or -1 if not known */
+void preload_ephemeral_vanished (const char *path, int lifetime);
+
+/* learned directories, to keep across restarts: exes vanished from dir,
+ * and with a directory of their own in it, as of state time time */
+void preload_ephemeral_foreach_dir (void (*func) (const char *dir, int count, int nested,
+						   int time, gpointer user_data),
+				    gpointer user_data);
+void preload_ephemeral_learn_dir (const char *dir, int count, int nested, int time);
+
+void preload_ephemeral_free (void);
+
+#endif /* EPHEMERAL_H */
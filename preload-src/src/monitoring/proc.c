@@ -26,9 +26,10 @@
 #include "proc.h"
 #include "conf.h"
 #include "state.h"
+#include "canon.h"
 
-#include <dirent.h>
 #include <ctype.h>
+#include <sys/syscall.h>
 
 /* now here is the nasty stuff:  ideally we want to ignore/get-rid-of
  * deleted binaries and maps, BUT, preLINK, renames and later deletes
@@ -85,6 +86,21 @@ accept_file (char *file, char * const *prefix)
   return TRUE;
 }
 
+/* versioned install locations (nix store, /opt/app-x.y) are folded into a
+ * stable key, so the model survives upgrades.  the real path is remembered
+ * for whoever needs to touch the file. */
+static void
+canonicalize_file (char *file)
+{
+  char key[FILELEN];
+
+  if (!preload_canon_rewrite (file, conf->system.canonprefix, key, sizeof (key))
+      || !preload_canon_register (key, file))
+    return;
+
+  strcpy (file, key);
+}
+
 size_t
 proc_get_maps (pid_t pid, GHashTable *maps, GPtrArray **exemaps)
 {
@@ -117,6 +133,8 @@ proc_get_maps (pid_t pid, GHashTable *maps, GPtrArray **exemaps)
       if (count != 4 || !sanitize_file (file) || !accept_file (file, conf->system.mapprefix))
         continue;
 
+      canonicalize_file (file);
+
       length = end - start;
       size += length;
 
@@ -158,6 +176,184 @@ proc_get_maps (pid_t pid, GHashTable *maps, GPtrArray **exemaps)
   return size;
 }
 
+/* what smaps tells about one mapping */
+typedef struct
+{
+  unsigned long start, end;
+  enum { VMA_ANON, VMA_FILE, VMA_OTHER } kind;
+  int rss, swap, locked; /* kilobytes */
+} smaps_vma_t;
+
+static void
+add_range (GArray *ranges, const smaps_vma_t *vma, int kb)
+{
+  preload_range_t range;
+
+  if (kb <= 0)
+    return;
+
+  range.start = vma->start;
+  range.length = vma->end - vma->start;
+  range.kb = kb;
+  g_array_append_val (ranges, range);
+}
+
+static void
+add_swapin_range (GArray *ranges, const smaps_vma_t *vma)
+{
+  int size = (int)((vma->end - vma->start) / 1024);
+  int kb;
+
+  /* swapped anonymous (and COWed private file) pages, plus whatever part
+   * of a file mapping that was in use has been reclaimed since */
+  kb = vma->swap;
+  if (vma->kind == VMA_FILE && vma->rss > 0 && vma->rss < size)
+    kb += size - vma->rss;
+
+  if (vma->kind != VMA_OTHER)
+    add_range (ranges, vma, kb);
+}
+
+static void
+add_resident_range (GArray *ranges, const smaps_vma_t *vma)
+{
+  /* locked mappings refuse the advice, and so would fail the batch */
+  if (vma->kind != VMA_OTHER && !vma->locked)
+    add_range (ranges, vma, vma->rss);
+}
+
+/* feeds every mapping of pid to func, returns total swapped kilobytes,
+ * or -1 if failed */
+static int
+read_smaps (pid_t pid, GArray *ranges, void (*func) (GArray *, const smaps_vma_t *))
+{
+  char name[32] = {0};
+  FILE *in;
+  char buffer[1024] = {0};
+  smaps_vma_t vma;
+  gboolean in_vma = FALSE;
+  int swapped = 0;
+
+  g_snprintf (name, sizeof (name), "/proc/%d/smaps", pid);
+  in = fopen (name, "r");
+  if (!in)
+    return -1;
+
+  memset (&vma, 0, sizeof (vma));
+  while (fgets (buffer, sizeof (buffer) - 1, in))
+    {
+      char path[FILELEN] = {0};
+      unsigned long vstart, vend;
+      int count;
+
+      if (!strncmp (buffer, "Rss:", 4)) {
+	sscanf (buffer + 4, "%d", &vma.rss);
+	continue;
+      }
+      if (!strncmp (buffer, "Swap:", 5)) {
+	sscanf (buffer + 5, "%d", &vma.swap);
+	swapped += vma.swap;
+	continue;
+      }
+      if (!strncmp (buffer, "Locked:", 7)) {
+	sscanf (buffer + 7, "%d", &vma.locked);
+	continue;
+      }
+
+      count = sscanf (buffer, "%lx-%lx %*15s %*x %*x:%*x %*u %"FILELENSTR"s",
+		      &vstart, &vend, path);
+      if (count < 2)
+	continue; /* some other field */
+
+      if (in_vma)
+	func (ranges, &vma);
+
+      in_vma = TRUE;
+      memset (&vma, 0, sizeof (vma));
+      vma.start = vstart;
+      vma.end = vend;
+      if (count < 3 || !strcmp (path, "[heap]") || !strncmp (path, "[stack", 6))
+	vma.kind = VMA_ANON;
+      else if (sanitize_file (path) && strncmp (path, "/dev/", 5)
+	       && accept_file (path, conf->system.mapprefix))
+	vma.kind = VMA_FILE;
+      else
+	vma.kind = VMA_OTHER; /* [vdso], devices, ... */
+    }
+
+  if (in_vma)
+    func (ranges, &vma);
+
+  fclose (in);
+
+  return swapped;
+}
+
+static int
+sum_ranges (GArray *ranges, guint first)
+{
+  int total = 0;
+  guint i;
+
+  for (i = first; i < ranges->len; i++)
+    total += g_array_index (ranges, preload_range_t, i).kb;
+
+  return total;
+}
+
+int
+proc_get_swapin_ranges (pid_t pid, GArray *ranges)
+{
+  guint first = ranges->len;
+
+  /* mapped file pages that were never touched look just like reclaimed
+   * ones.  only trust them for a process that has been pushed out. */
+  if (read_smaps (pid, ranges, add_swapin_range) <= 0) {
+    g_array_set_size (ranges, first);
+    return 0;
+  }
+
+  return sum_ranges (ranges, first);
+}
+
+int
+proc_get_resident_ranges (pid_t pid, GArray *ranges)
+{
+  guint first = ranges->len;
+
+  if (read_smaps (pid, ranges, add_resident_range) < 0)
+    return 0;
+
+  return sum_ranges (ranges, first);
+}
+
+long long
+proc_get_cputime (pid_t pid)
+{
+  char name[32] = {0};
+  char buf[1024];
+  const char *p;
+  unsigned long long utime, stime;
+  int fd, len;
+
+  g_snprintf (name, sizeof (name), "/proc/%d/stat", pid);
+  if ((fd = open (name, O_RDONLY)) == -1)
+    return -1;
+  len = read (fd, buf, sizeof (buf) - 1);
+  close (fd);
+  if (len <= 0)
+    return -1;
+  buf[len] = '\0';
+
+  /* comm may contain anything, skip past its closing paren */
+  p = strrchr (buf, ')');
+  if (!p || 2 != sscanf (p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+			 &utime, &stime))
+    return -1;
+
+  return (long long)(utime + stime);
+}
+
 static gboolean
 all_digits (const char *s)
 {
@@ -169,121 +365,501 @@ all_digits (const char *s)
   return TRUE;
 }
 
-void
-proc_foreach (GHFunc func, gpointer user_data)
+
+
+/* scanning all of /proc every cycle is mostly wasted work: nearly all
+ * processes are the ones we saw last time.  so we remember what each pid
+ * resolved to, and only look again when it runs another file.  a single
+ * stat through /proc/N/exe tells, it changes with every exec, and with
+ * pid reuse unless the new process runs the very same file.
+ * /proc is kept open and listed with getdents64, everything else is read
+ * relative to it.
+ *
+ * a scan is taken in two steps so the listing can happen on a worker
+ * thread: proc_scan_take() only touches /proc and the cache, under
+ * cache_lock.  proc_scan_apply() runs where the model lives, decides on
+ * newly seen exes against the configured filters, canonicalizes them and
+ * writes the verdicts back.  paths are shared and counted, so records
+ * stay valid whatever happens to the cache in between, and the paths of
+ * processes long gone do not pile up. */
+
+typedef struct _proc_entry_t
+{
+  dev_t dev;		/* of the file the process runs */
+  ino_t ino;
+  unsigned long long starttime;
+  pid_t ppid;		/* as first seen */
+  const char *exe;	/* sanitized exe path, NULL if unreadable */
+  const char *path;	/* canonical path, NULL if rejected by filters */
+  unsigned int filter_epoch; /* filters path was decided under */
+  gpointer data;	/* caller's slot, see proc_foreach_cached() */
+  unsigned int data_epoch;
+  unsigned int generation;
+} proc_entry_t;
+
+typedef struct _proc_record_t
+{
+  pid_t pid;
+  unsigned long long starttime;
+  const char *exe;
+  const char *path;
+  gboolean decided;
+  gpointer data;
+} proc_record_t;
+
+struct _proc_scan_t
+{
+  GArray *records;
+  unsigned int data_epoch;
+  unsigned int generation;
+};
+
+static GMutex cache_lock;
+static int proc_fd = -1;
+static GHashTable *proc_cache;
+static unsigned int proc_generation;
+/* bumped when filters change, and when slot data goes away */
+static unsigned int filter_epoch = 1, data_epoch = 1;
+
+/* the exe and canonical paths cache entries and records share */
+typedef struct
+{
+  int refs;
+  char path[];
+} shared_path_t;
+
+static GMutex paths_lock;
+static GHashTable *paths;	/* path -> shared_path_t */
+
+struct linux_dirent64
+{
+  guint64 d_ino;
+  gint64 d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+static const char *
+path_ref (const char *path)
+{
+  shared_path_t *shared;
+  size_t len;
+
+  if (!path)
+    return NULL;
+
+  g_mutex_lock (&paths_lock);
+  if (!paths)
+    paths = g_hash_table_new (g_str_hash, g_str_equal);
+  shared = g_hash_table_lookup (paths, path);
+  if (!shared) {
+    len = strlen (path);
+    shared = g_malloc (sizeof (*shared) + len + 1);
+    shared->refs = 0;
+    memcpy (shared->path, path, len + 1);
+    g_hash_table_insert (paths, shared->path, shared);
+  }
+  shared->refs++;
+  g_mutex_unlock (&paths_lock);
+
+  return shared->path;
+}
+
+static void
+path_unref (const char *path)
+{
+  shared_path_t *shared;
+
+  if (!path)
+    return;
+
+  g_mutex_lock (&paths_lock);
+  shared = g_hash_table_lookup (paths, path);
+  if (shared && !--shared->refs) {
+    g_hash_table_remove (paths, shared->path);
+    g_free (shared);
+  }
+  g_mutex_unlock (&paths_lock);
+}
+
+static void
+entry_free (proc_entry_t *entry)
+{
+  path_unref (entry->exe);
+  path_unref (entry->path);
+  g_free (entry);
+}
+
+/* reads start time and parent of pid from /proc/pid/stat */
+static gboolean
+read_identity (const char *pidname, unsigned long long *starttime, pid_t *ppid)
+{
+  char name[32];
+  char buf[1024];
+  const char *b, *e;
+  int fd, len;
+
+  g_snprintf (name, sizeof (name), "%s/stat", pidname);
+  if ((fd = openat (proc_fd, name, O_RDONLY)) == -1)
+    return FALSE;
+  len = read (fd, buf, sizeof (buf) - 1);
+  close (fd);
+  if (len <= 0)
+    return FALSE;
+  buf[len] = '\0';
+
+  /* comm may contain anything, skip past its closing paren */
+  b = strchr (buf, '(');
+  e = strrchr (buf, ')');
+  if (!b || !e || e < b)
+    return FALSE;
+
+  return 2 == sscanf (e + 2, "%*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+			     "%*u %*u %*d %*d %*d %*d %*d %*d %llu", ppid, starttime);
+}
+
+/* stats the file pid runs */
+static gboolean
+stat_exe (const char *pidname, struct stat *st)
+{
+  char name[32];
+
+  g_snprintf (name, sizeof (name), "%s/exe", pidname);
+  return 0 == fstatat (proc_fd, name, st, 0);
+}
+
+/* reads exe path of pid, returns NULL if it is not a file we can use */
+static const char *
+read_exe (const char *pidname)
+{
+  char name[32];
+  char exe_buffer[FILELEN];
+  int len;
+
+  g_snprintf (name, sizeof (name), "%s/exe", pidname);
+  len = readlinkat (proc_fd, name, exe_buffer, sizeof (exe_buffer));
+
+  if (len <= 0 /* error occured */
+      || len == sizeof (exe_buffer) /* name didn't fit completely */)
+    return NULL;
+
+  exe_buffer[len] = '\0';
+
+  if (!sanitize_file (exe_buffer))
+    return NULL;
+
+  return path_ref (exe_buffer);
+}
+
+/* fills path, of FILELEN, with what we know exe as; FALSE if filtered out */
+static gboolean
+decide_exe (const char *exe, char *path)
+{
+  if (!accept_file ((char *)exe, conf->system.exeprefix))
+    return FALSE;
+
+  g_strlcpy (path, exe, FILELEN);
+  canonicalize_file (path);
+  return TRUE;
+}
+
+static gboolean
+entry_is_stale (gpointer G_GNUC_UNUSED key, gpointer value, gpointer G_GNUC_UNUSED user_data)
+{
+  return ((proc_entry_t *)value)->generation != proc_generation;
+}
+
+proc_scan_t *
+proc_scan_take (void)
 {
-  DIR *proc;
-  struct dirent *entry;
+  char buf[32768];
   pid_t selfpid = getpid ();
+  proc_scan_t *scan;
+  long n;
+
+  g_mutex_lock (&cache_lock);
+
+  if (proc_fd == -1) {
+    proc_fd = open ("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd == -1)
+      g_error ("failed opening /proc: %s", strerror (errno));
+    proc_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)entry_free);
+  }
+
+  scan = g_new (proc_scan_t, 1);
+  scan->records = g_array_new (FALSE, FALSE, sizeof (proc_record_t));
+  scan->data_epoch = data_epoch;
 
-  proc = opendir ("/proc");
-  if (!proc)
-    g_error ("failed opening /proc: %s", strerror (errno));
+  scan->generation = ++proc_generation;
+  lseek (proc_fd, 0, SEEK_SET);
 
-  while ((entry = readdir (proc)))
+  while ((n = syscall (SYS_getdents64, proc_fd, buf, sizeof (buf))) > 0)
   {
-      if (entry->d_name && all_digits (entry->d_name))
-      {
-	  pid_t pid;
-	  char name[32] = {0};
-	  char exe_buffer[FILELEN] = {0};
-	  int len;
+    long off;
+
+    for (off = 0; off < n; off += ((struct linux_dirent64 *)(buf + off))->d_reclen)
+    {
+      const char *pidname = ((struct linux_dirent64 *)(buf + off))->d_name;
+      unsigned long long starttime;
+      proc_entry_t *entry;
+      proc_record_t rec;
+      pid_t pid, ppid;
+      struct stat st;
+
+      if (!all_digits (pidname))
+	continue;
+
+      pid = atoi (pidname);
+      if (pid == selfpid)
+	continue;
+
+      /* kernel threads and zombies have no exe */
+      if (!stat_exe (pidname, &st))
+	continue;
+
+      entry = g_hash_table_lookup (proc_cache, GINT_TO_POINTER (pid));
+      if (entry && (entry->dev != st.st_dev || entry->ino != st.st_ino)) {
+	g_hash_table_remove (proc_cache, GINT_TO_POINTER (pid));
+	entry = NULL;
+      }
+      if (!entry) {
+	if (!read_identity (pidname, &starttime, &ppid))
+	  continue;
+
+	entry = g_new0 (proc_entry_t, 1);
+	entry->dev = st.st_dev;
+	entry->ino = st.st_ino;
+	entry->starttime = starttime;
+	entry->ppid = ppid;
+	entry->exe = read_exe (pidname);
+	g_hash_table_insert (proc_cache, GINT_TO_POINTER (pid), entry);
+      }
+      entry->generation = proc_generation;
+
+      if (!entry->exe)
+	continue;
+
+      rec.pid = pid;
+      rec.starttime = entry->starttime;
+      rec.exe = path_ref (entry->exe);
+      rec.path = path_ref (entry->path);
+      rec.decided = entry->filter_epoch == filter_epoch;
+      rec.data = entry->data_epoch == data_epoch ? entry->data : NULL;
+      g_array_append_val (scan->records, rec);
+    }
+  }
+
+  /* forget processes that are gone */
+  g_hash_table_foreach_remove (proc_cache, entry_is_stale, NULL);
 
-	  pid = atoi (entry->d_name);
-	  if (pid == selfpid)
-	    continue;
+  g_mutex_unlock (&cache_lock);
 
-	  g_snprintf (name, sizeof (name) - 1, "/proc/%s/exe", entry->d_name);
+  return scan;
+}
 
-	  len = readlink (name, exe_buffer, sizeof (exe_buffer));
+/* stores what was found out about rec, unless its process is gone */
+static void
+write_back (const proc_record_t *rec, unsigned int epoch)
+{
+  proc_entry_t *entry;
+
+  g_mutex_lock (&cache_lock);
+  entry = g_hash_table_lookup (proc_cache, GINT_TO_POINTER (rec->pid));
+  if (entry && entry->starttime == rec->starttime && entry->exe == rec->exe) {
+    path_unref (entry->path);
+    entry->path = path_ref (rec->path);
+    entry->filter_epoch = filter_epoch;
+    if (epoch == data_epoch) {
+      entry->data = rec->data;
+      entry->data_epoch = data_epoch;
+    }
+  }
+  g_mutex_unlock (&cache_lock);
+}
 
-	  if (len <= 0 /* error occured */
-	      || len == sizeof (exe_buffer) /* name didn't fit completely */)
-	    continue;
+void
+proc_scan_apply (proc_scan_t *scan, proc_func_t func, gpointer user_data)
+{
+  guint i;
 
-	  exe_buffer[len] = '\0';
+  for (i = 0; i < scan->records->len; i++) {
+    proc_record_t *rec = &g_array_index (scan->records, proc_record_t, i);
+    gpointer data = scan->data_epoch == data_epoch ? rec->data : NULL;
+    gboolean changed = !rec->decided;
+    char path[FILELEN];
 
-	  if (!sanitize_file (exe_buffer) || !accept_file (exe_buffer, conf->system.exeprefix))
-	    continue;
+    if (changed) {
+      path_unref (rec->path);
+      rec->path = decide_exe (rec->exe, path) ? path_ref (path) : NULL;
+    }
 
-	  func (GUINT_TO_POINTER (pid), exe_buffer, user_data);
-      }
+    if (rec->path)
+      func (rec->pid, rec->path, &data, user_data);
+
+    if (changed || data != rec->data) {
+      rec->data = data;
+      write_back (rec, scan->data_epoch);
+    }
   }
-  
-  closedir (proc);
 }
 
+void
+proc_scan_free (proc_scan_t *scan)
+{
+  guint i;
+
+  for (i = 0; i < scan->records->len; i++) {
+    proc_record_t *rec = &g_array_index (scan->records, proc_record_t, i);
+
+    path_unref (rec->exe);
+    path_unref (rec->path);
+  }
+  g_array_free (scan->records, TRUE);
+  g_free (scan);
+}
+
+unsigned int
+proc_scan_number (const proc_scan_t *scan)
+{
+  return scan->generation;
+}
+
+unsigned int
+proc_scan_latest (void)
+{
+  unsigned int generation;
+
+  g_mutex_lock (&cache_lock);
+  generation = proc_generation;
+  g_mutex_unlock (&cache_lock);
 
+  return generation;
+}
+
+void
+proc_foreach_cached (proc_func_t func, gpointer user_data)
+{
+  proc_scan_t *scan = proc_scan_take ();
 
+  proc_scan_apply (scan, func, user_data);
+  proc_scan_free (scan);
+}
 
-#define open_file(filename) G_STMT_START {			\
-	  int fd, len;						\
-	  len = 0;						\
-	  if ((fd = open(filename, O_RDONLY)) != -1) {		\
-	    if ((len = read(fd, buf, sizeof (buf) - 1)) < 0)	\
-	      len = 0;						\
-	    close (fd);						\
-	  }							\
-	  buf[len] = '\0';					\
-	} G_STMT_END
+typedef struct
+{
+  GHFunc func;
+  gpointer user_data;
+} proc_foreach_context_t;
 
-#define read_tag(tag, v) G_STMT_START {				\
-	  const char *b;					\
-	  b = strstr(buf, tag" ");				\
-	  if (b) sscanf(b, tag" %d", &(v));			\
-	} G_STMT_END
+static void
+proc_foreach_adapter (pid_t pid, const char *path, gpointer G_GNUC_UNUSED *data, gpointer user_data)
+{
+  proc_foreach_context_t *ctx = (proc_foreach_context_t *)user_data;
 
-#define read_tag2(tag, v1, v2) G_STMT_START {			\
-	  const char *b;					\
-	  b = strstr(buf, tag" ");				\
-	  if (b) sscanf(b, tag" %d %d", &(v1), &(v2));		\
-	} G_STMT_END
+  ctx->func (GINT_TO_POINTER (pid), (gpointer)path, ctx->user_data);
+}
 
 void
-proc_get_memstat (preload_memory_t *mem)
-{
-  static int pagesize = 0;
-  char buf[4096] = {0};
-
-  memset (mem, 0, sizeof (*mem));
-
-  if (!pagesize)
-    pagesize = getpagesize ();
- 
-  open_file ("/proc/meminfo");
-  read_tag ("MemTotal:", mem->total);
-  read_tag ("MemFree:", mem->free);
-  read_tag ("MemAvailable:", mem->available);
-  read_tag ("Buffers:", mem->buffers);
-  read_tag ("Cached:", mem->cached);
-  
-  /* LRU list breakdown - available since Linux 2.6.28 */
-  read_tag ("Active:", mem->active);
-  read_tag ("Inactive:", mem->inactive);
-  read_tag ("Active(anon):", mem->active_anon);
-  read_tag ("Inactive(anon):", mem->inactive_anon);
-  read_tag ("Active(file):", mem->active_file);
-  read_tag ("Inactive(file):", mem->inactive_file);
-
-  open_file ("/proc/vmstat");
-  read_tag ("pgpgin", mem->pagein);
-  read_tag ("pgpgout", mem->pageout);
-
-  if (!mem->pagein) {
-    open_file ("/proc/stat");
-    read_tag2 ("page", mem->pagein, mem->pageout);
+proc_foreach (GHFunc func, gpointer user_data)
+{
+  proc_foreach_context_t ctx = { func, user_data };
+
+  proc_foreach_cached (proc_foreach_adapter, &ctx);
+}
+
+static void
+clear_data (gpointer G_GNUC_UNUSED key, gpointer value, gpointer data)
+{
+  proc_entry_t *entry = (proc_entry_t *)value;
+
+  if (entry->data == data)
+    entry->data = NULL;
+}
+
+void
+proc_cache_forget (gpointer data)
+{
+  g_mutex_lock (&cache_lock);
+  if (proc_cache)
+    g_hash_table_foreach (proc_cache, clear_data, data);
+  /* and in scans not applied yet */
+  data_epoch++;
+  g_mutex_unlock (&cache_lock);
+}
+
+int
+proc_cache_pids (const char *path, pid_t *pids, int max)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  int n = 0;
+
+  g_mutex_lock (&cache_lock);
+  if (proc_cache) {
+    g_hash_table_iter_init (&iter, proc_cache);
+    while (n < max && g_hash_table_iter_next (&iter, &key, &value)) {
+      proc_entry_t *entry = (proc_entry_t *)value;
+      if (entry->path && !strcmp (entry->path, path))
+	pids[n++] = GPOINTER_TO_INT (key);
+    }
   }
+  g_mutex_unlock (&cache_lock);
 
-  mem->pagein *= pagesize / 1024;
-  mem->pageout *= pagesize / 1024;
+  return n;
+}
 
-  /* Fallback for MemAvailable (pre Linux 3.14) */
-  if (!mem->available && mem->free) {
-    /* Approximate: free + (cached - min cache) + (buffers portion) 
-     * This is a rough estimate; kernel's calculation is more complex */
-    mem->available = mem->free + (mem->cached * 80 / 100) + (mem->buffers * 75 / 100);
+char *
+proc_cache_parent (pid_t pid, double *delay)
+{
+  proc_entry_t *entry, *parent = NULL;
+  char *path = NULL;
+  char decided[FILELEN];
+
+  g_mutex_lock (&cache_lock);
+  if (proc_cache && (entry = g_hash_table_lookup (proc_cache, GINT_TO_POINTER (pid))))
+    parent = g_hash_table_lookup (proc_cache, GINT_TO_POINTER (entry->ppid));
+  if (parent && parent->exe) {
+    /* the parent may be new in this scan and not decided on yet */
+    if (parent->filter_epoch == filter_epoch)
+      path = g_strdup (parent->path);
+    else if (decide_exe (parent->exe, decided))
+      path = g_strdup (decided);
+    if (delay)
+      *delay = entry->starttime > parent->starttime
+	       ? (double)(entry->starttime - parent->starttime) / sysconf (_SC_CLK_TCK) : 0;
   }
+  g_mutex_unlock (&cache_lock);
+
+  return path;
+}
+
+gboolean
+proc_cache_same_process (pid_t pid)
+{
+  proc_entry_t *entry;
+  unsigned long long starttime;
+  char pidname[16];
+  struct stat st;
+  pid_t ppid;
+  gboolean same = FALSE;
+
+  g_snprintf (pidname, sizeof (pidname), "%d", pid);
+
+  g_mutex_lock (&cache_lock);
+  if (proc_cache && (entry = g_hash_table_lookup (proc_cache, GINT_TO_POINTER (pid))))
+    same = read_identity (pidname, &starttime, &ppid) && starttime == entry->starttime
+	   && stat_exe (pidname, &st) && st.st_dev == entry->dev && st.st_ino == entry->ino;
+  g_mutex_unlock (&cache_lock);
+
+  return same;
+}
 
-  if (!mem->total || !mem->pagein)
-    g_warning ("failed to read memory stat, is /proc mounted?");
+void
+proc_cache_flush (void)
+{
+  g_mutex_lock (&cache_lock);
+  filter_epoch++;
+  data_epoch++;
+  g_mutex_unlock (&cache_lock);
 }
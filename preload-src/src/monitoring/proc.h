@@ -2,7 +2,7 @@
 #define PROC_H
 
 /* preload_memory_t: structure holding information
- * about memory conditions of the system. */
+ * about memory conditions of the system, see telemetry.h. */
 typedef struct _preload_memory_t
 {
   /* runtime: */
@@ -30,13 +30,65 @@ typedef struct _preload_memory_t
 
 } preload_memory_t;
 
-/* read system memory information */
-void proc_get_memstat (preload_memory_t *mem);
+/* preload_range_t: a range in the address space of a process that is
+ * (partly) not resident anymore. */
+typedef struct _preload_range_t
+{
+  unsigned long start;
+  size_t length;
+  int kb;	/* kilobytes to bring back in */
+} preload_range_t;
 
 /* returns sum of length of maps, in bytes, or 0 if failed */
 size_t proc_get_maps (pid_t pid, GHashTable *maps, GPtrArray **exemaps);
 
+/* appends ranges of pid that were swapped or reclaimed to ranges (an array
+ * of preload_range_t), returns their total in kilobytes, or 0 if failed */
+int proc_get_swapin_ranges (pid_t pid, GArray *ranges);
+
+/* same for ranges of pid that are resident and may be aged out */
+int proc_get_resident_ranges (pid_t pid, GArray *ranges);
+
+/* returns user+system cpu time of pid in clock ticks, or -1 if failed */
+long long proc_get_cputime (pid_t pid);
+
 /* foreach process running, passes pid as key and exe path as value */
 void proc_foreach (GHFunc func, gpointer user_data);
 
+/* same, but also passes a slot the caller may store something in.  the slot
+ * stays with the process until it exits or exec's, so callers can remember
+ * what they resolved the process to. */
+typedef void (*proc_func_t) (pid_t pid, const char *path, gpointer *data, gpointer user_data);
+void proc_foreach_cached (proc_func_t func, gpointer user_data);
+
+/* the same in two steps: take lists /proc and may run on any thread, apply
+ * filters the exes found and calls func, on the main thread. */
+typedef struct _proc_scan_t proc_scan_t;
+proc_scan_t * proc_scan_take (void);
+void proc_scan_apply (proc_scan_t *scan, proc_func_t func, gpointer user_data);
+void proc_scan_free (proc_scan_t *scan);
+
+/* scans are numbered as they are taken, from 1 */
+unsigned int proc_scan_number (const proc_scan_t *scan);
+unsigned int proc_scan_latest (void);
+
+/* clears all slots holding data, when it goes away */
+void proc_cache_forget (gpointer data);
+
+/* fills pids with up to max processes of path seen by the last scan,
+ * some of which may have exited since.  returns how many. */
+int proc_cache_pids (const char *path, pid_t *pids, int max);
+
+/* the path, as passed to proc_func_t, of the exe of pid's parent as of
+ * the last scan, newly allocated, or NULL.  delay is set to the seconds
+ * between the parent's start and pid's. */
+char * proc_cache_parent (pid_t pid, double *delay);
+
+/* whether pid is still the process the last scan saw under that number,
+ * and not a later one it was recycled to */
+gboolean proc_cache_same_process (pid_t pid);
+
+/* forgets everything, when the exe filters changed */
+void proc_cache_flush (void);
+
 #endif
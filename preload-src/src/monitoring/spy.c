@@ -26,35 +26,173 @@
 #include "state.h"
 #include "proc.h"
 #include "vomm.h"
+#include "frecency.h"
+#include "logistic.h"
 #include "exe.h"
 #include "markov.h"
+#include "madvise_utils.h"
+#include "prophet.h"
+#include "spawn.h"
+#include "cluster.h"
+#include "profile.h"
+#include "ephemeral.h"
+#include "trace.h"
+
+#include <poll.h>
 
 
 static GSList *state_changed_exes;
 static GSList *new_running_exes;
 static GHashTable *new_exes;
+static unsigned int applying_scan;
 
 
-/* for every process, check whether we know what it is, and add it
- * to appropriate list for further analysis. */
+/* exit notification: for each running exe we hold a pidfd of one of its
+ * processes in the main loop.  when it exits and no other process of the
+ * exe is left, the exe is stopped right away, with the time it happened,
+ * instead of at the next scan.  without pidfd support, the scan does it.
+ * a scan taken before the exit may be applied after it, so the exe keeps
+ * the number of the latest scan taken then, and those scans do not start
+ * it again from a process that is gone. */
+
+#define EXIT_WATCH_CANDIDATES 16
+
+/* running exes whose maps are read again per cycle, at most */
+#define MAP_REFRESH_PER_CYCLE 4
+
+static gboolean exe_exited_callback (gint fd, GIOCondition condition, gpointer user_data);
+
+static void
+unwatch_exe (preload_exe_t *exe)
+{
+  if (exe->exit_watch)
+    g_source_remove (exe->exit_watch);
+  exe->exit_watch = 0;
+  if (exe->pidfd >= 0)
+    close (exe->pidfd);
+  exe->pidfd = -1;
+}
+
+/* a pidfd of a process that exited already is readable right away */
+static gboolean
+watch_exe (preload_exe_t *exe, pid_t pid)
+{
+  struct pollfd pfd;
+  int fd;
+
+  if (pid <= 0 || (fd = preload_pidfd_open (pid)) < 0)
+    return FALSE;
+
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  if (poll (&pfd, 1, 0) != 0) {
+    close (fd);
+    return FALSE;
+  }
+
+  exe->pidfd = fd;
+  exe->exit_watch = g_unix_fd_add (fd, G_IO_IN, exe_exited_callback, exe);
+  return TRUE;
+}
+
+static void
+stop_exe (preload_exe_t *exe)
+{
+  int time = preload_state_now ();
+  guint i;
+
+  g_debug ("%s exited at %d", exe->path, time);
+  PRELOAD_TRACE (process_stop, exe->pid, exe->path);
+
+  exe->running_timestamp = state->last_running_timestamp - 1;
+  exe->change_timestamp = time;
+  exe->exit_scan = proc_scan_latest ();
+  state->running_exes = g_slist_remove (state->running_exes, exe);
+  for (i = 0; i < exe->markovs->len; i++)
+    preload_markov_state_changed_at (g_ptr_array_index (exe->markovs, i), time);
+  state->dirty = TRUE;
+}
+
+static gboolean
+exe_exited_callback (gint G_GNUC_UNUSED fd, GIOCondition G_GNUC_UNUSED condition, gpointer user_data)
+{
+  preload_exe_t *exe = (preload_exe_t *)user_data;
+  pid_t pids[EXIT_WATCH_CANDIDATES];
+  int i, n;
+
+  /* returning FALSE removes the source */
+  exe->exit_watch = 0;
+  unwatch_exe (exe);
+
+  /* hand over to another process of it, if any is left */
+  n = proc_cache_pids (exe->path, pids, G_N_ELEMENTS (pids));
+  for (i = 0; i < n; i++)
+    if (watch_exe (exe, pids[i])) {
+      exe->pid = pids[i];
+      return FALSE;
+    }
+
+  if (exe_is_running (exe))
+    stop_exe (exe);
+  return FALSE;
+}
+
 static void
-running_process_callback (gpointer key, gpointer value, gpointer G_GNUC_UNUSED user_data)
+watch_running_exe (gpointer data, gpointer G_GNUC_UNUSED user_data)
 {
-  pid_t pid = (pid_t)GPOINTER_TO_INT(key);
-  const char *path = (const char *)value;
+  preload_exe_t *exe = (preload_exe_t *)data;
+
+  if (!exe->exit_watch)
+    watch_exe (exe, exe->pid);
+}
 
+
+/* learns who started exe, just seen starting as pid */
+static void
+observe_spawn (pid_t pid, preload_exe_t *exe)
+{
+  preload_exe_t *parent;
+  char *path;
+  double delay = 0;
+
+  path = proc_cache_parent (pid, &delay);
+  if (path && (parent = g_hash_table_lookup (state->exes, path)))
+    preload_spawn_observe (parent, exe, delay);
+  g_free (path);
+}
+
+
+/* for every process, check whether we know what it is, and add it
+ * to appropriate list for further analysis.  the exe a process resolved
+ * to is kept in its cache slot, so we only look it up once. */
+static void
+running_process_callback (pid_t pid, const char *path, gpointer *data, gpointer G_GNUC_UNUSED user_data)
+{
   preload_exe_t *exe;
 
   g_return_if_fail (path);
 
-  exe = g_hash_table_lookup (state->exes, path);
+  exe = *data;
+  if (!exe)
+    *data = exe = g_hash_table_lookup (state->exes, path);
   if (exe) {
     /* already existing exe */
 
+    /* seen exiting since the scan was taken */
+    if (!exe_is_running (exe) && exe->exit_scan >= applying_scan
+	&& !proc_cache_same_process (pid))
+      return;
+
     /* has it been running already? */
     if (!exe_is_running (exe)) {
       new_running_exes = g_slist_prepend (new_running_exes, exe);
       state_changed_exes = g_slist_prepend (state_changed_exes, exe);
+      observe_spawn (pid, exe);
+      preload_spawn_parent_started (exe);
+      preload_prophet_exe_started (exe);
+      PRELOAD_TRACE (process_start, pid, exe->path);
+      preload_frecency_start (exe, state->time, preload_frecency_hour ());
+      preload_logistic_start (exe);
 
       /* VOMM Update Hook: Record execution event (transition from idle to running) */
       if (preload_is_vomm_algorithm()) {
@@ -63,9 +201,11 @@ running_process_callback (gpointer key, gpointer value, gpointer G_GNUC_UNUSED u
     }
 
     /* update timestamp */
-    exe->running_timestamp = state->time;
+    exe->running_timestamp = exe->update_time = state->time;
+    exe->pid = pid;
 
-  } else if (!g_hash_table_lookup (state->bad_exes, path)) {
+  } else if (!g_hash_table_lookup (state->bad_exes, path)
+	     && !preload_ephemeral_known (path)) {
 
     /* an exe we have never seen before, just queue it */
     g_hash_table_insert (new_exes, g_strdup (path), GUINT_TO_POINTER (pid));
@@ -80,11 +220,22 @@ already_running_exe_callback (gpointer data, gpointer G_GNUC_UNUSED user_data)
 
   if (exe_is_running (exe))
     new_running_exes = g_slist_prepend (new_running_exes, exe);
-  else
+  else {
+    /* its watched process is alive but not the exe anymore */
+    PRELOAD_TRACE (process_stop, exe->pid, exe->path);
+    unwatch_exe (exe);
     state_changed_exes = g_slist_prepend (state_changed_exes, exe);
+  }
 }
 
 
+/* the frecency and logistic engines do without chains between exes */
+static gboolean
+engine_chains (void)
+{
+  return preload_algorithm () == ALGORITHM_MARKOV || preload_algorithm () == ALGORITHM_VOMM;
+}
+
 static void
 new_exe_callback (gpointer key, gpointer value, gpointer G_GNUC_UNUSED user_data)
 {
@@ -94,6 +245,10 @@ new_exe_callback (gpointer key, gpointer value, gpointer G_GNUC_UNUSED user_data
   gboolean want_it;
   size_t size;
 
+  /* temporary copies would only churn the model */
+  if (preload_ephemeral_classify (path))
+    return;
+
   size = proc_get_maps (pid, NULL, NULL);
 
   if (!size) /* process died or something */
@@ -114,8 +269,14 @@ new_exe_callback (gpointer key, gpointer value, gpointer G_GNUC_UNUSED user_data
     }
 
     exe = preload_exe_new (path, TRUE, exemaps);
-    preload_state_register_exe (exe, TRUE);
+    exe->pid = pid;
+    exe->maps_timestamp = exe->seen_timestamp = state->time;
+    preload_state_register_exe (exe, engine_chains ());
+    observe_spawn (pid, exe);
     state->running_exes = g_slist_prepend (state->running_exes, exe);
+    PRELOAD_TRACE (exe_new, pid, exe->path, size);
+    preload_frecency_start (exe, state->time, preload_frecency_hour ());
+    preload_logistic_start (exe);
 
     /* VOMM Update Hook: Record execution event (newly discovered process) */
     if (preload_is_vomm_algorithm()) {
@@ -127,6 +288,52 @@ new_exe_callback (gpointer key, gpointer value, gpointer G_GNUC_UNUSED user_data
   }
 }
 
+static int
+maps_timestamp_compare (const preload_exe_t **pa, const preload_exe_t **pb)
+{
+  return (*pa)->maps_timestamp < (*pb)->maps_timestamp ? -1 : (*pa)->maps_timestamp > (*pb)->maps_timestamp;
+}
+
+/* reads the maps of running exes again, each once per maprefresh and
+ * the least recently read first, a few per cycle */
+static void
+refresh_exemaps (void)
+{
+  GPtrArray *due;
+  GSList *l;
+  guint i;
+
+  if (conf->model.maprefresh <= 0)
+    return;
+
+  due = g_ptr_array_new ();
+  for (l = state->running_exes; l; l = l->next) {
+    preload_exe_t *exe = l->data;
+
+    if (exe->pid > 0 && state->time - exe->maps_timestamp >= conf->model.maprefresh)
+      g_ptr_array_add (due, exe);
+  }
+  g_ptr_array_sort (due, (GCompareFunc)maps_timestamp_compare);
+
+  for (i = 0; i < due->len && i < MAP_REFRESH_PER_CYCLE; i++) {
+    preload_exe_t *exe = g_ptr_array_index (due, i);
+    GPtrArray *snapshot;
+
+    exe->maps_timestamp = state->time;
+    if (!proc_get_maps (exe->pid, state->maps, &snapshot)) {
+      /* gone since the scan; whatever it got is let go */
+      g_ptr_array_foreach (snapshot, (GFunc)preload_exemap_free, NULL);
+      g_ptr_array_free (snapshot, TRUE);
+      continue;
+    }
+
+    if (preload_exe_update_exemaps (exe, snapshot))
+      g_debug ("maps of %s changed, %u now", exe->path, exe->exemaps->len);
+  }
+
+  g_ptr_array_free (due, TRUE);
+}
+
 static void
 running_markov_inc_time (gpointer data, gpointer user_data)
 {
@@ -154,10 +361,12 @@ exe_changed_callback (gpointer data, gpointer G_GNUC_UNUSED user_data)
 
   exe->change_timestamp = state->time;
   g_ptr_array_foreach (exe->markovs, (GFunc)preload_markov_state_changed, NULL);
+  preload_cluster_exe_changed (exe);
 }
 
+/* applies a scan of /proc to the model */
 void
-preload_spy_scan (gpointer data)
+preload_spy_scan_apply (proc_scan_t *scan, gpointer data)
 {
   /* scan processes, see which exes started running, which are not running
    * anymore, and what new exes are around. */
@@ -180,7 +389,8 @@ preload_spy_scan (gpointer data)
   new_exes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
   /* mark each running exe with fresh timestamp */
-  proc_foreach ((GHFunc)running_process_callback, data);
+  applying_scan = proc_scan_number (scan);
+  proc_scan_apply (scan, running_process_callback, data);
   state->last_running_timestamp = state->time;
 
   /* figure out who's not running by checking their timestamp */
@@ -191,6 +401,86 @@ preload_spy_scan (gpointer data)
   new_running_exes = NULL;  /* Break alias to prevent use-after-free on next scan */
 }
 
+void
+preload_spy_scan (gpointer data)
+{
+  proc_scan_t *scan = proc_scan_take ();
+
+  preload_spy_scan_apply (scan, data);
+  proc_scan_free (scan);
+}
+
+
+/* listing /proc is the slow part of a scan, and it does not need the
+ * model.  it is done on a worker thread fed through a queue, so the main
+ * loop keeps reaping prefetch readers and handling exits and signals
+ * meanwhile.  the scan is applied back in the main loop. */
+
+typedef struct
+{
+  GFunc done;
+  gpointer data;
+  proc_scan_t *scan;
+} scan_job_t;
+
+static GAsyncQueue *scan_jobs;
+static GThread *scan_thread;
+static scan_job_t scan_quit;
+
+static gboolean
+scan_job_done (gpointer user_data)
+{
+  scan_job_t *job = (scan_job_t *)user_data;
+
+  preload_spy_scan_apply (job->scan, job->data);
+  proc_scan_free (job->scan);
+  job->done (job->data, NULL);
+  g_free (job);
+  return FALSE;
+}
+
+static gpointer
+scan_worker (gpointer G_GNUC_UNUSED user_data)
+{
+  scan_job_t *job;
+
+  while ((job = g_async_queue_pop (scan_jobs)) != &scan_quit) {
+    job->scan = proc_scan_take ();
+    g_idle_add (scan_job_done, job);
+  }
+
+  return NULL;
+}
+
+void
+preload_spy_scan_async (GFunc done, gpointer data)
+{
+  scan_job_t *job;
+
+  if (!scan_thread) {
+    scan_jobs = g_async_queue_new ();
+    scan_thread = g_thread_new ("scan", scan_worker, NULL);
+  }
+
+  job = g_new0 (scan_job_t, 1);
+  job->done = done;
+  job->data = data;
+  g_async_queue_push (scan_jobs, job);
+}
+
+void
+preload_spy_stop (void)
+{
+  if (!scan_thread)
+    return;
+
+  g_async_queue_push (scan_jobs, &scan_quit);
+  g_thread_join (scan_thread);
+  g_async_queue_unref (scan_jobs);
+  scan_thread = NULL;
+  scan_jobs = NULL;
+}
+
 /* update_model is run after scan, after some delay (half a cycle) */
 
 void
@@ -203,14 +493,32 @@ preload_spy_update_model (gpointer data)
   g_hash_table_destroy (new_exes);
   new_exes = NULL;  /* Prevent double-free on next scan */
 
+  /* exes registered under an engine without chains, or loaded so, get
+   * theirs once the engine wants them */
+  if (engine_chains ())
+    preload_markov_complete ();
+
+  /* learn what running ones mapped since */
+  refresh_exemaps ();
+
   /* and adjust states for those changing */
   g_slist_foreach (state_changed_exes, (GFunc)exe_changed_callback, data);
   g_slist_free (state_changed_exes);
   state_changed_exes = NULL;  /* Prevent double-free on next scan */
 
+  /* from now on, get told when they exit */
+  g_slist_foreach (state->running_exes, (GFunc)watch_running_exe, data);
+
   /* do some accounting */
   period = (int)(state->time - state->last_accounting_timestamp);
   g_hash_table_foreach (state->exes, (GHFunc)running_exe_inc_time, GINT_TO_POINTER (period));
   preload_markov_foreach ((GFunc)running_markov_inc_time, GINT_TO_POINTER (period));
   state->last_accounting_timestamp = state->time;
+
+  /* the logistic engine learns from what started since */
+  if (preload_algorithm () == ALGORITHM_LOGISTIC)
+    preload_logistic_observe ();
+
+  /* under any engine, the running set tells which workload is on */
+  preload_profile_update ();
 }
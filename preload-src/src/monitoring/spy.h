@@ -2,8 +2,17 @@
 #define SPY_H
 
 #include <glib.h>
+#include "proc.h"
 
 void preload_spy_scan (gpointer data);
+
+/* applies a scan of /proc taken earlier to the model */
+void preload_spy_scan_apply (proc_scan_t *scan, gpointer data);
+
+/* same, listing processes on a worker thread; done (data, NULL) is called
+ * from the main loop once the scan was applied */
+void preload_spy_scan_async (GFunc done, gpointer data);
+void preload_spy_stop (void);
 void preload_spy_update_model (gpointer data);
 
 #endif
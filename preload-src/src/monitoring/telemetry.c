@@ -0,0 +1,328 @@
+/* telemetry.c - Per-tick system telemetry sampler
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "telemetry.h"
+#include "log.h"
+#include "state.h"
+
+#include <stddef.h>
+
+typedef enum
+{
+  FIELD_INT,	/* "key value" into an int */
+  FIELD_U64,	/* "key value" into a guint64 */
+  FIELD_AVG10	/* "key avg10=value ..." into a double */
+} field_type_t;
+
+typedef struct
+{
+  const char *key;
+  size_t offset;
+  field_type_t type;
+} field_t;
+
+#define SNAP(member) offsetof (preload_telemetry_t, member)
+
+static const field_t meminfo_fields[] = {
+  { "MemTotal:",	SNAP (mem.total),		FIELD_INT },
+  { "MemFree:",		SNAP (mem.free),		FIELD_INT },
+  { "MemAvailable:",	SNAP (mem.available),		FIELD_INT },
+  { "Buffers:",		SNAP (mem.buffers),		FIELD_INT },
+  { "Cached:",		SNAP (mem.cached),		FIELD_INT },
+  { "Active:",		SNAP (mem.active),		FIELD_INT },
+  { "Inactive:",	SNAP (mem.inactive),		FIELD_INT },
+  { "Active(anon):",	SNAP (mem.active_anon),		FIELD_INT },
+  { "Inactive(anon):",	SNAP (mem.inactive_anon),	FIELD_INT },
+  { "Active(file):",	SNAP (mem.active_file),		FIELD_INT },
+  { "Inactive(file):",	SNAP (mem.inactive_file),	FIELD_INT },
+  { "SwapTotal:",	SNAP (swaptotal),		FIELD_INT },
+  { "SwapFree:",	SNAP (swapfree),		FIELD_INT },
+  { NULL, 0, 0 }
+};
+
+static const field_t vmstat_fields[] = {
+  { "pgpgin",		SNAP (mem.pagein),		FIELD_INT },
+  { "pgpgout",		SNAP (mem.pageout),		FIELD_INT },
+  { "pswpin",		SNAP (pswpin),			FIELD_U64 },
+  { "pswpout",		SNAP (pswpout),			FIELD_U64 },
+  { "pgmajfault",	SNAP (pgmajfault),		FIELD_U64 },
+  { NULL, 0, 0 }
+};
+
+static const field_t psi_memory_fields[] = {
+  { "some",		SNAP (memory_some),		FIELD_AVG10 },
+  { "full",		SNAP (memory_full),		FIELD_AVG10 },
+  { NULL, 0, 0 }
+};
+
+static const field_t psi_io_fields[] = {
+  { "some",		SNAP (io_some),			FIELD_AVG10 },
+  { "full",		SNAP (io_full),			FIELD_AVG10 },
+  { NULL, 0, 0 }
+};
+
+typedef struct
+{
+  const char *path;
+  const field_t *fields;	/* NULL for diskstats, which is not keyed */
+  int fd;			/* -1 if not open yet, -2 if not available */
+} source_t;
+
+static source_t sources[TELEMETRY_SOURCES] = {
+  [TELEMETRY_MEMINFO]    = { "/proc/meminfo", meminfo_fields, -1 },
+  [TELEMETRY_VMSTAT]     = { "/proc/vmstat", vmstat_fields, -1 },
+  [TELEMETRY_PSI_MEMORY] = { "/proc/pressure/memory", psi_memory_fields, -1 },
+  [TELEMETRY_PSI_IO]     = { "/proc/pressure/io", psi_io_fields, -1 },
+  [TELEMETRY_DISKSTATS]  = { "/proc/diskstats", NULL, -1 },
+};
+
+static preload_telemetry_t snapshot;
+
+static char *buf;
+static size_t bufsize;
+
+
+static void
+store_field (preload_telemetry_t *snap, const field_t *field, const char *value)
+{
+  char *dest = (char *)snap + field->offset;
+
+  switch (field->type) {
+  case FIELD_INT:
+    *(int *)dest = (int)strtol (value, NULL, 10);
+    break;
+  case FIELD_U64:
+    *(guint64 *)dest = g_ascii_strtoull (value, NULL, 10);
+    break;
+  case FIELD_AVG10:
+    if (!strncmp (value, "avg10=", 6))
+      *(double *)dest = g_ascii_strtod (value + 6, NULL);
+    break;
+  }
+}
+
+/* one pass over "key value" lines, picking the keys in fields */
+static void
+parse_keyed (preload_telemetry_t *snap, const field_t *fields, const char *p)
+{
+  while (*p) {
+    const char *key = p, *value, *eol;
+    size_t keylen;
+    const field_t *field;
+
+    eol = strchrnul (p, '\n');
+    keylen = strcspn (key, " \t\n");
+    value = key + keylen;
+    while (*value == ' ' || *value == '\t')
+      value++;
+
+    for (field = fields; field->key; field++)
+      if (strlen (field->key) == keylen && !memcmp (field->key, key, keylen)) {
+	store_field (snap, field, value);
+	break;
+      }
+
+    p = *eol ? eol + 1 : eol;
+  }
+}
+
+static gboolean
+has_prefix (const char *name, const char *prefix)
+{
+  return !strncmp (name, prefix, strlen (prefix));
+}
+
+/* whether name is a partition of disk: sda1 of sda, nvme0n1p1 of nvme0n1 */
+static gboolean
+is_partition_of (const char *name, const char *disk)
+{
+  size_t len = strlen (disk);
+
+  if (!*disk || strncmp (name, disk, len))
+    return FALSE;
+  name += len;
+  if (*name == 'p')
+    name++;
+  if (!*name)
+    return FALSE;
+  for (; *name; name++)
+    if (!g_ascii_isdigit (*name))
+      return FALSE;
+  return TRUE;
+}
+
+/* sums up whole physical disks.  partitions follow their disk, and stacked
+ * or memory-backed devices would count the same I/O twice or none at all. */
+static void
+parse_diskstats (preload_telemetry_t *snap, const char *p)
+{
+  char disk[32] = "";
+
+  while (*p) {
+    const char *eol = strchrnul (p, '\n');
+    char name[32];
+    unsigned long long sectors_read, sectors_written, busy;
+
+    if (4 == sscanf (p, "%*u %*u %31s %*u %*u %llu %*u %*u %*u %llu %*u %*u %llu",
+		     name, &sectors_read, &sectors_written, &busy)
+	&& !is_partition_of (name, disk)
+	&& !has_prefix (name, "loop") && !has_prefix (name, "ram")
+	&& !has_prefix (name, "zram") && !has_prefix (name, "dm-")
+	&& !has_prefix (name, "md")) {
+      g_strlcpy (disk, name, sizeof (disk));
+      snap->disk_read += sectors_read / 2;
+      snap->disk_written += sectors_written / 2;
+      snap->disk_busy += busy;
+    }
+
+    p = *eol ? eol + 1 : eol;
+  }
+}
+
+void
+preload_telemetry_parse (preload_telemetry_t *snap, preload_telemetry_source_t source, const char *text)
+{
+  g_return_if_fail (source < TELEMETRY_SOURCES);
+
+  if (sources[source].fields)
+    parse_keyed (snap, sources[source].fields, text);
+  else
+    parse_diskstats (snap, text);
+}
+
+/* reads the whole file into buf, growing it as needed */
+static const char *
+read_source (preload_telemetry_source_t source)
+{
+  source_t *src = &sources[source];
+  ssize_t len;
+
+  if (src->fd == -1) {
+    src->fd = open (src->path, O_RDONLY | O_CLOEXEC);
+    if (src->fd == -1) {
+      g_debug ("%s not available: %s", src->path, strerror (errno));
+      src->fd = -2;
+    }
+  }
+  if (src->fd < 0)
+    return NULL;
+
+  if (!buf) {
+    bufsize = 8192;
+    buf = g_malloc (bufsize);
+  }
+
+  while ((len = pread (src->fd, buf, bufsize - 1, 0)) == (ssize_t)bufsize - 1) {
+    bufsize *= 2;
+    buf = g_realloc (buf, bufsize);
+  }
+  if (len < 0)
+    return NULL;
+
+  buf[len] = '\0';
+  return buf;
+}
+
+static void
+sample_source (preload_telemetry_t *snap, preload_telemetry_source_t source)
+{
+  const char *text = read_source (source);
+
+  if (text)
+    preload_telemetry_parse (snap, source, text);
+}
+
+static int
+rate (guint64 now, guint64 before, gint64 usecs)
+{
+  if (now < before || usecs <= 0)
+    return 0;
+  return (int)((now - before) * G_USEC_PER_SEC / usecs);
+}
+
+void
+preload_telemetry_sample (void)
+{
+  static int pagesize = 0;
+  preload_telemetry_t snap;
+  preload_telemetry_source_t source;
+  gint64 elapsed;
+
+  if (!pagesize)
+    pagesize = getpagesize ();
+
+  memset (&snap, 0, sizeof (snap));
+  snap.memory_some = snap.memory_full = snap.io_some = snap.io_full = -1;
+  snap.time = state->time;
+  snap.sampled = g_get_monotonic_time ();
+
+  for (source = 0; source < TELEMETRY_SOURCES; source++)
+    sample_source (&snap, source);
+
+  snap.mem.pagein *= pagesize / 1024;
+  snap.mem.pageout *= pagesize / 1024;
+
+  /* Fallback for MemAvailable (pre Linux 3.14) */
+  if (!snap.mem.available && snap.mem.free) {
+    /* Approximate: free + (cached - min cache) + (buffers portion)
+     * This is a rough estimate; kernel's calculation is more complex */
+    snap.mem.available = snap.mem.free + (snap.mem.cached * 80 / 100) + (snap.mem.buffers * 75 / 100);
+  }
+
+  if (!snap.mem.total || !snap.mem.pagein)
+    g_warning ("failed to read memory stat, is /proc mounted?");
+
+  if (snapshot.sampled) {
+    elapsed = snap.sampled - snapshot.sampled;
+    snap.disk_read_rate = rate (snap.disk_read, snapshot.disk_read, elapsed);
+    snap.disk_write_rate = rate (snap.disk_written, snapshot.disk_written, elapsed);
+    snap.disk_util = rate (snap.disk_busy, snapshot.disk_busy, elapsed) / 10;
+    snap.majfault_rate = rate (snap.pgmajfault, snapshot.pgmajfault, elapsed);
+  }
+
+  snapshot = snap;
+}
+
+const preload_telemetry_t *
+preload_telemetry (void)
+{
+  return &snapshot;
+}
+
+double
+preload_telemetry_memory_pressure (void)
+{
+  preload_telemetry_t snap;
+
+  memset (&snap, 0, sizeof (snap));
+  snap.memory_some = -1;
+  sample_source (&snap, TELEMETRY_PSI_MEMORY);
+  return snap.memory_some;
+}
+
+void
+preload_telemetry_free (void)
+{
+  preload_telemetry_source_t source;
+
+  for (source = 0; source < TELEMETRY_SOURCES; source++) {
+    if (sources[source].fd >= 0)
+      close (sources[source].fd);
+    sources[source].fd = -1;
+  }
+
+  g_free (buf);
+  buf = NULL;
+  bufsize = 0;
+  memset (&snapshot, 0, sizeof (snapshot));
+}
@@ -0,0 +1,82 @@
+/* telemetry.h - Per-tick system telemetry sampler
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <glib.h>
+#include "proc.h"
+
+/*
+ * System state is sampled once per tick from /proc/meminfo, /proc/vmstat,
+ * /proc/pressure/{memory,io} and /proc/diskstats.  The files are kept open
+ * and re-read with pread, and each is parsed in a single pass against a
+ * table of the fields we want.  The result is published as one snapshot,
+ * so every decision made in a cycle sees the same numbers.
+ */
+
+/* preload_telemetry_t: a snapshot of system state */
+typedef struct _preload_telemetry_t
+{
+  int time;		/* state->time when sampled */
+  gint64 sampled;	/* monotonic time when sampled, in microseconds */
+
+  preload_memory_t mem;	/* meminfo, plus pagein/pageout from vmstat */
+  int swaptotal;	/* kilobytes */
+  int swapfree;		/* kilobytes */
+
+  /* vmstat counters since boot */
+  guint64 pswpin;	/* pages swapped in */
+  guint64 pswpout;	/* pages swapped out */
+  guint64 pgmajfault;	/* major faults */
+
+  /* PSI "avg10" in percent, -1 if not available */
+  double memory_some;
+  double memory_full;
+  double io_some;
+  double io_full;
+
+  /* all whole disks, since boot */
+  guint64 disk_read;	/* kilobytes read */
+  guint64 disk_written;	/* kilobytes written */
+  guint64 disk_busy;	/* milliseconds any disk was busy */
+
+  /* rates since the previous snapshot, 0 for the first one */
+  int disk_read_rate;	/* kilobytes per second */
+  int disk_write_rate;	/* kilobytes per second */
+  int disk_util;	/* percent of time busy, summed over disks */
+  int majfault_rate;	/* major faults per second */
+} preload_telemetry_t;
+
+/* sources, for preload_telemetry_parse */
+typedef enum
+{
+  TELEMETRY_MEMINFO,
+  TELEMETRY_VMSTAT,
+  TELEMETRY_PSI_MEMORY,
+  TELEMETRY_PSI_IO,
+  TELEMETRY_DISKSTATS,
+  TELEMETRY_SOURCES
+} preload_telemetry_source_t;
+
+/* takes a new snapshot; called at the start of every tick */
+void preload_telemetry_sample (void);
+
+/* the latest snapshot; all zero before the first sample */
+const preload_telemetry_t *preload_telemetry (void);
+
+/* parses the contents of one source into snap */
+void preload_telemetry_parse (preload_telemetry_t *snap, preload_telemetry_source_t source, const char *buf);
+
+/* current PSI memory "some avg10", read outside the snapshot for watchdogs
+ * that run more often than ticks; -1 if not available */
+double preload_telemetry_memory_pressure (void);
+
+/* closes the files */
+void preload_telemetry_free (void);
+
+#endif
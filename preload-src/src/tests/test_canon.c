@@ -0,0 +1,213 @@
+/* test_canon.c - Unit tests for path canonicalization
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "canon.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(expr) ASSERT_TRUE(!(expr))
+
+#define ASSERT_STR_EQ(a, b) do { \
+    if (strcmp((a), (b)) != 0) { \
+        fprintf(stderr, "  FAIL: %s:%d: \"%s\" != \"%s\"\n", __FILE__, __LINE__, (a), (b)); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+
+static char *test_prefix[] = { "!/nix/store/skip", "/nix/store/", "/opt/", NULL };
+
+
+static int test_rewrite_nix(void)
+{
+    char key[512];
+
+    ASSERT_TRUE(preload_canon_rewrite(
+        "/nix/store/0c3ay4zzi6j0a0pkvq1k1jyz4hb2qx5q-firefox-120.0.1/bin/firefox",
+        test_prefix, key, sizeof(key)));
+    ASSERT_STR_EQ(key, "/nix/store/firefox/bin/firefox");
+
+    /* output suffix after the version is kept */
+    ASSERT_TRUE(preload_canon_rewrite(
+        "/nix/store/0c3ay4zzi6j0a0pkvq1k1jyz4hb2qx5q-glib-2.78.0-bin/bin/gio",
+        test_prefix, key, sizeof(key)));
+    ASSERT_STR_EQ(key, "/nix/store/glib-bin/bin/gio");
+
+    /* unversioned store path: only the hash goes */
+    ASSERT_TRUE(preload_canon_rewrite(
+        "/nix/store/0c3ay4zzi6j0a0pkvq1k1jyz4hb2qx5q-hello/bin/hello",
+        test_prefix, key, sizeof(key)));
+    ASSERT_STR_EQ(key, "/nix/store/hello/bin/hello");
+
+    /* release and revision go together, the output suffix stays */
+    ASSERT_TRUE(preload_canon_rewrite(
+        "/nix/store/0c3ay4zzi6j0a0pkvq1k1jyz4hb2qx5q-glibc-2.38-44/lib/libc.so.6",
+        test_prefix, key, sizeof(key)));
+    ASSERT_STR_EQ(key, "/nix/store/glibc/lib/libc.so.6");
+    ASSERT_TRUE(preload_canon_rewrite(
+        "/nix/store/0c3ay4zzi6j0a0pkvq1k1jyz4hb2qx5q-glibc-2.38-44-bin/bin/ldd",
+        test_prefix, key, sizeof(key)));
+    ASSERT_STR_EQ(key, "/nix/store/glibc-bin/bin/ldd");
+
+    return TEST_PASS;
+}
+
+
+static int test_rewrite_opt(void)
+{
+    char key[512];
+
+    ASSERT_TRUE(preload_canon_rewrite("/opt/app-1.2.3/lib/libapp.so",
+                                      test_prefix, key, sizeof(key)));
+    ASSERT_STR_EQ(key, "/opt/app/lib/libapp.so");
+
+    /* nothing to strip */
+    ASSERT_FALSE(preload_canon_rewrite("/opt/app/lib/libapp.so",
+                                       test_prefix, key, sizeof(key)));
+
+    return TEST_PASS;
+}
+
+
+static int test_rewrite_no_match(void)
+{
+    char key[512];
+
+    ASSERT_FALSE(preload_canon_rewrite("/usr/lib/libc.so.6",
+                                       test_prefix, key, sizeof(key)));
+
+    /* excluded by '!' rule */
+    ASSERT_FALSE(preload_canon_rewrite("/nix/store/skip-1.0/bin/skip",
+                                       test_prefix, key, sizeof(key)));
+
+    /* a plain file directly below the prefix is not an install location */
+    ASSERT_FALSE(preload_canon_rewrite("/opt/tool-1.0",
+                                       test_prefix, key, sizeof(key)));
+
+    /* no rules configured */
+    ASSERT_FALSE(preload_canon_rewrite("/opt/app-1.2.3/lib/libapp.so",
+                                       NULL, key, sizeof(key)));
+
+    /* key would not fit */
+    ASSERT_FALSE(preload_canon_rewrite("/opt/app-1.2.3/lib/libapp.so",
+                                       test_prefix, key, 8));
+
+    return TEST_PASS;
+}
+
+
+static int test_register_realpath(void)
+{
+    const char *key = "/opt/app/bin/app";
+
+    ASSERT_FALSE(preload_canon_is_key(key));
+    ASSERT_STR_EQ(preload_canon_realpath(key), key);
+
+    preload_canon_register(key, "/opt/app-1.0/bin/app");
+    ASSERT_TRUE(preload_canon_is_key(key));
+    ASSERT_STR_EQ(preload_canon_realpath(key), "/opt/app-1.0/bin/app");
+
+    /* upgrade: latest location wins */
+    preload_canon_register(key, "/opt/app-2.0/bin/app");
+    ASSERT_STR_EQ(preload_canon_realpath(key), "/opt/app-2.0/bin/app");
+
+    preload_canon_free();
+    ASSERT_FALSE(preload_canon_is_key(key));
+
+    return TEST_PASS;
+}
+
+
+static int test_register_coinstalled(void)
+{
+    char dir[] = "/tmp/test_canon_XXXXXX";
+    char *old, *new;
+    const char *key = "/opt/jdk/bin/java";
+
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    old = g_build_filename(dir, "jdk-17", NULL);
+    new = g_build_filename(dir, "jdk-21", NULL);
+    ASSERT_TRUE(g_file_set_contents(old, "", 0, NULL));
+    ASSERT_TRUE(g_file_set_contents(new, "", 0, NULL));
+
+    ASSERT_TRUE(preload_canon_register(key, old));
+    ASSERT_TRUE(preload_canon_register(key, old));
+
+    /* both installed: the key stays with the first */
+    ASSERT_FALSE(preload_canon_register(key, new));
+    ASSERT_STR_EQ(preload_canon_realpath(key), old);
+
+    /* the first one removed: an upgrade after all */
+    unlink(old);
+    ASSERT_TRUE(preload_canon_register(key, new));
+    ASSERT_STR_EQ(preload_canon_realpath(key), new);
+
+    preload_canon_free();
+    unlink(new);
+    rmdir(dir);
+    g_free(old);
+    g_free(new);
+    return TEST_PASS;
+}
+
+
+int test_canon_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_rewrite_nix... ");
+    if (test_rewrite_nix() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_rewrite_opt... ");
+    if (test_rewrite_opt() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_rewrite_no_match... ");
+    if (test_rewrite_no_match() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_register_realpath... ");
+    if (test_register_realpath() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_register_coinstalled... ");
+    if (test_register_coinstalled() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
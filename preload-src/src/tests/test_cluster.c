@@ -0,0 +1,189 @@
+/* test_cluster.c - Unit tests for clusters of exes that run together
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "conf.h"
+#include "state.h"
+#include "state_io.h"
+#include "exe.h"
+#include "markov.h"
+#include "cluster.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+
+static void test_init_state(void)
+{
+    memset(state, 0, sizeof(*state));
+    state->time = 10000;
+    state->exes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)preload_exe_free);
+    state->bad_exes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->maps = g_hash_table_new((GHashFunc)preload_map_hash, (GEqualFunc)preload_map_equal);
+    state->maps_arr = g_ptr_array_new();
+    conf->model.cycle = 20;
+    conf->model.clustersim = 90;
+}
+
+static void test_cleanup_state(void)
+{
+    g_hash_table_destroy(state->exes);
+    g_hash_table_destroy(state->bad_exes);
+    g_hash_table_destroy(state->maps);
+    g_ptr_array_free(state->maps_arr, TRUE);
+    memset(state, 0, sizeof(*state));
+}
+
+static preload_exe_t *new_exe(const char *path, int time)
+{
+    preload_exe_t *exe = preload_exe_new(path, FALSE, NULL);
+    exe->time = time;
+    preload_state_register_exe(exe, TRUE);
+    return exe;
+}
+
+static preload_markov_t *chain(preload_exe_t *a, preload_exe_t *b)
+{
+    guint i;
+
+    for (i = 0; i < a->markovs->len; i++) {
+        preload_markov_t *markov = g_ptr_array_index(a->markovs, i);
+        if (markov_other_exe(markov, a) == b)
+            return markov;
+    }
+    return NULL;
+}
+
+/* app and helper run together nearly always, the editor on its own */
+static void make_exes(preload_exe_t **app, preload_exe_t **helper, preload_exe_t **editor)
+{
+    *app = new_exe("/usr/bin/app", 1000);
+    *helper = new_exe("/usr/lib/app/helper", 980);
+    *editor = new_exe("/usr/bin/editor", 1000);
+    chain(*app, *helper)->time = 960;
+    chain(*app, *editor)->time = 300;
+    chain(*helper, *editor)->time = 300;
+}
+
+
+static int test_update(void)
+{
+    preload_exe_t *app, *helper, *editor, *other;
+
+    test_init_state();
+    make_exes(&app, &helper, &editor);
+
+    /* not yet, if disabled */
+    conf->model.clustersim = 0;
+    ASSERT_EQ(preload_cluster_update(), 0);
+    conf->model.clustersim = 90;
+
+    ASSERT_EQ(preload_cluster_update(), 1);
+    ASSERT_TRUE(helper->cluster == app);
+    ASSERT_TRUE(app->cluster == NULL && editor->cluster == NULL);
+    ASSERT_EQ(helper->markovs->len, 0);
+    ASSERT_EQ(app->markovs->len, 1);
+    ASSERT_EQ(editor->markovs->len, 1);
+
+    /* new exes get no chains with members */
+    other = new_exe("/usr/bin/other", 0);
+    ASSERT_EQ(other->markovs->len, 2);
+    ASSERT_TRUE(chain(other, helper) == NULL);
+
+    /* a second pass has nothing more to do */
+    ASSERT_EQ(preload_cluster_update(), 0);
+
+    /* the leader's probability is the members' */
+    app->lnprob = -0.5;
+    helper->lnprob = 0;
+    preload_cluster_share_probs();
+    ASSERT_TRUE(helper->lnprob == -0.5);
+
+    /* starting on its own, the helper leaves, with chains again */
+    state->last_running_timestamp = state->time;
+    helper->running_timestamp = state->time;
+    preload_cluster_exe_changed(helper);
+    ASSERT_TRUE(helper->cluster == NULL);
+    ASSERT_EQ(helper->markovs->len, 3);
+
+    /* as do the members of a leader going away */
+    preload_cluster_join(helper, app);
+    ASSERT_EQ(helper->markovs->len, 0);
+    preload_state_unregister_exe(app);
+    ASSERT_TRUE(helper->cluster == NULL);
+    ASSERT_EQ(helper->markovs->len, 2);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_persist(void)
+{
+    char tmpfile[] = "/tmp/preload_test_XXXXXX";
+    preload_exe_t *app, *helper, *editor;
+    int fd = mkstemp(tmpfile);
+
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    test_init_state();
+    make_exes(&app, &helper, &editor);
+    ASSERT_EQ(preload_cluster_update(), 1);
+    ASSERT_TRUE(preload_state_write_file(tmpfile) == NULL);
+    test_cleanup_state();
+
+    test_init_state();
+    ASSERT_TRUE(preload_state_read_file(tmpfile) == NULL);
+    app = g_hash_table_lookup(state->exes, "/usr/bin/app");
+    helper = g_hash_table_lookup(state->exes, "/usr/lib/app/helper");
+    ASSERT_TRUE(app != NULL && helper != NULL);
+    ASSERT_TRUE(helper->cluster == app);
+    ASSERT_EQ(helper->markovs->len, 0);
+    ASSERT_EQ(app->markovs->len, 1);
+    test_cleanup_state();
+
+    unlink(tmpfile);
+    return TEST_PASS;
+}
+
+
+int test_cluster_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_update... ");
+    if (test_update() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_persist... ");
+    if (test_persist() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
@@ -0,0 +1,164 @@
+/* test_ephemeral.c - Unit tests for telling ephemeral exes apart
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "conf.h"
+#include "state.h"
+#include "ephemeral.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(expr) ASSERT_TRUE(!(expr))
+
+
+static int test_pattern(void)
+{
+    char *patterns[] = { "*/proton_*/*", NULL };
+
+    state->time = 1000;
+    conf->system.ephemeralexe = patterns;
+
+    ASSERT_FALSE(preload_ephemeral_known("/var/tmp/proton_x1/wine"));
+    ASSERT_TRUE(preload_ephemeral_classify("/var/tmp/proton_x1/wine"));
+    ASSERT_TRUE(preload_ephemeral_known("/var/tmp/proton_x1/wine"));
+    ASSERT_FALSE(preload_ephemeral_classify("/usr/bin/wine"));
+    ASSERT_FALSE(preload_ephemeral_known("/usr/bin/wine"));
+
+    conf->system.ephemeralexe = NULL;
+    preload_ephemeral_free();
+    ASSERT_FALSE(preload_ephemeral_known("/var/tmp/proton_x1/wine"));
+    return TEST_PASS;
+}
+
+
+static int test_learn(void)
+{
+    state->time = 1000;
+
+    /* uninstalled long after they were first seen: not learned */
+    preload_ephemeral_vanished("/opt/app/a", 7 * 24 * 3600);
+    preload_ephemeral_vanished("/opt/app/b", -1);
+    preload_ephemeral_vanished("/opt/app/c", 30 * 24 * 3600);
+    ASSERT_FALSE(preload_ephemeral_classify("/opt/app/d"));
+
+    /* test binaries of a build tree, gone soon after */
+    preload_ephemeral_vanished("/tmp/test_a", 60);
+    preload_ephemeral_vanished("/tmp/test_b", 60);
+    ASSERT_FALSE(preload_ephemeral_classify("/tmp/test_c"));
+    preload_ephemeral_vanished("/tmp/test_c", 60);
+    ASSERT_TRUE(preload_ephemeral_classify("/tmp/test_d"));
+    /* the directory itself, not those under it */
+    ASSERT_FALSE(preload_ephemeral_classify("/tmp/sub/test_e"));
+
+    /* each in a directory of its own that went away too */
+    preload_ephemeral_vanished("/nonexistent/unpack/x1/tool", 10);
+    preload_ephemeral_vanished("/nonexistent/unpack/x2/tool", 10);
+    preload_ephemeral_vanished("/nonexistent/unpack/x3/tool", 10);
+    ASSERT_TRUE(preload_ephemeral_classify("/nonexistent/unpack/x4/tool"));
+    ASSERT_FALSE(preload_ephemeral_classify("/nonexistent/unpack/tool"));
+    ASSERT_FALSE(preload_ephemeral_classify("/nonexistent/other/tool"));
+
+    /* nothing learned from the root */
+    preload_ephemeral_vanished("/a", 10);
+    preload_ephemeral_vanished("/b", 10);
+    preload_ephemeral_vanished("/c", 10);
+    ASSERT_FALSE(preload_ephemeral_classify("/d"));
+
+    preload_ephemeral_free();
+    return TEST_PASS;
+}
+
+
+static void count_dirs(const char *dir, int count, int nested, int time, gpointer user_data)
+{
+    if (!strcmp(dir, "/nonexistent/build") && !nested && time == 900)
+        *(int *)user_data = count;
+}
+
+static int test_persist(void)
+{
+    int count = 0;
+
+    state->time = 1000;
+    preload_ephemeral_learn_dir("/nonexistent/build", 3, 0, 900);
+    ASSERT_TRUE(preload_ephemeral_classify("/nonexistent/build/test_a"));
+    preload_ephemeral_foreach_dir(count_dirs, &count);
+    ASSERT_TRUE(count == 3);
+
+    preload_ephemeral_free();
+    ASSERT_FALSE(preload_ephemeral_classify("/nonexistent/build/test_a"));
+    return TEST_PASS;
+}
+
+
+static int test_age(void)
+{
+    state->time = 1000;
+    preload_ephemeral_learn_dir("/nonexistent/build", 4, 0, 1000);
+    ASSERT_TRUE(preload_ephemeral_classify("/nonexistent/build/test_a"));
+
+    /* remembered exes are renewed where they are */
+    state->time = 2000;
+    ASSERT_TRUE(preload_ephemeral_known("/nonexistent/build/test_a"));
+
+    /* a week later, half is left: under the threshold */
+    state->time = 1000 + 7 * 24 * 3600;
+    ASSERT_FALSE(preload_ephemeral_classify("/nonexistent/build/test_b"));
+
+    preload_ephemeral_free();
+    return TEST_PASS;
+}
+
+
+int test_ephemeral_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_pattern... ");
+    if (test_pattern() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_learn... ");
+    if (test_learn() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_persist... ");
+    if (test_persist() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_age... ");
+    if (test_age() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
@@ -280,6 +280,58 @@ static int test_exe_foreach_exemap(void)
 }
 
 
+static GPtrArray *snapshot_of(preload_map_t *a, preload_map_t *b)
+{
+    GPtrArray *snapshot = g_ptr_array_new();
+    g_ptr_array_add(snapshot, preload_exemap_new(a));
+    g_ptr_array_add(snapshot, preload_exemap_new(b));
+    return snapshot;
+}
+
+static int test_exe_update_exemaps(void)
+{
+    int i;
+
+    test_init_state();
+    
+    preload_exe_t *exe = preload_exe_new("/usr/bin/test", FALSE, NULL);
+    preload_map_t *a = preload_map_new("/usr/lib/a.so", 0, 1024);
+    preload_map_t *b = preload_map_new("/usr/lib/b.so", 0, 2048);
+    preload_map_t *c = preload_map_new("/usr/lib/plugin.so", 0, 4096);
+    preload_exemap_t *ea = preload_exemap_new_from_exe(exe, a);
+    preload_exemap_t *eb = preload_exemap_new_from_exe(exe, b);
+    preload_exemap_t *ec;
+    
+    /* b went away and a plugin came */
+    ASSERT_TRUE(preload_exe_update_exemaps(exe, snapshot_of(a, c)));
+    ASSERT_EQ(exe->exemaps->len, 3);
+    ASSERT_EQ(exe->size, 1024 + 2048 + 4096);
+    ec = g_ptr_array_index(exe->exemaps, 2);
+    ASSERT_TRUE(ec->map == c);
+    ASSERT_TRUE(ea->prob == 1.0);
+    ASSERT_TRUE(eb->prob < 0.9 && eb->prob > 0.7);
+    ASSERT_TRUE(ec->prob > 0.1 && ec->prob < 0.3);
+    ASSERT_EQ(c->refcount, 1);
+    
+    /* nothing new, same set */
+    ASSERT_FALSE(preload_exe_update_exemaps(exe, snapshot_of(a, c)));
+    ASSERT_EQ(a->refcount, 1);
+    
+    /* b is forgotten eventually */
+    for (i = 0; i < 20 && exe->exemaps->len == 3; i++)
+        preload_exe_update_exemaps(exe, snapshot_of(a, c));
+    ASSERT_EQ(exe->exemaps->len, 2);
+    ASSERT_EQ(exe->size, 1024 + 4096);
+    ASSERT_EQ(g_hash_table_size(state->maps), 2);  /* b freed */
+    ASSERT_TRUE(ec->prob > 0.9);
+    
+    preload_exe_free(exe);
+    test_cleanup_state();
+    
+    return TEST_PASS;
+}
+
+
 int test_exe_run(void)
 {
     int failed = 0;
@@ -354,5 +406,12 @@ int test_exe_run(void)
         failed++;
     }
     
+    fprintf(stderr, "  Running test_exe_update_exemaps... ");
+    if (test_exe_update_exemaps() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+    
     return failed;
 }
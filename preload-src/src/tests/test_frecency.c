@@ -0,0 +1,162 @@
+/* test_frecency.c - Unit tests for the frecency prediction engine
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <glib.h>
+
+#include "conf.h"
+#include "state.h"
+#include "state_io.h"
+#include "exe.h"
+#include "frecency.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_NEAR(a, b) ASSERT_TRUE(fabs((a) - (b)) < 1e-6)
+
+#define HOUR 3600
+
+
+static void test_init_state(void)
+{
+    memset(state, 0, sizeof(*state));
+    state->exes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)preload_exe_free);
+    state->bad_exes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->maps = g_hash_table_new((GHashFunc)preload_map_hash, (GEqualFunc)preload_map_equal);
+    state->maps_arr = g_ptr_array_new();
+    conf->model.cycle = 20;
+    conf->model.frecencyhalflife = 24 * HOUR;
+    conf->model.frecencyhourly = TRUE;
+}
+
+static void test_cleanup_state(void)
+{
+    g_hash_table_destroy(state->exes);
+    g_hash_table_destroy(state->bad_exes);
+    g_hash_table_destroy(state->maps);
+    g_ptr_array_free(state->maps_arr, TRUE);
+    memset(state, 0, sizeof(*state));
+}
+
+static preload_exe_t *new_exe(const char *path)
+{
+    preload_exe_t *exe = preload_exe_new(path, FALSE, NULL);
+    preload_state_register_exe(exe, FALSE);
+    return exe;
+}
+
+
+static int test_prob(void)
+{
+    preload_exe_t *editor, *game;
+    int now = 10 * 24 * HOUR;
+    int i;
+
+    test_init_state();
+    editor = new_exe("/usr/bin/editor");
+    game = new_exe("/usr/bin/game");
+    ASSERT_TRUE(preload_frecency_prob(editor, now, 9, 20) == 0);
+
+    /* the editor every morning, the game once, in the evening */
+    for (i = 0; i < 10; i++)
+        preload_frecency_start(editor, i * 24 * HOUR, 9);
+    preload_frecency_start(game, 9 * 24 * HOUR, 21);
+
+    /* a start counts half after a half-life */
+    ASSERT_NEAR(preload_frecency_score(game, 9 * 24 * HOUR), 1);
+    ASSERT_NEAR(preload_frecency_score(game, now), 0.5);
+    ASSERT_TRUE(preload_frecency_score(editor, now) > 0.99);
+
+    ASSERT_TRUE(preload_frecency_prob(editor, now, 9, 20) > preload_frecency_prob(game, now, 9, 20));
+    ASSERT_TRUE(preload_frecency_prob(game, now, 21, 20) > preload_frecency_prob(game, now, 9, 20));
+    ASSERT_TRUE(preload_frecency_prob(editor, now, 9, 20) > preload_frecency_prob(editor, now, 21, 20));
+
+    /* unless told not to look at the hour */
+    conf->model.frecencyhourly = FALSE;
+    ASSERT_NEAR(preload_frecency_prob(editor, now, 9, 20), preload_frecency_prob(editor, now, 21, 20));
+    ASSERT_TRUE(preload_frecency_prob(editor, now, 9, 20) < 1);
+
+    /* running exes are not bid in */
+    state->time = now;
+    editor->running_timestamp = state->last_running_timestamp = now;
+    preload_frecency_predict();
+    ASSERT_TRUE(editor->lnprob == 0);
+    ASSERT_TRUE(game->lnprob < 0);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_persist(void)
+{
+    char tmpfile[] = "/tmp/preload_test_XXXXXX";
+    preload_exe_t *exe;
+    int fd = mkstemp(tmpfile);
+
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    test_init_state();
+    exe = new_exe("/usr/bin/editor");
+    preload_frecency_start(exe, 100, 9);
+    preload_frecency_start(exe, 200, 23);
+    new_exe("/usr/bin/never");
+    ASSERT_TRUE(preload_state_write_file(tmpfile) == NULL);
+    test_cleanup_state();
+
+    test_init_state();
+    ASSERT_TRUE(preload_state_read_file(tmpfile) == NULL);
+    exe = g_hash_table_lookup(state->exes, "/usr/bin/editor");
+    ASSERT_TRUE(exe != NULL);
+    ASSERT_TRUE(exe->frecency_time == 200);
+    ASSERT_TRUE(exe->frecency > 1.99 && exe->frecency <= 2);
+    ASSERT_TRUE(exe->frecency_hour[9] > 0.99 && exe->frecency_hour[9] < 1);
+    ASSERT_TRUE(exe->frecency_hour[23] == 1);
+    ASSERT_TRUE(exe->frecency_hour[0] == 0);
+    exe = g_hash_table_lookup(state->exes, "/usr/bin/never");
+    ASSERT_TRUE(exe != NULL && exe->frecency == 0);
+    test_cleanup_state();
+
+    unlink(tmpfile);
+    return TEST_PASS;
+}
+
+
+int test_frecency_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_prob... ");
+    if (test_prob() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_persist... ");
+    if (test_persist() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
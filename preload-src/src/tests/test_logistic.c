@@ -0,0 +1,168 @@
+/* test_logistic.c - Unit tests for the online logistic prediction engine
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "conf.h"
+#include "state.h"
+#include "state_io.h"
+#include "exe.h"
+#include "logistic.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+
+static void test_init_state(void)
+{
+    memset(state, 0, sizeof(*state));
+    state->exes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)preload_exe_free);
+    state->bad_exes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->maps = g_hash_table_new((GHashFunc)preload_map_hash, (GEqualFunc)preload_map_equal);
+    state->maps_arr = g_ptr_array_new();
+    conf->model.cycle = 20;
+    preload_logistic_reset();
+}
+
+static void test_cleanup_state(void)
+{
+    g_slist_free(state->running_exes);
+    g_hash_table_destroy(state->exes);
+    g_hash_table_destroy(state->bad_exes);
+    g_hash_table_destroy(state->maps);
+    g_ptr_array_free(state->maps_arr, TRUE);
+    memset(state, 0, sizeof(*state));
+    preload_logistic_reset();
+}
+
+static preload_exe_t *new_exe(const char *path)
+{
+    preload_exe_t *exe = preload_exe_new(path, FALSE, NULL);
+    preload_state_register_exe(exe, FALSE);
+    return exe;
+}
+
+/* one scan and model update, with only exe running */
+static void run_cycle(preload_exe_t *exe)
+{
+    state->time += conf->model.cycle;
+    state->last_running_timestamp = state->time;
+    exe->running_timestamp = state->time;
+    g_slist_free(state->running_exes);
+    state->running_exes = g_slist_prepend(NULL, exe);
+    preload_logistic_start(exe);
+    preload_logistic_observe();
+}
+
+
+static int test_learn(void)
+{
+    preload_exe_t *shell, *editor, *game;
+    int i;
+
+    test_init_state();
+    shell = new_exe("/bin/sh");
+    editor = new_exe("/usr/bin/editor");
+    game = new_exe("/usr/bin/game");
+
+    /* nothing is known before a first context */
+    ASSERT_TRUE(preload_logistic_prob(editor) == 0);
+
+    /* the editor always follows the shell; the game never runs */
+    for (i = 0; i < 200; i++) {
+        run_cycle(shell);
+        run_cycle(editor);
+    }
+    ASSERT_TRUE(editor->logistic != NULL);
+    ASSERT_TRUE(game->logistic != NULL);
+
+    run_cycle(shell);
+    ASSERT_TRUE(preload_logistic_prob(shell) == 0);
+    ASSERT_TRUE(preload_logistic_prob(editor) > 0.5);
+    ASSERT_TRUE(preload_logistic_prob(game) < 0.01);
+
+    /* a running exe bids nothing, but has odds of being used again */
+    ASSERT_TRUE(preload_logistic_resume_prob(shell, state->time) > 0);
+    ASSERT_TRUE(preload_logistic_resume_prob(game, state->time) < 0.01);
+
+    /* bids go to those not running */
+    preload_logistic_predict();
+    ASSERT_TRUE(shell->lnprob == 0);
+    ASSERT_TRUE(editor->lnprob < game->lnprob);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_persist(void)
+{
+    char tmpfile[] = "/tmp/preload_test_XXXXXX";
+    preload_exe_t *shell, *editor;
+    float weights[LOGISTIC_WEIGHTS];
+    int fd = mkstemp(tmpfile);
+
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    test_init_state();
+    shell = new_exe("/bin/sh");
+    editor = new_exe("/usr/bin/editor");
+    run_cycle(shell);
+    run_cycle(editor);
+    ASSERT_TRUE(editor->logistic != NULL);
+    ASSERT_TRUE(shell->logistic == NULL);
+    memcpy(weights, editor->logistic, sizeof(weights));
+    ASSERT_TRUE(preload_state_write_file(tmpfile) == NULL);
+    test_cleanup_state();
+
+    test_init_state();
+    ASSERT_TRUE(preload_state_read_file(tmpfile) == NULL);
+    editor = g_hash_table_lookup(state->exes, "/usr/bin/editor");
+    ASSERT_TRUE(editor != NULL && editor->logistic != NULL);
+    ASSERT_TRUE(memcmp(weights, editor->logistic, sizeof(weights)) == 0);
+    shell = g_hash_table_lookup(state->exes, "/bin/sh");
+    ASSERT_TRUE(shell != NULL && shell->logistic == NULL);
+    test_cleanup_state();
+
+    unlink(tmpfile);
+    return TEST_PASS;
+}
+
+
+int test_logistic_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_learn... ");
+    if (test_learn() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_persist... ");
+    if (test_persist() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
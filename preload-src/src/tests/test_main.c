@@ -74,6 +74,20 @@ extern int test_exe_run(void);
 extern int test_map_run(void);
 extern int test_model_utils_run(void);
 extern int test_time_utils_run(void);
+extern int test_canon_run(void);
+extern int test_proc_run(void);
+extern int test_telemetry_run(void);
+extern int test_stats_run(void);
+extern int test_timeline_run(void);
+extern int test_readahead_run(void);
+extern int test_spawn_run(void);
+extern int test_frecency_run(void);
+extern int test_logistic_run(void);
+extern int test_cluster_run(void);
+extern int test_ephemeral_run(void);
+extern int test_profile_run(void);
+extern int test_spy_run(void);
+extern int test_prophet_run(void);
 
 
 int main(int argc, char **argv)
@@ -108,6 +122,48 @@ int main(int argc, char **argv)
     fprintf(stderr, "\n[Time Utils Tests]\n");
     failed += test_time_utils_run();
     
+    fprintf(stderr, "\n[Canon Tests]\n");
+    failed += test_canon_run();
+    
+    fprintf(stderr, "\n[Proc Tests]\n");
+    failed += test_proc_run();
+    
+    fprintf(stderr, "\n[Telemetry Tests]\n");
+    failed += test_telemetry_run();
+    
+    fprintf(stderr, "\n[Stats Tests]\n");
+    failed += test_stats_run();
+    
+    fprintf(stderr, "\n[Timeline Tests]\n");
+    failed += test_timeline_run();
+    
+    fprintf(stderr, "\n[Readahead Tests]\n");
+    failed += test_readahead_run();
+    
+    fprintf(stderr, "\n[Spawn Tests]\n");
+    failed += test_spawn_run();
+    
+    fprintf(stderr, "\n[Frecency Tests]\n");
+    failed += test_frecency_run();
+    
+    fprintf(stderr, "\n[Logistic Tests]\n");
+    failed += test_logistic_run();
+    
+    fprintf(stderr, "\n[Cluster Tests]\n");
+    failed += test_cluster_run();
+    
+    fprintf(stderr, "\n[Ephemeral Tests]\n");
+    failed += test_ephemeral_run();
+    
+    fprintf(stderr, "\n[Profile Tests]\n");
+    failed += test_profile_run();
+    
+    fprintf(stderr, "\n[Spy Tests]\n");
+    failed += test_spy_run();
+    
+    fprintf(stderr, "\n[Prophet Tests]\n");
+    failed += test_prophet_run();
+    
     fprintf(stderr, "\n=== Test Summary ===\n");
     fprintf(stderr, "Failed: %d\n", failed);
     
@@ -275,6 +275,102 @@ static int test_markov_state_changed(void)
 }
 
 
+static int test_markov_state_changed_at(void)
+{
+    test_init_state();
+    state->time = 100;
+
+    preload_exe_t *exe_a = preload_exe_new("/usr/bin/test_a", FALSE, NULL);
+    preload_exe_t *exe_b = preload_exe_new("/usr/bin/test_b", FALSE, NULL);
+
+    preload_state_register_exe(exe_a, FALSE);
+    preload_state_register_exe(exe_b, FALSE);
+
+    exe_a->running_timestamp = state->last_running_timestamp;
+    preload_markov_t *markov = preload_markov_new(exe_a, exe_b, TRUE);
+    ASSERT_EQ(markov->state, 1);
+    markov->change_timestamp = 100;
+
+    /* A exits between ticks, at an exact time */
+    exe_a->running_timestamp = state->last_running_timestamp - 1;
+    state->time = 150;
+    preload_markov_state_changed_at(markov, 137);
+    ASSERT_EQ(markov->state, 0);
+    ASSERT_EQ(markov->change_timestamp, 137);
+    ASSERT_TRUE(markov->time_to_leave[1] == 37);
+    ASSERT_EQ(markov->weight[1][0], 1);
+
+    /* nothing changed anymore: no-op, even at the same time */
+    preload_markov_state_changed_at(markov, 137);
+    ASSERT_EQ(markov->weight[1][1], 1);
+
+    preload_markov_free(markov, NULL);
+    preload_exe_free(exe_a);
+    preload_exe_free(exe_b);
+    test_cleanup_state();
+
+    return TEST_PASS;
+}
+
+
+static int test_markov_dwell(void)
+{
+    preload_markov_t *markov;
+    preload_exe_t *exe_a, *exe_b;
+    double quick, long_run;
+    int i;
+
+    test_init_state();
+    exe_a = preload_exe_new("/usr/bin/test_a", FALSE, NULL);
+    exe_b = preload_exe_new("/usr/bin/test_b", FALSE, NULL);
+    preload_state_register_exe(exe_a, FALSE);
+    preload_state_register_exe(exe_b, FALSE);
+    markov = preload_markov_new(exe_a, exe_b, TRUE);
+
+    ASSERT_EQ(preload_markov_dwell_bucket(0), 0);
+    ASSERT_EQ(preload_markov_dwell_bucket(7.9), 0);
+    ASSERT_EQ(preload_markov_dwell_bucket(8), 1);
+    ASSERT_EQ(preload_markov_dwell_bucket(20), 2);
+    ASSERT_EQ(preload_markov_dwell_bucket(1e9), MARKOV_DWELL_BUCKETS - 1);
+
+    /* nothing recorded: the exponential of the mean */
+    markov->time_to_leave[1] = 1000;
+    ASSERT_DOUBLE_EQ(preload_markov_leave_prob(markov, 1, 0, 30), 1 - exp(-0.03), 1e-9);
+
+    /* a runs either a few seconds or all day; the mean says neither */
+    for (i = 0; i < 50; i++) {
+        markov->dwell[1][preload_markov_dwell_bucket(5)]++;
+        markov->dwell[1][preload_markov_dwell_bucket(30000)]++;
+    }
+    markov->time_to_leave[1] = 15000;
+    quick = preload_markov_leave_prob(markov, 1, 0, 30);
+    long_run = preload_markov_leave_prob(markov, 1, 600, 30);
+    ASSERT_TRUE(quick > 0.4);
+    ASSERT_TRUE(long_run < 0.01);
+    ASSERT_TRUE(quick > 1 - exp(-30.0 / 15000));
+
+    /* longer than anything seen: back to the mean */
+    ASSERT_DOUBLE_EQ(preload_markov_leave_prob(markov, 1, 1e7, 30), 1 - exp(-30.0 / 15000), 1e-9);
+
+    /* transitions record how long the state lasted, halving on overflow */
+    memset(markov->dwell, 0, sizeof(markov->dwell));
+    markov->dwell[0][3] = 255;
+    markov->state = 0;
+    markov->change_timestamp = 0;
+    exe_a->running_timestamp = state->last_running_timestamp;
+    preload_markov_state_changed_at(markov, 40);
+    ASSERT_EQ(markov->dwell[0][3], 128);
+    ASSERT_EQ(markov->dwell[0][preload_markov_dwell_bucket(40)], 128);
+
+    preload_markov_free(markov, NULL);
+    preload_exe_free(exe_a);
+    preload_exe_free(exe_b);
+    test_cleanup_state();
+
+    return TEST_PASS;
+}
+
+
 static int markov_count = 0;
 
 static void count_markov_callback(gpointer markov, gpointer data)
@@ -319,6 +415,38 @@ static int test_markov_foreach(void)
 }
 
 
+static int test_markov_complete(void)
+{
+    test_init_state();
+
+    preload_exe_t *exe_a = preload_exe_new("/usr/bin/test_a", FALSE, NULL);
+    preload_exe_t *exe_b = preload_exe_new("/usr/bin/test_b", FALSE, NULL);
+    preload_exe_t *exe_c = preload_exe_new("/usr/bin/test_c", FALSE, NULL);
+
+    /* a and b seen under an engine without chains, c after switching */
+    preload_state_register_exe(exe_a, FALSE);
+    preload_state_register_exe(exe_b, FALSE);
+    preload_state_register_exe(exe_c, TRUE);
+    ASSERT_EQ(exe_a->markovs->len, 1);
+    ASSERT_EQ(exe_b->markovs->len, 1);
+    ASSERT_EQ(exe_c->markovs->len, 2);
+
+    /* the missing a-b chain is made, and no pair gets two */
+    preload_markov_complete();
+    ASSERT_EQ(exe_a->markovs->len, 2);
+    ASSERT_EQ(exe_b->markovs->len, 2);
+    ASSERT_EQ(exe_c->markovs->len, 2);
+    ASSERT_TRUE(!state->chainless);
+
+    preload_exe_free(exe_a);
+    preload_exe_free(exe_b);
+    preload_exe_free(exe_c);
+    test_cleanup_state();
+
+    return TEST_PASS;
+}
+
+
 int test_markov_run(void)
 {
     int failed = 0;
@@ -330,6 +458,13 @@ int test_markov_run(void)
         failed++;
     }
     
+    fprintf(stderr, "  Running test_markov_state_changed_at... ");
+    if (test_markov_state_changed_at() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+    
     fprintf(stderr, "  Running test_markov_compute_state... ");
     if (test_markov_compute_state() == TEST_PASS) {
         fprintf(stderr, "PASS\n");
@@ -365,12 +500,26 @@ int test_markov_run(void)
         failed++;
     }
     
+    fprintf(stderr, "  Running test_markov_dwell... ");
+    if (test_markov_dwell() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
     fprintf(stderr, "  Running test_markov_foreach... ");
     if (test_markov_foreach() == TEST_PASS) {
         fprintf(stderr, "PASS\n");
     } else {
         failed++;
     }
+
+    fprintf(stderr, "  Running test_markov_complete... ");
+    if (test_markov_complete() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
     
     return failed;
 }
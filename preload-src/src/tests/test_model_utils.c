@@ -15,6 +15,7 @@
 #include "model_utils.h"
 #include "exe.h"
 #include "map.h"
+#include "canon.h"
 #include "test_helpers.h"
 
 /* Test macros */
@@ -177,6 +178,35 @@ static int test_cleanup_invalid_entries_empty(void)
 }
 
 
+static int test_cleanup_canon_gone(void)
+{
+    preload_exe_t *recent, *old;
+
+    test_init_state();
+    state->time = 30 * 24 * 3600;
+
+    /* both upgraded away, one ran yesterday, one three weeks ago */
+    preload_canon_register("/opt/app/bin/recent", "/nonexistent/app-1.0/bin/recent");
+    preload_canon_register("/opt/app/bin/old", "/nonexistent/app-1.0/bin/old");
+    recent = preload_exe_new("/opt/app/bin/recent", FALSE, NULL);
+    recent->update_time = state->time - 24 * 3600;
+    preload_state_register_exe(recent, FALSE);
+    old = preload_exe_new("/opt/app/bin/old", FALSE, NULL);
+    old->update_time = state->time - 21 * 24 * 3600;
+    preload_state_register_exe(old, FALSE);
+
+    /* the package of the old one is gone for good */
+    ASSERT_EQ(preload_cleanup_invalid_entries(state->exes, state->maps), 1);
+    ASSERT_TRUE(g_hash_table_lookup(state->exes, "/opt/app/bin/recent") == recent);
+    ASSERT_TRUE(g_hash_table_lookup(state->exes, "/opt/app/bin/old") == NULL);
+
+    preload_canon_free();
+    test_cleanup_state();
+
+    return TEST_PASS;
+}
+
+
 int test_model_utils_run(void)
 {
     int failed = 0;
@@ -257,6 +287,13 @@ int test_model_utils_run(void)
     } else {
         failed++;
     }
+
+    fprintf(stderr, "  Running test_cleanup_canon_gone... ");
+    if (test_cleanup_canon_gone() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
     
     return failed;
 }
@@ -0,0 +1,343 @@
+/* test_proc.c - Unit tests for /proc readers
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <glib.h>
+
+#include "proc.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(expr) ASSERT_TRUE(!(expr))
+
+
+static int test_cputime(void)
+{
+    long long t1, t2;
+    volatile unsigned long spin = 0;
+    unsigned long i;
+
+    t1 = proc_get_cputime(getpid());
+    ASSERT_TRUE(t1 >= 0);
+
+    for (i = 0; i < 50000000UL; i++)
+        spin += i;
+
+    /* cpu time never goes back */
+    t2 = proc_get_cputime(getpid());
+    ASSERT_TRUE(t2 >= t1);
+
+    /* no such process */
+    ASSERT_TRUE(proc_get_cputime(-1) == -1);
+
+    return TEST_PASS;
+}
+
+
+static int test_resident_ranges(void)
+{
+    GArray *ranges = g_array_new(FALSE, FALSE, sizeof(preload_range_t));
+    int total, sum = 0;
+    guint i;
+
+    /* we are running, so something is resident */
+    total = proc_get_resident_ranges(getpid(), ranges);
+    ASSERT_TRUE(total > 0);
+    ASSERT_TRUE(ranges->len > 0);
+
+    for (i = 0; i < ranges->len; i++) {
+        preload_range_t *range = &g_array_index(ranges, preload_range_t, i);
+        ASSERT_TRUE(range->length > 0);
+        ASSERT_TRUE(range->kb > 0);
+        ASSERT_TRUE((size_t)range->kb <= range->length / 1024);
+        sum += range->kb;
+    }
+    ASSERT_TRUE(sum == total);
+
+    g_array_free(ranges, TRUE);
+    return TEST_PASS;
+}
+
+
+static int test_swapin_ranges(void)
+{
+    GArray *ranges = g_array_new(FALSE, FALSE, sizeof(preload_range_t));
+    int total;
+
+    /* nothing or something may be swapped, but results must agree */
+    total = proc_get_swapin_ranges(getpid(), ranges);
+    ASSERT_TRUE(total >= 0);
+    ASSERT_TRUE(total > 0 || ranges->len == 0);
+
+    /* no such process */
+    ASSERT_TRUE(proc_get_swapin_ranges(-1, ranges) == 0);
+    ASSERT_TRUE(proc_get_resident_ranges(-1, ranges) == 0);
+
+    g_array_free(ranges, TRUE);
+    return TEST_PASS;
+}
+
+
+typedef struct {
+    pid_t pid;
+    int seen;
+    gpointer data;
+} foreach_probe_t;
+
+static void probe_callback(pid_t pid, const char *path, gpointer *data, gpointer user_data)
+{
+    foreach_probe_t *probe = (foreach_probe_t *)user_data;
+
+    if (pid != probe->pid || !path)
+        return;
+    probe->seen++;
+    probe->data = *data;
+    *data = probe;
+}
+
+static int test_foreach_cached(void)
+{
+    foreach_probe_t probe = { 0, 0, NULL };
+    proc_scan_t *scan;
+
+    probe.pid = fork();
+    ASSERT_TRUE(probe.pid >= 0);
+    if (probe.pid == 0) {
+        pause();
+        _exit(0);
+    }
+
+    /* new process: resolved, empty slot */
+    proc_foreach_cached(probe_callback, &probe);
+    ASSERT_TRUE(probe.seen == 1);
+    ASSERT_TRUE(probe.data == NULL);
+
+    /* unchanged process: slot kept */
+    proc_foreach_cached(probe_callback, &probe);
+    ASSERT_TRUE(probe.seen == 2);
+    ASSERT_TRUE(probe.data == &probe);
+
+    /* forgotten data */
+    proc_cache_forget(&probe);
+    proc_foreach_cached(probe_callback, &probe);
+    ASSERT_TRUE(probe.data == NULL);
+
+    /* forgotten while a scan was in flight */
+    scan = proc_scan_take();
+    proc_cache_forget(&probe);
+    proc_scan_apply(scan, probe_callback, &probe);
+    proc_scan_free(scan);
+    ASSERT_TRUE(probe.seen == 4);
+    ASSERT_TRUE(probe.data == NULL);
+
+    /* the process scanned, until it is gone */
+    ASSERT_TRUE(proc_cache_same_process(probe.pid));
+    ASSERT_TRUE(!proc_cache_same_process(getpid()));
+
+    /* gone process */
+    kill(probe.pid, SIGKILL);
+    waitpid(probe.pid, NULL, 0);
+    ASSERT_TRUE(!proc_cache_same_process(probe.pid));
+    proc_foreach_cached(probe_callback, &probe);
+    ASSERT_TRUE(probe.seen == 4);
+
+    proc_cache_flush();
+    return TEST_PASS;
+}
+
+
+typedef struct {
+    pid_t pid;
+    char *path;
+    gpointer data;
+} exec_probe_t;
+
+static void exec_probe_callback(pid_t pid, const char *path, gpointer *data, gpointer user_data)
+{
+    exec_probe_t *probe = (exec_probe_t *)user_data;
+
+    if (pid != probe->pid)
+        return;
+    g_free(probe->path);
+    probe->path = g_strdup(path);
+    probe->data = *data;
+    *data = probe;
+}
+
+static int test_exec_noticed(void)
+{
+    exec_probe_t probe = { 0, NULL, NULL };
+    const char *sleep_path = access("/bin/sleep", X_OK) == 0 ? "/bin/sleep" : "/usr/bin/sleep";
+    char dir[] = "/tmp/test_proc_XXXXXX";
+    char *before, *comm = NULL, *after = NULL, *name, *link;
+    int go[2], done[2];
+    char c = 0;
+
+    /* a wrapper exec'ing the real thing keeps its comm, do the same */
+    ASSERT_TRUE(access(sleep_path, X_OK) == 0);
+    ASSERT_TRUE(g_file_get_contents("/proc/self/comm", &comm, NULL, NULL));
+    g_strchomp(comm);
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    link = g_build_filename(dir, comm, NULL);
+    ASSERT_TRUE(symlink(sleep_path, link) == 0);
+
+    ASSERT_TRUE(pipe(go) == 0);
+    ASSERT_TRUE(pipe2(done, O_CLOEXEC) == 0);
+    probe.pid = fork();
+    ASSERT_TRUE(probe.pid >= 0);
+    if (probe.pid == 0) {
+        close(done[0]);
+        if (read(go[0], &c, 1) == 1)
+            execl(link, comm, "100", (char *)NULL);
+        _exit(1);
+    }
+    close(done[1]);
+
+    proc_foreach_cached(exec_probe_callback, &probe);
+    ASSERT_TRUE(probe.path != NULL);
+    ASSERT_TRUE(probe.data == NULL);
+    before = g_strdup(probe.path);
+
+    /* the pipe closes once it exec'ed */
+    ASSERT_TRUE(write(go[1], &c, 1) == 1);
+    ASSERT_TRUE(read(done[0], &c, 1) == 0);
+    name = g_strdup_printf("/proc/%d/comm", probe.pid);
+    ASSERT_TRUE(g_file_get_contents(name, &after, NULL, NULL));
+    ASSERT_TRUE(strcmp(g_strchomp(after), comm) == 0);
+
+    /* the next scan resolves the process again, with an empty slot */
+    proc_foreach_cached(exec_probe_callback, &probe);
+    ASSERT_TRUE(probe.path != NULL);
+    ASSERT_TRUE(strcmp(probe.path, before) != 0);
+    ASSERT_TRUE(probe.data == NULL);
+    ASSERT_TRUE(proc_cache_same_process(probe.pid));
+
+    kill(probe.pid, SIGKILL);
+    waitpid(probe.pid, NULL, 0);
+    close(go[0]);
+    close(go[1]);
+    close(done[0]);
+    unlink(link);
+    rmdir(dir);
+    g_free(link);
+    g_free(name);
+    g_free(after);
+    g_free(comm);
+    g_free(before);
+    g_free(probe.path);
+    proc_cache_flush();
+    return TEST_PASS;
+}
+
+
+static int test_cache_parent(void)
+{
+    foreach_probe_t probe = { 0, 0, NULL };
+    pid_t child, grandchild = 0;
+    char *path;
+    double delay = -1;
+    int fds[2];
+
+    ASSERT_TRUE(pipe(fds) == 0);
+    child = fork();
+    ASSERT_TRUE(child >= 0);
+    if (child == 0) {
+        grandchild = fork();
+        if (grandchild == 0) {
+            pause();
+            _exit(0);
+        }
+        write(fds[1], &grandchild, sizeof(grandchild));
+        pause();
+        _exit(0);
+    }
+    ASSERT_TRUE(read(fds[0], &grandchild, sizeof(grandchild)) == sizeof(grandchild));
+    close(fds[0]);
+    close(fds[1]);
+
+    proc_foreach_cached(probe_callback, &probe);
+
+    /* the child runs the same exe as us, and started right away */
+    path = proc_cache_parent(grandchild, &delay);
+    ASSERT_TRUE(path != NULL);
+    ASSERT_TRUE(delay >= 0 && delay < 5);
+    g_free(path);
+
+    /* we are not scanned, so the child has no parent */
+    ASSERT_TRUE(proc_cache_parent(child, NULL) == NULL);
+
+    kill(grandchild, SIGKILL);
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    proc_cache_flush();
+    return TEST_PASS;
+}
+
+
+int test_proc_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_cputime... ");
+    if (test_cputime() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_resident_ranges... ");
+    if (test_resident_ranges() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_swapin_ranges... ");
+    if (test_swapin_ranges() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_foreach_cached... ");
+    if (test_foreach_cached() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_exec_noticed... ");
+    if (test_exec_noticed() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_cache_parent... ");
+    if (test_cache_parent() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
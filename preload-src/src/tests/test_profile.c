@@ -0,0 +1,244 @@
+/* test_profile.c - Unit tests for workload profiles
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <stdarg.h>
+#include <glib.h>
+
+#include "conf.h"
+#include "state.h"
+#include "state_io.h"
+#include "exe.h"
+#include "profile.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+
+static void test_init_state(void)
+{
+    memset(state, 0, sizeof(*state));
+    state->time = 10000;
+    state->last_running_timestamp = state->time;
+    state->exes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)preload_exe_free);
+    state->bad_exes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->maps = g_hash_table_new((GHashFunc)preload_map_hash, (GEqualFunc)preload_map_equal);
+    state->maps_arr = g_ptr_array_new();
+    conf->model.cycle = 20;
+    conf->model.maxprofiles = 8;
+    conf->model.profilesim = 50;
+}
+
+static void test_cleanup_state(void)
+{
+    preload_profile_free();
+    g_slist_free(state->running_exes);
+    g_hash_table_destroy(state->exes);
+    g_hash_table_destroy(state->bad_exes);
+    g_hash_table_destroy(state->maps);
+    g_ptr_array_free(state->maps_arr, TRUE);
+    memset(state, 0, sizeof(*state));
+}
+
+static preload_exe_t *new_exe(const char *path)
+{
+    preload_exe_t *exe = preload_exe_new(path, FALSE, NULL);
+    preload_state_register_exe(exe, FALSE);
+    return exe;
+}
+
+/* makes exactly the exes given, up to NULL, running */
+static void run(preload_exe_t *first, ...)
+{
+    GHashTableIter iter;
+    gpointer value;
+    preload_exe_t *exe;
+    va_list ap;
+
+    g_hash_table_iter_init(&iter, state->exes);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        ((preload_exe_t *)value)->running_timestamp = -1;
+
+    g_slist_free(state->running_exes);
+    state->running_exes = NULL;
+    va_start(ap, first);
+    for (exe = first; exe; exe = va_arg(ap, preload_exe_t *)) {
+        exe->running_timestamp = state->time;
+        state->running_exes = g_slist_prepend(state->running_exes, exe);
+    }
+    va_end(ap);
+}
+
+static void update(int times)
+{
+    while (times--)
+        preload_profile_update();
+}
+
+
+static int test_detect(void)
+{
+    preload_exe_t *ide, *compiler, *call, *game;
+    preload_profile_t *dev, *calls;
+
+    test_init_state();
+    ide = new_exe("/usr/bin/ide");
+    compiler = new_exe("/usr/bin/cc");
+    call = new_exe("/usr/bin/call");
+    game = new_exe("/usr/bin/game");
+
+    /* nothing running, nothing learned */
+    update(3);
+    ASSERT_TRUE(preload_profile_active() == NULL);
+
+    run(ide, compiler, NULL);
+    update(5);
+    dev = preload_profile_active();
+    ASSERT_TRUE(dev != NULL);
+    ASSERT_EQ(dev->cycles, 5);
+
+    /* a passing change does not switch, one that stays does */
+    run(call, NULL);
+    update(1);
+    ASSERT_TRUE(preload_profile_active() == dev);
+    update(1);
+    calls = preload_profile_active();
+    ASSERT_TRUE(calls != dev);
+    ASSERT_EQ(preload_profiles()->len, 2);
+
+    /* an app joining keeps the profile */
+    run(ide, compiler, call, NULL);
+    update(1);
+    run(ide, compiler, NULL);
+    update(2);
+    ASSERT_TRUE(preload_profile_active() == dev);
+    ASSERT_EQ(preload_profiles()->len, 2);
+
+    /* no room for more: the nearest takes it */
+    conf->model.maxprofiles = 2;
+    run(game, NULL);
+    update(3);
+    ASSERT_EQ(preload_profiles()->len, 2);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_bid(void)
+{
+    preload_exe_t *ide, *compiler, *call;
+    preload_profile_t *dev;
+
+    test_init_state();
+    ide = new_exe("/usr/bin/ide");
+    compiler = new_exe("/usr/bin/cc");
+    call = new_exe("/usr/bin/call");
+
+    run(ide, compiler, NULL);
+    update(10);
+    dev = preload_profile_active();
+
+    /* the one of the profile not running bids, others not */
+    run(compiler, NULL);
+    ide->lnprob = compiler->lnprob = call->lnprob = 0;
+    preload_profile_bid();
+    ASSERT_TRUE(ide->lnprob < -0.5);
+    ASSERT_TRUE(compiler->lnprob == 0);
+    ASSERT_TRUE(call->lnprob == 0);
+
+    /* and it goes away with its exe */
+    preload_state_unregister_exe(ide);
+    ASSERT_EQ(g_hash_table_size(dev->weights), 1);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_persist(void)
+{
+    char tmpfile[] = "/tmp/preload_test_XXXXXX";
+    preload_exe_t *ide, *compiler, *call;
+    preload_profile_t *dev;
+    gfloat *w;
+    int fd = mkstemp(tmpfile);
+
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    test_init_state();
+    ide = new_exe("/usr/bin/ide");
+    compiler = new_exe("/usr/bin/cc");
+    call = new_exe("/usr/bin/call");
+    run(ide, compiler, NULL);
+    update(4);
+    run(ide, NULL);
+    update(1);
+    run(call, NULL);
+    update(2);
+    ASSERT_TRUE(preload_state_write_file(tmpfile) == NULL);
+    test_cleanup_state();
+
+    test_init_state();
+    ASSERT_TRUE(preload_state_read_file(tmpfile) == NULL);
+    ASSERT_EQ(preload_profiles()->len, 2);
+    dev = g_ptr_array_index(preload_profiles(), 0);
+    ASSERT_EQ(dev->cycles, 6);
+    compiler = g_hash_table_lookup(state->exes, "/usr/bin/cc");
+    ASSERT_TRUE(compiler != NULL);
+    w = g_hash_table_lookup(dev->weights, compiler);
+    ASSERT_TRUE(w != NULL && fabs(*w - 4.0 / 6) < 1e-5);
+    ASSERT_TRUE(dev->norm > 0);
+    test_cleanup_state();
+
+    unlink(tmpfile);
+    return TEST_PASS;
+}
+
+
+int test_profile_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_detect... ");
+    if (test_detect() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_bid... ");
+    if (test_bid() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_persist... ");
+    if (test_persist() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
@@ -0,0 +1,173 @@
+/* test_prophet.c - Unit tests for sliced prediction
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "conf.h"
+#include "state.h"
+#include "exe.h"
+#include "map.h"
+#include "prophet.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+/* enough chains for a prediction not to fit one millisecond */
+#define TEST_EXES 400
+
+
+static preload_map_t *shared_map;
+static preload_exe_t *first_exe;
+
+static void test_init_state(void)
+{
+    int i;
+
+    memset(state, 0, sizeof(*state));
+    state->time = 1000;
+    state->last_running_timestamp = 1000;
+    state->exes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)preload_exe_free);
+    state->bad_exes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->maps = g_hash_table_new((GHashFunc)preload_map_hash, (GEqualFunc)preload_map_equal);
+    state->maps_arr = g_ptr_array_new();
+    conf->model.cycle = 20;
+    conf->model.baseline = 0;
+    conf->model.predictslice = 1;
+    conf->system.metabudget = 0;
+
+    /* every exe maps a shared library and a file of its own */
+    shared_map = preload_map_new("/usr/lib/libshared.so", 0, 65536);
+    for (i = 0; i < TEST_EXES; i++) {
+        char *path = g_strdup_printf("/usr/bin/test_%d", i);
+        char *data = g_strdup_printf("/usr/share/test_%d.dat", i);
+        preload_exe_t *exe = preload_exe_new(path, FALSE, NULL);
+
+        preload_exemap_new_from_exe(exe, shared_map);
+        preload_exemap_new_from_exe(exe, preload_map_new(data, 0, 4096));
+        preload_state_register_exe(exe, TRUE);
+        if (i == 0)
+            first_exe = exe;
+        g_free(path);
+        g_free(data);
+    }
+}
+
+static void test_cleanup_state(void)
+{
+    g_slist_free(state->running_exes);
+    g_hash_table_destroy(state->exes);
+    g_hash_table_destroy(state->bad_exes);
+    g_hash_table_destroy(state->maps);
+    g_ptr_array_free(state->maps_arr, TRUE);
+    memset(state, 0, sizeof(*state));
+    conf->model.predictslice = 0;
+}
+
+/* runs one slice of the prediction */
+static void run_slice(void)
+{
+    g_main_context_iteration(NULL, FALSE);
+}
+
+
+static int test_predict_sliced(void)
+{
+    const preload_prophet_stats_t *stats = preload_prophet_stats();
+    preload_prophet_phase_t last = PREDICT_START;
+    guint completed = stats->completed, restarts = stats->restarts;
+    int i;
+
+    test_init_state();
+
+    /* nothing runs before the main loop does */
+    preload_prophet_predict(NULL);
+    ASSERT_EQ(stats->phase, PREDICT_START);
+    ASSERT_EQ(stats->slices, 0);
+
+    /* phases come in order, over several slices */
+    for (i = 0; i < 100000 && stats->phase != PREDICT_IDLE; i++) {
+        run_slice();
+        ASSERT_TRUE(stats->phase == PREDICT_IDLE || stats->phase >= last);
+        last = stats->phase;
+    }
+    ASSERT_EQ(stats->phase, PREDICT_IDLE);
+    ASSERT_EQ(stats->completed, completed + 1);
+    ASSERT_EQ(stats->restarts, restarts);
+    ASSERT_TRUE(stats->slices > 1);
+    ASSERT_TRUE(stats->phase_time[PREDICT_BID_EXES] > 0);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_predict_restart_on_map_free(void)
+{
+    const preload_prophet_stats_t *stats = preload_prophet_stats();
+    guint completed = stats->completed, restarts = stats->restarts;
+    int i;
+
+    test_init_state();
+
+    preload_prophet_predict(NULL);
+    run_slice();
+    ASSERT_TRUE(stats->phase != PREDICT_START && stats->phase != PREDICT_IDLE);
+
+    /* a refresh of its maps drops the file of its own */
+    for (i = 0; i < 100 && first_exe->exemaps->len > 1; i++) {
+        GPtrArray *snapshot = g_ptr_array_new();
+
+        g_ptr_array_add(snapshot, preload_exemap_new(shared_map));
+        preload_exe_update_exemaps(first_exe, snapshot);
+    }
+    ASSERT_EQ(first_exe->exemaps->len, 1);
+
+    /* the prediction held it, so it starts over */
+    for (i = 0; i < 100000 && stats->phase != PREDICT_IDLE; i++)
+        run_slice();
+    ASSERT_EQ(stats->phase, PREDICT_IDLE);
+    ASSERT_EQ(stats->restarts, restarts + 1);
+    ASSERT_EQ(stats->completed, completed + 1);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+int test_prophet_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_predict_sliced... ");
+    if (test_predict_sliced() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_predict_restart_on_map_free... ");
+    if (test_predict_restart_on_map_free() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
@@ -0,0 +1,422 @@
+/* test_readahead.c - Unit tests for the prefetch suppression cache
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+
+#include "readahead.h"
+#include "madvise_utils.h"
+#include "conf.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+
+static int test_residency(void)
+{
+    char *path = g_strdup_printf("/tmp/test_readahead.%d", (int)getpid());
+    char data[16384];
+    int fd;
+
+    memset(data, 'x', sizeof(data));
+    ASSERT_TRUE(g_file_set_contents(path, data, sizeof(data), NULL));
+
+    fd = open(path, O_RDONLY);
+    ASSERT_TRUE(fd >= 0);
+    /* just written, so cached */
+    ASSERT_EQ(preload_file_residency(fd, 0, sizeof(data)), 100);
+    ASSERT_EQ(preload_file_residency(fd, 100, 5000), 100);
+    close(fd);
+
+    ASSERT_EQ(preload_file_residency(-1, 0, 4096), -1);
+
+    unlink(path);
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+static int test_skip_cached(void)
+{
+    char *path = g_strdup_printf("/tmp/test_readahead.%d", (int)getpid());
+    char data[8192];
+    preload_map_t *map;
+    preload_map_t *files[1];
+    gint64 cached;
+
+    memset(data, 'x', sizeof(data));
+    ASSERT_TRUE(g_file_set_contents(path, data, sizeof(data), NULL));
+
+    conf->model.cycle = 20;
+    conf->system.maxprocs = 0;
+    conf->system.prefetchrecheck = 8;
+    map = preload_map_new(path, 0, sizeof(data));
+
+    /* read once, then left alone while fresh */
+    files[0] = map;
+    ASSERT_EQ(preload_readahead(files, 1), 1);
+    ASSERT_TRUE(map->cached > 0);
+    ASSERT_EQ(preload_readahead(files, 1), 0);
+
+    /* expired but still cached: looked up, not read */
+    map->cached -= (gint64)24 * 3600 * G_USEC_PER_SEC;
+    cached = map->cached;
+    ASSERT_EQ(preload_readahead(files, 1), 0);
+    ASSERT_TRUE(map->cached > cached);
+
+    /* a replaced file has nothing cached, whatever the stamp says */
+    {
+        char *other = g_strconcat(path, ".new", NULL);
+
+        ASSERT_TRUE(g_file_set_contents(other, data, sizeof(data), NULL));
+        ASSERT_TRUE(rename(other, path) == 0);
+        g_free(other);
+    }
+    ASSERT_EQ(preload_readahead(files, 1), 1);
+    ASSERT_EQ(preload_readahead(files, 1), 0);
+
+    /* off: read every time */
+    conf->system.prefetchrecheck = 0;
+    ASSERT_EQ(preload_readahead(files, 1), 1);
+    ASSERT_EQ(preload_readahead(files, 1), 1);
+
+    preload_map_free(map);
+    unlink(path);
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+static int test_uncached(void)
+{
+    char *path = g_strdup_printf("/tmp/test_readahead.%d", (int)getpid());
+    char *evicted_path = g_strconcat(path, ".evicted", NULL);
+    char data[8192];
+    preload_map_t *cached, *gone, *evicted;
+    preload_map_t *maps[3];
+    int fd, resident;
+
+    memset(data, 'x', sizeof(data));
+    ASSERT_TRUE(g_file_set_contents(path, data, sizeof(data), NULL));
+    ASSERT_TRUE(g_file_set_contents(evicted_path, data, sizeof(data), NULL));
+
+    /* written back and dropped, where the filesystem lets it go */
+    fd = open(evicted_path, O_RDONLY);
+    ASSERT_TRUE(fd >= 0);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    resident = preload_file_residency(fd, 0, sizeof(data));
+    close(fd);
+
+    conf->model.cycle = 20;
+    cached = preload_map_new(path, 0, sizeof(data));
+    gone = preload_map_new("/nonexistent/lib.so", 0, sizeof(data));
+    gone->cached = 1;
+    evicted = preload_map_new(evicted_path, 0, sizeof(data));
+
+    /* cannot be looked up, so neither read nor stamped */
+    maps[0] = cached;
+    maps[1] = gone;
+    maps[2] = evicted;
+    if (resident == 0) {
+        ASSERT_EQ(preload_readahead_uncached(maps, 3), 1);
+        ASSERT_TRUE(maps[0] == evicted);
+        ASSERT_EQ(evicted->cached, 0);
+    } else {
+        ASSERT_EQ(preload_readahead_uncached(maps, 2), 0);
+    }
+    ASSERT_EQ(gone->cached, 1);
+    ASSERT_TRUE(cached->cached > 0);
+
+    preload_map_free(evicted);
+    preload_map_free(gone);
+    preload_map_free(cached);
+    unlink(evicted_path);
+    unlink(path);
+    g_free(evicted_path);
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+static int test_memory_fs(void)
+{
+    char *path = g_strdup_printf("/dev/shm/test_readahead.%d", (int)getpid());
+    char data[8192];
+    struct statfs fs;
+    preload_map_t *map;
+    preload_map_t *files[1];
+
+    /* only where /dev/shm is the usual tmpfs */
+    if (statfs("/dev/shm", &fs) != 0 || fs.f_type != TMPFS_MAGIC) {
+        g_free(path);
+        return TEST_PASS;
+    }
+
+    memset(data, 'x', sizeof(data));
+    ASSERT_TRUE(g_file_set_contents(path, data, sizeof(data), NULL));
+
+    conf->model.cycle = 20;
+    conf->system.maxprocs = 0;
+    conf->system.prefetchrecheck = 0;
+    map = preload_map_new(path, 0, sizeof(data));
+
+    /* in memory already: never read */
+    files[0] = map;
+    ASSERT_EQ(preload_readahead(files, 1), 0);
+    ASSERT_EQ(map->cached, 0);
+
+    preload_map_free(map);
+    unlink(path);
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+static int test_fs_budget(void)
+{
+    char *path = g_strdup_printf("/tmp/test_readahead.%d", (int)getpid());
+    char data[8192];
+    preload_map_t *map;
+    preload_map_t *files[1];
+
+    memset(data, 'x', sizeof(data));
+    ASSERT_TRUE(g_file_set_contents(path, data, sizeof(data), NULL));
+
+    conf->model.cycle = 20;
+    conf->system.maxprocs = 0;
+    conf->system.prefetchrecheck = 0;
+    map = preload_map_new(path, 0, sizeof(data));
+    files[0] = map;
+
+    /* budgets of other filesystems do not hold back local ones */
+    conf->system.compressedbudget = 0;
+    conf->system.remotebudget = 0;
+    ASSERT_EQ(preload_readahead(files, 1), 1);
+
+    preload_map_free(map);
+    unlink(path);
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+static int test_metadata(void)
+{
+    char *path = g_strdup_printf("/tmp/test_readahead.%d", (int)getpid());
+    char *shm = g_strdup_printf("/dev/shm/test_readahead.%d", (int)getpid());
+    struct statfs fs;
+    GPtrArray *paths;
+
+    ASSERT_TRUE(g_file_set_contents(path, "x", 1, NULL));
+
+    conf->system.maxprocs = 0;
+    conf->system.metabudget = 100;
+    paths = g_ptr_array_new();
+    g_ptr_array_add(paths, path);
+    g_ptr_array_add(paths, path);
+    g_ptr_array_add(paths, shm);
+
+    /* the file and its directory, once; memory filesystems left out */
+    if (statfs("/dev/shm", &fs) == 0 && fs.f_type == TMPFS_MAGIC)
+        ASSERT_EQ(preload_readahead_metadata(paths), 2);
+
+    /* the budget counts files and directories alike */
+    conf->system.metabudget = 1;
+    ASSERT_EQ(preload_readahead_metadata(paths), 1);
+
+    g_ptr_array_free(paths, TRUE);
+    unlink(path);
+    g_free(path);
+    g_free(shm);
+    return TEST_PASS;
+}
+
+
+static int test_quarantine(void)
+{
+    gint64 second = G_USEC_PER_SEC;
+    gint64 now = 10000 * second;
+
+    /* timeouts spread over more than the period */
+    preload_readahead_timed_out("/test/spread", now);
+    preload_readahead_timed_out("/test/spread", now + 300 * second);
+    preload_readahead_timed_out("/test/spread", now + 700 * second);
+    ASSERT_TRUE(!preload_readahead_quarantined("/test/spread", now + 700 * second));
+    preload_readahead_timed_out("/test/spread", now + 1400 * second);
+    ASSERT_TRUE(!preload_readahead_quarantined("/test/spread", now + 1400 * second));
+
+    /* three within it */
+    preload_readahead_timed_out("/test/hung", now);
+    preload_readahead_timed_out("/test/hung", now + 100 * second);
+    ASSERT_TRUE(!preload_readahead_quarantined("/test/hung", now + 100 * second));
+    preload_readahead_timed_out("/test/hung", now + 500 * second);
+    ASSERT_TRUE(preload_readahead_quarantined("/test/hung", now + 500 * second));
+    ASSERT_TRUE(!preload_readahead_quarantined("/test/other", now + 500 * second));
+
+    /* a further timeout does not extend it */
+    preload_readahead_timed_out("/test/hung", now + 800 * second);
+    ASSERT_TRUE(preload_readahead_quarantined("/test/hung", now + 1099 * second));
+
+    /* it expires a period later, with the count cleared */
+    ASSERT_TRUE(!preload_readahead_quarantined("/test/hung", now + 1100 * second));
+    preload_readahead_timed_out("/test/hung", now + 1101 * second);
+    preload_readahead_timed_out("/test/hung", now + 1102 * second);
+    ASSERT_TRUE(!preload_readahead_quarantined("/test/hung", now + 1102 * second));
+    preload_readahead_timed_out("/test/hung", now + 1103 * second);
+    ASSERT_TRUE(preload_readahead_quarantined("/test/hung", now + 1103 * second));
+
+    return TEST_PASS;
+}
+
+
+/* runs the main loop until readers are reaped, or a second passed */
+static void wait_reaped(void)
+{
+    int i;
+
+    for (i = 0; i < 100 && preload_readahead_inflight(); i++) {
+        while (g_main_context_iteration(NULL, FALSE))
+            ;
+        g_usleep(10000);
+    }
+}
+
+static int test_cancel(void)
+{
+    char *path = g_strdup_printf("/tmp/test_readahead.%d", (int)getpid());
+    char *other_path = g_strconcat(path, ".other", NULL);
+    char data[8192];
+    preload_map_t *map, *other;
+    preload_map_t *files[2];
+
+    memset(data, 'x', sizeof(data));
+    ASSERT_TRUE(g_file_set_contents(path, data, sizeof(data), NULL));
+    ASSERT_TRUE(g_file_set_contents(other_path, data, sizeof(data), NULL));
+
+    /* one reader, and it is not reaped meanwhile: the rest stays queued */
+    conf->model.cycle = 20;
+    conf->system.maxprocs = 1;
+    conf->system.prefetchrecheck = 0;
+    conf->system.prefetchtimeout = 10;
+    map = preload_map_new(path, 0, sizeof(data));
+    other = preload_map_new(other_path, 0, sizeof(data));
+    files[0] = map;
+    files[1] = other;
+    wait_reaped();
+    ASSERT_EQ(preload_readahead_inflight(), 0);
+
+    ASSERT_EQ(preload_readahead(files, 2), 2);
+    ASSERT_EQ(preload_readahead_inflight(), 2);
+
+    /* a new round replaces what is queued */
+    ASSERT_EQ(preload_readahead(files, 1), 1);
+    ASSERT_EQ(preload_readahead_inflight(), 2);
+
+    /* urgent requests go ahead of it instead */
+    files[0] = other;
+    ASSERT_EQ(preload_readahead_now(files, 1), 1);
+    ASSERT_EQ(preload_readahead_inflight(), 3);
+
+    /* cancel drops the queue and kills the reader, which is reaped as
+     * usual without starting anything */
+    preload_readahead_cancel("test");
+    ASSERT_EQ(preload_readahead_inflight(), 1);
+    wait_reaped();
+    ASSERT_EQ(preload_readahead_inflight(), 0);
+    ASSERT_EQ(map->cached, 0);
+    ASSERT_EQ(other->cached, 0);
+
+    conf->system.maxprocs = 0;
+    preload_map_free(other);
+    preload_map_free(map);
+    unlink(other_path);
+    unlink(path);
+    g_free(other_path);
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+int test_readahead_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_residency... ");
+    if (test_residency() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_skip_cached... ");
+    if (test_skip_cached() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_uncached... ");
+    if (test_uncached() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_memory_fs... ");
+    if (test_memory_fs() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_fs_budget... ");
+    if (test_fs_budget() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_metadata... ");
+    if (test_metadata() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_quarantine... ");
+    if (test_quarantine() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_cancel... ");
+    if (test_cancel() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
@@ -0,0 +1,165 @@
+/* test_spawn.c - Unit tests for the parent to child spawn model
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "state.h"
+#include "state_io.h"
+#include "exe.h"
+#include "spawn.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+
+static void test_init_state(void)
+{
+    memset(state, 0, sizeof(*state));
+    state->time = 100;
+    state->exes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)preload_exe_free);
+    state->bad_exes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->maps = g_hash_table_new((GHashFunc)preload_map_hash, (GEqualFunc)preload_map_equal);
+    state->maps_arr = g_ptr_array_new();
+}
+
+static void test_cleanup_state(void)
+{
+    g_hash_table_destroy(state->exes);
+    g_hash_table_destroy(state->bad_exes);
+    g_hash_table_destroy(state->maps);
+    g_ptr_array_free(state->maps_arr, TRUE);
+    memset(state, 0, sizeof(*state));
+}
+
+static preload_exe_t *new_exe(const char *path)
+{
+    preload_exe_t *exe = preload_exe_new(path, FALSE, NULL);
+    preload_state_register_exe(exe, FALSE);
+    return exe;
+}
+
+
+static int test_observe(void)
+{
+    preload_exe_t *sh, *make, *cc;
+    preload_spawn_t *spawn;
+    int i;
+
+    test_init_state();
+    sh = new_exe("/bin/sh");
+    make = new_exe("/usr/bin/make");
+    cc = new_exe("/usr/bin/cc");
+
+    /* make starts cc in every run, about 2s in */
+    preload_spawn_observe(make, cc, 2.0);
+    ASSERT_EQ(make->spawns->len, 1);
+    spawn = g_ptr_array_index(make->spawns, 0);
+    ASSERT_TRUE(spawn->child == cc);
+    for (i = 0; i < 3; i++) {
+        preload_spawn_parent_started(make);
+        preload_spawn_observe(make, cc, 4.0);
+    }
+    ASSERT_EQ(make->spawns->len, 1);
+    ASSERT_EQ(spawn->starts, 4);
+    ASSERT_EQ(spawn->count, 4);
+    ASSERT_TRUE(preload_spawn_prob(spawn) == 1.0);
+    ASSERT_TRUE(spawn->delay > 3.0 && spawn->delay < 4.0);
+
+    /* and then not */
+    for (i = 0; i < 4; i++)
+        preload_spawn_parent_started(make);
+    ASSERT_TRUE(preload_spawn_prob(spawn) == 0.5);
+
+    /* old runs weigh less and less */
+    for (i = 0; i < 100; i++)
+        preload_spawn_parent_started(make);
+    ASSERT_TRUE(spawn->starts <= 64);
+    ASSERT_TRUE(preload_spawn_prob(spawn) < 0.1);
+
+    /* a shell starting itself says nothing */
+    preload_spawn_observe(sh, sh, 0);
+    ASSERT_EQ(sh->spawns->len, 0);
+
+    /* children going away take their spawns along */
+    preload_spawn_observe(sh, make, 1.0);
+    preload_state_unregister_exe(cc);
+    ASSERT_EQ(make->spawns->len, 0);
+    ASSERT_EQ(sh->spawns->len, 1);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_persist(void)
+{
+    char tmpfile[] = "/tmp/preload_test_XXXXXX";
+    preload_exe_t *make;
+    preload_spawn_t *spawn;
+    int fd = mkstemp(tmpfile);
+
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    test_init_state();
+    make = new_exe("/usr/bin/make");
+    preload_spawn_observe(make, new_exe("/usr/bin/cc"), 1.5);
+    preload_spawn_parent_started(make);
+    ASSERT_TRUE(preload_state_write_file(tmpfile) == NULL);
+    test_cleanup_state();
+
+    test_init_state();
+    ASSERT_TRUE(preload_state_read_file(tmpfile) == NULL);
+    make = g_hash_table_lookup(state->exes, "/usr/bin/make");
+    ASSERT_TRUE(make != NULL);
+    ASSERT_EQ(make->spawns->len, 1);
+    spawn = g_ptr_array_index(make->spawns, 0);
+    ASSERT_TRUE(spawn->child == g_hash_table_lookup(state->exes, "/usr/bin/cc"));
+    ASSERT_EQ(spawn->starts, 2);
+    ASSERT_EQ(spawn->count, 1);
+    ASSERT_TRUE(spawn->delay == 1.5);
+    test_cleanup_state();
+
+    unlink(tmpfile);
+    return TEST_PASS;
+}
+
+
+int test_spawn_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_observe... ");
+    if (test_observe() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_persist... ");
+    if (test_persist() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
@@ -0,0 +1,345 @@
+/* test_spy.c - Unit tests for process tracking
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <glib.h>
+
+#include "conf.h"
+#include "state.h"
+#include "exe.h"
+#include "markov.h"
+#include "proc.h"
+#include "spy.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+
+static void test_init_state(void)
+{
+    memset(state, 0, sizeof(*state));
+    state->time = 100;
+    state->last_running_timestamp = 90;
+    state->last_accounting_timestamp = 100;
+    state->exes = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)preload_exe_free);
+    state->bad_exes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->maps = g_hash_table_new((GHashFunc)preload_map_hash, (GEqualFunc)preload_map_equal);
+    state->maps_arr = g_ptr_array_new();
+    conf->model.cycle = 20;
+    conf->model.maxprofiles = 0;
+    conf->model.maprefresh = 0;
+    /* the other processes around become bad exes, not model */
+    conf->model.minsize = G_MAXINT;
+}
+
+static void test_cleanup_state(void)
+{
+    proc_cache_flush();
+    g_slist_free(state->running_exes);
+    g_hash_table_destroy(state->exes);
+    g_hash_table_destroy(state->bad_exes);
+    g_hash_table_destroy(state->maps);
+    g_ptr_array_free(state->maps_arr, TRUE);
+    memset(state, 0, sizeof(*state));
+}
+
+static pid_t start_child(void)
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        pause();
+        _exit(0);
+    }
+    return pid;
+}
+
+static void stop_child(pid_t pid)
+{
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+typedef struct {
+    pid_t pid;
+    char *path;
+} path_probe_t;
+
+static void path_callback(pid_t pid, const char *path, gpointer *data, gpointer user_data)
+{
+    path_probe_t *probe = (path_probe_t *)user_data;
+
+    if (pid == probe->pid && !probe->path)
+        probe->path = g_strdup(path);
+}
+
+/* registers the exe the children run, chained to another one */
+static preload_exe_t *child_exe(pid_t pid, preload_markov_t **markov)
+{
+    path_probe_t probe = { pid, NULL };
+    preload_exe_t *other, *exe;
+
+    proc_foreach_cached(path_callback, &probe);
+    if (!probe.path)
+        return NULL;
+
+    other = preload_exe_new("/usr/bin/test_other", FALSE, NULL);
+    preload_state_register_exe(other, TRUE);
+    exe = preload_exe_new(probe.path, FALSE, NULL);
+    preload_state_register_exe(exe, TRUE);
+    g_free(probe.path);
+
+    *markov = g_ptr_array_index(exe->markovs, 0);
+    return exe;
+}
+
+/* one scan and model update, a cycle after the last */
+static void cycle(void)
+{
+    state->time += conf->model.cycle;
+    preload_spy_scan(NULL);
+    state->model_dirty = TRUE;
+    preload_spy_update_model(NULL);
+}
+
+/* runs the main loop until exe stops running, or a second passed */
+static void wait_stopped(preload_exe_t *exe)
+{
+    int i;
+
+    for (i = 0; i < 100 && exe_is_running(exe); i++) {
+        while (g_main_context_iteration(NULL, FALSE))
+            ;
+        g_usleep(10000);
+    }
+}
+
+
+static int test_exit_watch(void)
+{
+    preload_markov_t *markov;
+    preload_exe_t *exe;
+    pid_t pid;
+
+    test_init_state();
+    pid = start_child();
+    ASSERT_TRUE(pid > 0);
+    exe = child_exe(pid, &markov);
+    ASSERT_TRUE(exe != NULL);
+
+    cycle();
+    ASSERT_TRUE(exe_is_running(exe));
+    ASSERT_TRUE(g_slist_find(state->running_exes, exe) != NULL);
+    ASSERT_EQ(markov->state, markov->a == exe ? 1 : 2);
+    ASSERT_EQ(markov->change_timestamp, 120);
+    if (!exe->exit_watch) {
+        /* no pidfd support here, the fallback is tested below */
+        stop_child(pid);
+        test_cleanup_state();
+        return TEST_PASS;
+    }
+
+    /* it exits halfway to the next scan, and is stopped right then */
+    state->time += conf->model.cycle / 2;
+    stop_child(pid);
+    wait_stopped(exe);
+    ASSERT_TRUE(!exe_is_running(exe));
+    ASSERT_TRUE(g_slist_find(state->running_exes, exe) == NULL);
+    ASSERT_EQ(exe->exit_watch, 0);
+    ASSERT_EQ(exe->pidfd, -1);
+    ASSERT_EQ(markov->state, 0);
+    ASSERT_EQ(markov->change_timestamp, 130);
+    ASSERT_EQ(exe->change_timestamp, 130);
+
+    /* and the next scan does not change that */
+    cycle();
+    ASSERT_TRUE(!exe_is_running(exe));
+    ASSERT_EQ(markov->state, 0);
+    ASSERT_EQ(markov->change_timestamp, 130);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_exit_watch_hand_over(void)
+{
+    preload_markov_t *markov;
+    preload_exe_t *exe;
+    pid_t first, second, watched, other;
+
+    test_init_state();
+    first = start_child();
+    second = start_child();
+    ASSERT_TRUE(first > 0 && second > 0);
+    exe = child_exe(first, &markov);
+    ASSERT_TRUE(exe != NULL);
+
+    cycle();
+    ASSERT_TRUE(exe_is_running(exe));
+    if (!exe->exit_watch) {
+        stop_child(first);
+        stop_child(second);
+        test_cleanup_state();
+        return TEST_PASS;
+    }
+
+    /* the watched process exits, the other one takes over */
+    watched = exe->pid;
+    other = watched == first ? second : first;
+    stop_child(watched);
+    for (int i = 0; i < 100 && exe->pid != other; i++) {
+        while (g_main_context_iteration(NULL, FALSE))
+            ;
+        g_usleep(10000);
+    }
+    ASSERT_EQ(exe->pid, other);
+    ASSERT_TRUE(exe->exit_watch != 0);
+    ASSERT_TRUE(exe_is_running(exe));
+    ASSERT_TRUE(g_slist_find(state->running_exes, exe) != NULL);
+
+    /* then the last one */
+    stop_child(other);
+    wait_stopped(exe);
+    ASSERT_TRUE(!exe_is_running(exe));
+    ASSERT_TRUE(g_slist_find(state->running_exes, exe) == NULL);
+    ASSERT_EQ(markov->state, 0);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_exit_without_watch(void)
+{
+    preload_markov_t *markov;
+    preload_exe_t *exe;
+    pid_t pid;
+
+    test_init_state();
+    pid = start_child();
+    ASSERT_TRUE(pid > 0);
+    exe = child_exe(pid, &markov);
+    ASSERT_TRUE(exe != NULL);
+
+    /* gone before it could be watched, as without pidfd support */
+    state->time += conf->model.cycle;
+    preload_spy_scan(NULL);
+    stop_child(pid);
+    state->model_dirty = TRUE;
+    preload_spy_update_model(NULL);
+    ASSERT_EQ(exe->exit_watch, 0);
+    ASSERT_TRUE(exe_is_running(exe));
+
+    /* the next scan stops it, at its time */
+    cycle();
+    ASSERT_TRUE(!exe_is_running(exe));
+    ASSERT_TRUE(g_slist_find(state->running_exes, exe) == NULL);
+    ASSERT_EQ(markov->state, 0);
+    ASSERT_EQ(markov->change_timestamp, 140);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+static int test_exit_before_stale_scan(void)
+{
+    preload_markov_t *markov;
+    preload_exe_t *exe;
+    proc_scan_t *scan;
+    pid_t pid;
+    int weight;
+
+    test_init_state();
+    pid = start_child();
+    ASSERT_TRUE(pid > 0);
+    exe = child_exe(pid, &markov);
+    ASSERT_TRUE(exe != NULL);
+
+    cycle();
+    if (!exe->exit_watch) {
+        stop_child(pid);
+        test_cleanup_state();
+        return TEST_PASS;
+    }
+    weight = markov->weight[0][markov->state];
+
+    /* the scan is taken, the process exits and is stopped, then the
+     * scan gets applied, as with the scan on a worker thread */
+    state->time += conf->model.cycle;
+    scan = proc_scan_take();
+    stop_child(pid);
+    wait_stopped(exe);
+    ASSERT_TRUE(!exe_is_running(exe));
+
+    preload_spy_scan_apply(scan, NULL);
+    proc_scan_free(scan);
+    state->model_dirty = TRUE;
+    preload_spy_update_model(NULL);
+
+    /* no start from the stale record */
+    ASSERT_TRUE(!exe_is_running(exe));
+    ASSERT_TRUE(g_slist_find(state->running_exes, exe) == NULL);
+    ASSERT_EQ(exe->exit_watch, 0);
+    ASSERT_EQ(markov->state, 0);
+    ASSERT_EQ(markov->weight[0][markov->a == exe ? 1 : 2], weight);
+
+    test_cleanup_state();
+    return TEST_PASS;
+}
+
+
+int test_spy_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_exit_watch... ");
+    if (test_exit_watch() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_exit_watch_hand_over... ");
+    if (test_exit_watch_hand_over() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_exit_without_watch... ");
+    if (test_exit_without_watch() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_exit_before_stale_scan... ");
+    if (test_exit_before_stale_scan() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
@@ -15,6 +15,7 @@
 #include "state_io.h"
 #include "map.h"
 #include "exe.h"
+#include "markov.h"
 
 /* Test macros */
 #define TEST_PASS 0
@@ -119,6 +120,7 @@ static int test_state_io_roundtrip(void)
     preload_exe_t *exe = preload_exe_new("/usr/bin/bash", FALSE, exemaps);
     exe->time = 100;
     exe->update_time = 50;
+    exe->seen_timestamp = 400;
     preload_state_register_exe(exe, FALSE);
     
     int original_time = state->time;
@@ -147,6 +149,7 @@ static int test_state_io_roundtrip(void)
     preload_exe_t *restored_exe = g_hash_table_lookup(state->exes, "/usr/bin/bash");
     ASSERT_NOT_NULL(restored_exe);
     ASSERT_EQ(restored_exe->time, 100);
+    ASSERT_EQ(restored_exe->seen_timestamp, 400);
     
     /* Cleanup */
     unlink(tmpfile);
@@ -206,6 +209,86 @@ static int test_state_io_format_compatibility(void)
 }
 
 
+static preload_markov_t *read_back_markov(const char *tmpfile)
+{
+    preload_exe_t *exe;
+
+    if (preload_state_read_file(tmpfile))
+        return NULL;
+    exe = g_hash_table_lookup(state->exes, "/usr/bin/firefox");
+    if (!exe || exe->markovs->len != 1)
+        return NULL;
+    return g_ptr_array_index(exe->markovs, 0);
+}
+
+static int test_state_io_markov_dwell(void)
+{
+    char tmpfile[] = "/tmp/preload_test_XXXXXX";
+    int fd = mkstemp(tmpfile);
+    preload_markov_t *markov;
+    gchar *contents = NULL;
+    gchar **lines;
+    GString *old;
+    int i;
+
+    ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    test_init_state();
+    preload_exe_t *exe1 = preload_exe_new("/usr/bin/firefox", FALSE, NULL);
+    preload_exe_t *exe2 = preload_exe_new("/usr/bin/vim", FALSE, NULL);
+    preload_state_register_exe(exe1, FALSE);
+    preload_state_register_exe(exe2, FALSE);
+    markov = preload_markov_new(exe1, exe2, FALSE);
+    markov->weight[1][1] = 3;
+    markov->dwell[1][2] = 7;
+    markov->dwell[3][MARKOV_DWELL_BUCKETS - 1] = 255;
+    ASSERT_NULL(preload_state_write_file(tmpfile));
+    test_cleanup_state();
+
+    test_init_state();
+    markov = read_back_markov(tmpfile);
+    ASSERT_TRUE(markov != NULL);
+    ASSERT_EQ(markov->weight[1][1], 3);
+    ASSERT_EQ(markov->dwell[1][2], 7);
+    ASSERT_EQ(markov->dwell[3][MARKOV_DWELL_BUCKETS - 1], 255);
+    test_cleanup_state();
+
+    /* chains saved before dwell times were kept load without them */
+    ASSERT_TRUE(g_file_get_contents(tmpfile, &contents, NULL, NULL));
+    lines = g_strsplit(contents, "\n", -1);
+    old = g_string_new(NULL);
+    for (i = 0; lines[i]; i++) {
+        if (g_str_has_prefix(lines[i], "MARKOV\t")) {
+            gchar **fields = g_strsplit(lines[i], "\t", -1);
+            /* tag, a, b, time, 4 times to leave, 16 weights */
+            gchar *rest = fields[24];
+            fields[24] = NULL;
+            g_free(lines[i]);
+            lines[i] = g_strjoinv("\t", fields);
+            fields[24] = rest;
+            g_strfreev(fields);
+        }
+        if (*lines[i])
+            g_string_append_printf(old, "%s\n", lines[i]);
+    }
+    ASSERT_TRUE(g_file_set_contents(tmpfile, old->str, -1, NULL));
+    g_string_free(old, TRUE);
+    g_strfreev(lines);
+    g_free(contents);
+
+    test_init_state();
+    markov = read_back_markov(tmpfile);
+    ASSERT_TRUE(markov != NULL);
+    ASSERT_EQ(markov->weight[1][1], 3);
+    ASSERT_EQ(markov->dwell[1][2], 0);
+    test_cleanup_state();
+
+    unlink(tmpfile);
+    return TEST_PASS;
+}
+
+
 static int test_state_io_read_nonexistent(void)
 {
     test_init_state();
@@ -362,6 +445,13 @@ int test_state_io_run(void)
         failed++;
     }
     
+    fprintf(stderr, "  Running test_state_io_markov_dwell... ");
+    if (test_state_io_markov_dwell() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+    
     fprintf(stderr, "  Running test_state_io_empty_path... ");
     if (test_state_io_empty_path() == TEST_PASS) {
         fprintf(stderr, "PASS\n");
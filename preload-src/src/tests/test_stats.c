@@ -0,0 +1,102 @@
+/* test_stats.c - Unit tests for the shared-memory statistics segment
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <glib.h>
+
+#include "stats.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(expr) ASSERT_TRUE(!(expr))
+
+
+static int test_publish_read(void)
+{
+    char *path = g_strdup_printf("/tmp/test_stats.%d", (int)getpid());
+    preload_stats_segment_t *seg, copy;
+    uint32_t seq;
+    int fd;
+
+    ASSERT_TRUE(preload_stats_open(path));
+
+    /* a monitor maps it on its own */
+    fd = open(path, O_RDWR);
+    ASSERT_TRUE(fd >= 0);
+    seg = mmap(NULL, sizeof(*seg), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_TRUE(seg != MAP_FAILED);
+
+    ASSERT_TRUE(preload_stats_read(seg, &copy));
+    ASSERT_TRUE(copy.magic == PRELOAD_STATS_MAGIC);
+    ASSERT_TRUE(copy.version == PRELOAD_STATS_VERSION);
+    ASSERT_TRUE(copy.size == sizeof(preload_stats_segment_t));
+    ASSERT_TRUE(copy.pid == getpid());
+    ASSERT_TRUE(copy.updated > 0);
+    ASSERT_TRUE(copy.engine[0] != '\0');
+    ASSERT_TRUE((copy.seq & 1) == 0);
+
+    /* every update moves seq on by two */
+    seq = copy.seq;
+    preload_stats_publish();
+    ASSERT_TRUE(preload_stats_read(seg, &copy));
+    ASSERT_TRUE(copy.seq == seq + 2);
+
+    /* a write in progress is never read */
+    seg->seq++;
+    ASSERT_FALSE(preload_stats_read(seg, &copy));
+    seg->seq++;
+    ASSERT_TRUE(preload_stats_read(seg, &copy));
+
+    /* nor a segment of another layout */
+    seg->version++;
+    ASSERT_FALSE(preload_stats_read(seg, &copy));
+    seg->version--;
+
+    munmap(seg, sizeof(*seg));
+
+    /* the file goes away with the daemon */
+    preload_stats_close();
+    ASSERT_TRUE(access(path, F_OK) != 0);
+
+    /* no file, nothing published */
+    ASSERT_TRUE(preload_stats_open(""));
+    preload_stats_publish();
+    preload_stats_close();
+
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+int test_stats_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_publish_read... ");
+    if (test_publish_read() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
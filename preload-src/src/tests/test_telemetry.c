@@ -0,0 +1,165 @@
+/* test_telemetry.c - Unit tests for the telemetry sampler
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+
+#include "telemetry.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(expr) ASSERT_TRUE(!(expr))
+
+
+static int test_parse_meminfo(void)
+{
+    preload_telemetry_t snap;
+    const char *meminfo =
+        "MemTotal:       16318616 kB\n"
+        "MemFree:         1048576 kB\n"
+        "MemAvailable:    8388608 kB\n"
+        "Buffers:          262144 kB\n"
+        "Cached:          4194304 kB\n"
+        "SwapCached:        65536 kB\n"
+        "Active:          6291456 kB\n"
+        "Active(anon):    2097152 kB\n"
+        "Active(file):    4194304 kB\n"
+        "SwapTotal:       8388608 kB\n"
+        "SwapFree:        8000000 kB";
+
+    memset(&snap, 0, sizeof(snap));
+    preload_telemetry_parse(&snap, TELEMETRY_MEMINFO, meminfo);
+
+    ASSERT_TRUE(snap.mem.total == 16318616);
+    ASSERT_TRUE(snap.mem.free == 1048576);
+    ASSERT_TRUE(snap.mem.available == 8388608);
+    ASSERT_TRUE(snap.mem.buffers == 262144);
+    /* SwapCached: must not be taken for Cached: */
+    ASSERT_TRUE(snap.mem.cached == 4194304);
+    ASSERT_TRUE(snap.mem.active == 6291456);
+    ASSERT_TRUE(snap.mem.active_anon == 2097152);
+    ASSERT_TRUE(snap.mem.active_file == 4194304);
+    /* last line without newline */
+    ASSERT_TRUE(snap.swapfree == 8000000);
+
+    return TEST_PASS;
+}
+
+
+static int test_parse_vmstat_psi(void)
+{
+    preload_telemetry_t snap;
+
+    memset(&snap, 0, sizeof(snap));
+    preload_telemetry_parse(&snap, TELEMETRY_VMSTAT,
+        "pgpgin 123456\npgpgout 654321\npswpin 7\npswpout 8\n"
+        "pgmajfault 9999999999\npgmajfault_s 1\n");
+    ASSERT_TRUE(snap.mem.pagein == 123456);
+    ASSERT_TRUE(snap.mem.pageout == 654321);
+    ASSERT_TRUE(snap.pswpin == 7 && snap.pswpout == 8);
+    ASSERT_TRUE(snap.pgmajfault == 9999999999ULL);
+
+    snap.memory_some = snap.memory_full = -1;
+    preload_telemetry_parse(&snap, TELEMETRY_PSI_MEMORY,
+        "some avg10=12.50 avg60=3.00 avg300=1.00 total=123\n"
+        "full avg10=2.25 avg60=0.00 avg300=0.00 total=45\n");
+    ASSERT_TRUE(snap.memory_some == 12.5);
+    ASSERT_TRUE(snap.memory_full == 2.25);
+
+    return TEST_PASS;
+}
+
+
+static int test_parse_diskstats(void)
+{
+    preload_telemetry_t snap;
+
+    memset(&snap, 0, sizeof(snap));
+    preload_telemetry_parse(&snap, TELEMETRY_DISKSTATS,
+        "   7       0 loop0 100 0 2000 10 0 0 0 0 0 10 10 0 0 0 0\n"
+        "   8       0 sda 1000 10 20000 500 300 20 6000 400 0 900 900 0 0 0 0\n"
+        "   8       1 sda1 900 10 18000 450 300 20 6000 400 0 850 850 0 0 0 0\n"
+        " 259       0 nvme0n1 500 0 4000 100 100 0 2000 50 0 200 150 0 0 0 0\n"
+        " 259       1 nvme0n1p1 500 0 4000 100 100 0 2000 50 0 200 150 0 0 0 0\n"
+        " 253       0 dm-0 1400 0 22000 600 400 0 8000 450 0 1100 1050 0 0 0 0\n");
+
+    /* sda and nvme0n1 only, in kilobytes */
+    ASSERT_TRUE(snap.disk_read == (20000 + 4000) / 2);
+    ASSERT_TRUE(snap.disk_written == (6000 + 2000) / 2);
+    ASSERT_TRUE(snap.disk_busy == 900 + 200);
+
+    return TEST_PASS;
+}
+
+
+static int test_sample(void)
+{
+    const preload_telemetry_t *snap;
+
+    preload_telemetry_sample();
+    snap = preload_telemetry();
+    ASSERT_TRUE(snap->mem.total > 0);
+    ASSERT_TRUE(snap->mem.available > 0);
+    ASSERT_TRUE(snap->sampled > 0);
+
+    /* the second one has rates */
+    preload_telemetry_sample();
+    ASSERT_TRUE(preload_telemetry()->disk_read_rate >= 0);
+    ASSERT_TRUE(preload_telemetry()->disk_util >= 0);
+
+    preload_telemetry_free();
+    ASSERT_TRUE(preload_telemetry()->sampled == 0);
+
+    return TEST_PASS;
+}
+
+
+int test_telemetry_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_parse_meminfo... ");
+    if (test_parse_meminfo() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_parse_vmstat_psi... ");
+    if (test_parse_vmstat_psi() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_parse_diskstats... ");
+    if (test_parse_diskstats() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_sample... ");
+    if (test_sample() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
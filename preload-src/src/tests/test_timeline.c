@@ -0,0 +1,131 @@
+/* test_timeline.c - Unit tests for the trace-event timeline
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+
+#include "timeline.h"
+
+/* Test macros */
+#define TEST_PASS 0
+#define TEST_FAIL 1
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        fprintf(stderr, "  FAIL: %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        return TEST_FAIL; \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(expr) ASSERT_TRUE(!(expr))
+
+
+static int test_events(void)
+{
+    char *path = g_strdup_printf("/tmp/test_timeline.%d.json", (int)getpid());
+    char *text = NULL;
+    gint64 start;
+
+    unlink(path);
+    preload_timeline_open(path, 0);
+    ASSERT_TRUE(preload_timeline_enabled());
+
+    start = g_get_monotonic_time();
+    preload_timeline_span(TIMELINE_MAIN, "sort", start);
+    preload_timeline_request("/home", 42, start, "/home/a \"b\"\\c", 4096, 8192, FALSE);
+    preload_timeline_counter("budget", "readahead", (gint64)1000, "readahead used", (gint64)250, NULL);
+    preload_timeline_span(TIMELINE_SCAN, "a \"b\"", start);
+    preload_timeline_counter("c\\d", "e\"f", (gint64)1, NULL);
+    preload_timeline_flush();
+
+    ASSERT_TRUE(g_file_get_contents(path, &text, NULL, NULL));
+    ASSERT_TRUE(g_str_has_prefix(text, "[\n"));
+    ASSERT_TRUE(strstr(text, "\"name\":\"thread_name\"") != NULL);
+    ASSERT_TRUE(strstr(text, "\"ph\":\"X\",\"name\":\"sort\"") != NULL);
+    ASSERT_TRUE(strstr(text, "\"ph\":\"b\",\"cat\":\"prefetch\",\"name\":\"/home\",\"id\":42") != NULL);
+    ASSERT_TRUE(strstr(text, "\"ph\":\"e\",\"cat\":\"prefetch\"") != NULL);
+    /* paths are escaped */
+    ASSERT_TRUE(strstr(text, "\"path\":\"/home/a \\\"b\\\"\\\\c\"") != NULL);
+    ASSERT_TRUE(strstr(text, "\"args\":{\"readahead\":1000,\"readahead used\":250}") != NULL);
+    /* and so are names */
+    ASSERT_TRUE(strstr(text, "\"name\":\"a \\\"b\\\"\"") != NULL);
+    ASSERT_TRUE(strstr(text, "\"name\":\"c\\\\d\"") != NULL);
+    ASSERT_TRUE(strstr(text, "\"args\":{\"e\\\"f\":1}") != NULL);
+    /* every event is closed, so the array can be read as is */
+    ASSERT_TRUE(g_str_has_suffix(text, "},\n"));
+    g_free(text);
+
+    preload_timeline_close();
+    ASSERT_FALSE(preload_timeline_enabled());
+
+    /* nothing is written when off */
+    unlink(path);
+    preload_timeline_span(TIMELINE_MAIN, "sort", start);
+    preload_timeline_request("/home", 43, start, "/home/a", 0, 4096, FALSE);
+    preload_timeline_counter("budget", "readahead", (gint64)1000, NULL);
+    preload_timeline_flush();
+    ASSERT_TRUE(access(path, F_OK) != 0);
+
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+static int test_rotate(void)
+{
+    char *path = g_strdup_printf("/tmp/test_timeline.%d.json", (int)getpid());
+    char *old = g_strconcat(path, ".1", NULL);
+    char *text = NULL;
+    int i;
+
+    unlink(path);
+    unlink(old);
+    preload_timeline_open(path, 1024);
+
+    for (i = 0; i < 20; i++)
+        preload_timeline_span(TIMELINE_SCAN, "scan", g_get_monotonic_time());
+    preload_timeline_flush();
+
+    /* moved aside, and a new array started */
+    ASSERT_TRUE(access(old, F_OK) == 0);
+    ASSERT_TRUE(g_file_get_contents(path, &text, NULL, NULL));
+    ASSERT_TRUE(g_str_has_prefix(text, "[\n"));
+    ASSERT_TRUE(strstr(text, "\"name\":\"scan\",") == NULL);
+    g_free(text);
+
+    preload_timeline_close();
+    unlink(path);
+    unlink(old);
+    g_free(old);
+    g_free(path);
+    return TEST_PASS;
+}
+
+
+int test_timeline_run(void)
+{
+    int failed = 0;
+
+    fprintf(stderr, "  Running test_events... ");
+    if (test_events() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    fprintf(stderr, "  Running test_rotate... ");
+    if (test_rotate() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+
+    return failed;
+}
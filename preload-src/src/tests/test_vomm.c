@@ -243,6 +243,47 @@ static int test_vomm_double_cleanup(void)
 }
 
 
+static int test_vomm_transition_prob(void)
+{
+    test_init_state();
+    
+    gboolean ok = vomm_init();
+    ASSERT_TRUE(ok);
+    
+    preload_exe_t *exe1 = preload_exe_new("/usr/bin/firefox", FALSE, NULL);
+    preload_exe_t *exe2 = preload_exe_new("/usr/bin/vim", FALSE, NULL);
+    preload_exe_t *exe3 = preload_exe_new("/usr/bin/bash", FALSE, NULL);
+    
+    preload_state_register_exe(exe1, FALSE);
+    preload_state_register_exe(exe2, FALSE);
+    preload_state_register_exe(exe3, FALSE);
+    
+    /* firefox <-> vim, bash never follows anything */
+    vomm_update(exe1);
+    vomm_update(exe2);
+    vomm_update(exe1);
+    vomm_update(exe2);
+    vomm_update(exe1);
+    
+    /* scored whether running or not */
+    exe2->running_timestamp = state->last_running_timestamp;
+    ASSERT_TRUE(vomm_transition_prob(exe2) > 0.5);
+    ASSERT_TRUE(vomm_transition_prob(exe2) <= 1.0);
+    ASSERT_TRUE(vomm_transition_prob(exe3) == 0.0);
+    ASSERT_TRUE(vomm_transition_prob(NULL) == 0.0);
+    
+    vomm_cleanup();
+    ASSERT_TRUE(vomm_transition_prob(exe2) == 0.0);
+    
+    preload_exe_free(exe1);
+    preload_exe_free(exe2);
+    preload_exe_free(exe3);
+    test_cleanup_state();
+    
+    return TEST_PASS;
+}
+
+
 int test_vomm_run(void)
 {
     int failed = 0;
@@ -303,5 +344,12 @@ int test_vomm_run(void)
         failed++;
     }
     
+    fprintf(stderr, "  Running test_vomm_transition_prob... ");
+    if (test_vomm_transition_prob() == TEST_PASS) {
+        fprintf(stderr, "PASS\n");
+    } else {
+        failed++;
+    }
+    
     return failed;
 }
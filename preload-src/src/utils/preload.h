@@ -6,6 +6,7 @@
 #define DEFAULT_CONFFILE	SYSCONFDIR "/" PACKAGE ".conf"
 #define DEFAULT_STATEFILE	PKGLOCALSTATEDIR "/" PACKAGE ".state"
 #define DEFAULT_LOGFILE		LOGDIR "/" PACKAGE ".log"
+#define DEFAULT_STATSFILE	RUNSTATEDIR "/" PACKAGE ".stats"
 #define DEFAULT_LOGLEVEL	4
 #define DEFAULT_NICELEVEL	15
 
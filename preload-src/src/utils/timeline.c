@@ -0,0 +1,200 @@
+/* timeline.c - Trace-event timeline of daemon activity
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "common.h"
+#include "timeline.h"
+#include "log.h"
+
+#include <stdarg.h>
+
+static FILE *out;
+static char *out_path;
+static long out_maxsize;
+
+
+static void
+write_string (const char *s)
+{
+  fputc ('"', out);
+  for (; *s; s++) {
+    unsigned char c = *s;
+
+    if (c == '"' || c == '\\')
+      fprintf (out, "\\%c", c);
+    else if (c < 0x20)
+      fprintf (out, "\\u%04x", c);
+    else
+      fputc (c, out);
+  }
+  fputc ('"', out);
+}
+
+static void
+write_thread_name (preload_timeline_track_t track, const char *name)
+{
+  fprintf (out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+	   (int)getpid (), track);
+  write_string (name);
+  fputs ("}},\n", out);
+}
+
+/* an empty file gets the array opened; every file gets names for its tracks */
+static void
+write_header (void)
+{
+  if (ftell (out) == 0)
+    fputs ("[\n", out);
+
+  fprintf (out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":",
+	   (int)getpid ());
+  write_string (PACKAGE);
+  fputs ("}},\n", out);
+  write_thread_name (TIMELINE_MAIN, "main loop");
+  write_thread_name (TIMELINE_SCAN, "scan");
+}
+
+static gboolean
+open_file (void)
+{
+  out = fopen (out_path, "a");
+  if (!out) {
+    g_warning ("cannot open trace file %s: %s", out_path, strerror (errno));
+    return FALSE;
+  }
+
+  fseek (out, 0, SEEK_END);
+  write_header ();
+  return TRUE;
+}
+
+void
+preload_timeline_open (const char *path, int maxsize)
+{
+  if (out && path && !g_strcmp0 (path, out_path)) {
+    /* same file, just pick up the new limit */
+    out_maxsize = maxsize;
+    return;
+  }
+
+  preload_timeline_close ();
+  if (!path || !*path)
+    return;
+
+  out_path = g_strdup (path);
+  out_maxsize = maxsize;
+  if (open_file ())
+    g_debug ("writing timeline to %s", out_path);
+}
+
+gboolean
+preload_timeline_enabled (void)
+{
+  return out != NULL;
+}
+
+void
+preload_timeline_span (preload_timeline_track_t track, const char *name, gint64 start)
+{
+  if (!out)
+    return;
+
+  fputs ("{\"ph\":\"X\",\"name\":", out);
+  write_string (name);
+  fprintf (out, ",\"pid\":%d,\"tid\":%d,\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT "},\n",
+	   (int)getpid (), track, start, g_get_monotonic_time () - start);
+}
+
+void
+preload_timeline_request (const char *group, guint64 id, gint64 start,
+			  const char *path, size_t offset, size_t length, gboolean killed)
+{
+  gint64 now;
+  int i;
+
+  if (!out)
+    return;
+
+  /* async begin and end, as requests on the same mount overlap */
+  now = g_get_monotonic_time ();
+  for (i = 0; i < 2; i++) {
+    fprintf (out, "{\"ph\":\"%s\",\"cat\":\"prefetch\",\"name\":", i ? "e" : "b");
+    write_string (group);
+    fprintf (out, ",\"id\":%" G_GUINT64_FORMAT ",\"pid\":%d,\"ts\":%" G_GINT64_FORMAT,
+	     id, (int)getpid (), i ? now : start);
+    if (!i) {
+      fputs (",\"args\":{\"path\":", out);
+      write_string (path ? path : "metadata");
+      fprintf (out, ",\"offset\":%zu,\"length\":%zu,\"killed\":%s}",
+	       offset, length, killed ? "true" : "false");
+    }
+    fputs ("},\n", out);
+  }
+}
+
+void
+preload_timeline_counter (const char *name, ...)
+{
+  const char *series;
+  const char *sep = "";
+  va_list ap;
+
+  if (!out)
+    return;
+
+  fputs ("{\"ph\":\"C\",\"name\":", out);
+  write_string (name);
+  fprintf (out, ",\"pid\":%d,\"ts\":%" G_GINT64_FORMAT ",\"args\":{",
+	   (int)getpid (), g_get_monotonic_time ());
+  va_start (ap, name);
+  while ((series = va_arg (ap, const char *))) {
+    fputs (sep, out);
+    write_string (series);
+    fprintf (out, ":%" G_GINT64_FORMAT, va_arg (ap, gint64));
+    sep = ",";
+  }
+  va_end (ap);
+  fputs ("}},\n", out);
+}
+
+void
+preload_timeline_flush (void)
+{
+  char *old;
+
+  if (!out)
+    return;
+
+  fflush (out);
+  if (out_maxsize <= 0 || ftell (out) < out_maxsize)
+    return;
+
+  /* keep one generation around */
+  fclose (out);
+  out = NULL;
+  old = g_strconcat (out_path, ".1", NULL);
+  if (0 > rename (out_path, old))
+    g_warning ("cannot rotate %s: %s", out_path, strerror (errno));
+  g_free (old);
+
+  if (open_file ())
+    fflush (out);
+}
+
+void
+preload_timeline_close (void)
+{
+  if (out)
+    fclose (out);
+  out = NULL;
+  g_free (out_path);
+  out_path = NULL;
+}
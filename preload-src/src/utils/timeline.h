@@ -0,0 +1,53 @@
+/* timeline.h - Trace-event timeline of daemon activity
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <glib.h>
+
+/*
+ * When system.tracefile is set, what the daemon does and when is written
+ * there as Chrome trace-event JSON, to open in Perfetto or chrome://tracing:
+ * spans for the phases of each tick, saves and validations, prefetch
+ * requests grouped per mount, and counters for budgets and memory.
+ *
+ * The file is a JSON array left open at the end, which both tools accept,
+ * so it can be read while being written.  Once it grows past
+ * system.tracesize it is moved to <tracefile>.1 and a new one is started.
+ * Times are monotonic microseconds.
+ */
+
+/* tracks spans are drawn on */
+typedef enum
+{
+  TIMELINE_MAIN = 1,	/* main loop: prediction, model updates, saves */
+  TIMELINE_SCAN		/* scans, which may overlap prediction */
+} preload_timeline_track_t;
+
+/* (re)opens path for appending, rotating at maxsize bytes; empty or NULL
+ * turns the timeline off */
+void preload_timeline_open (const char *path, int maxsize);
+
+gboolean preload_timeline_enabled (void);
+
+/* a span on track from start until now */
+void preload_timeline_span (preload_timeline_track_t track, const char *name, gint64 start);
+
+/* a prefetch request from start until now, on the track of group */
+void preload_timeline_request (const char *group, guint64 id, gint64 start,
+			       const char *path, size_t offset, size_t length, gboolean killed);
+
+/* values of a counter, as NULL-terminated pairs of series name and gint64 */
+void preload_timeline_counter (const char *name, ...) G_GNUC_NULL_TERMINATED;
+
+/* writes out what is buffered, rotating the file if due */
+void preload_timeline_flush (void);
+
+void preload_timeline_close (void);
+
+#endif
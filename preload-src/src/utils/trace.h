@@ -0,0 +1,46 @@
+/* trace.h - Static tracepoints
+ *
+ * Copyright (C) 2025  Preload-NG Team
+ *
+ * This file is part of preload.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * USDT probes, for bpftrace, perf or SystemTap to attach to a running
+ * daemon, e.g.
+ *
+ *   bpftrace -e 'usdt:/usr/sbin/preload:preload:prefetch_done
+ *                { @lat = hist(arg3); }'
+ *
+ * A probe is a single nop until something attaches to it, and its
+ * arguments are only what is at hand anyway.  They are compiled in when
+ * <sys/sdt.h> is found at build time (the Makefile sets HAVE_SYS_SDT_H;
+ * make USDT=0 leaves them out), and expand to nothing otherwise.
+ *
+ * Probes, all in the "preload" provider:
+ *
+ *   process_start (pid, path)		a process of a known exe showed up
+ *   process_stop (pid, path)		the last process of an exe went away
+ *   exe_new (pid, path, size)		an exe was added to the model
+ *   markov_state (a, b, old, new)	a chain of exes a and b changed state
+ *   exe_bid (path, lnprob)		final bid of an exe, lnprob in millionths
+ *   prefetch_issue (path, offset, length, reader)
+ *   prefetch_done (path, offset, length, usecs, killed)
+ *   phase (name)			a prediction phase started
+ *   scan_begin (), scan_end ()
+ *   update_begin (), update_end ()
+ *
+ * path is NULL in prefetch probes of metadata warming requests.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define PRELOAD_TRACE(name, ...) STAP_PROBEV (preload, name, ##__VA_ARGS__)
+#else
+#define PRELOAD_TRACE(name, ...) do { } while (0)
+#endif
+
+#endif /* TRACE_H */
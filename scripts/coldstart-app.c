@@ -0,0 +1,127 @@
+/* coldstart-app.c - Synthetic application for scripts/coldstart.sh
+ *
+ * Copyright (C) 2025  Preload-NG Contributors
+ *
+ * This file is part of preload.
+ *
+ * Usage: app MANIFEST HOLD_MS
+ *
+ * Maps every file listed in MANIFEST, one path per line, and reads one
+ * byte of each page, the way a real program faults its libraries and data
+ * in on startup.  Then prints how that went on one line:
+ *
+ *   latency_us=N majflt=N read_kb=N
+ *
+ * and stays up, with everything still mapped, for HOLD_MS milliseconds,
+ * so the daemon sees it running.  read_kb is -1 without task I/O
+ * accounting in the kernel.
+ *
+ * The benchmark makes one copy of this binary per synthetic app, so each
+ * is an exe of its own to the daemon.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+static long long
+now_us (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static long long
+read_bytes (void)
+{
+  char line[128];
+  long long bytes = -1;
+  FILE *f = fopen ("/proc/self/io", "r");
+
+  if (!f)
+    return -1;
+  while (fgets (line, sizeof (line), f))
+    if (sscanf (line, "read_bytes: %lld", &bytes) == 1)
+      break;
+  fclose (f);
+  return bytes;
+}
+
+/* maps path and faults every page in; the mapping is kept */
+static void
+touch_file (const char *path, long pagesize, volatile unsigned char *sum)
+{
+  struct stat st;
+  unsigned char *p;
+  off_t off;
+  int fd;
+
+  fd = open (path, O_RDONLY);
+  if (fd < 0) {
+    perror (path);
+    return;
+  }
+
+  if (fstat (fd, &st) == 0 && st.st_size > 0) {
+    p = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+      perror (path);
+    else
+      for (off = 0; off < st.st_size; off += pagesize)
+	*sum += p[off];
+  }
+
+  close (fd);
+}
+
+int
+main (int argc, char **argv)
+{
+  volatile unsigned char sum = 0;
+  long long start, latency, before, after;
+  struct rusage ru;
+  char path[4096];
+  long pagesize;
+  FILE *manifest;
+
+  if (argc != 3) {
+    fprintf (stderr, "usage: %s MANIFEST HOLD_MS\n", argv[0]);
+    return 2;
+  }
+
+  start = now_us ();
+  before = read_bytes ();
+  pagesize = sysconf (_SC_PAGESIZE);
+
+  manifest = fopen (argv[1], "r");
+  if (!manifest) {
+    perror (argv[1]);
+    return 1;
+  }
+  while (fgets (path, sizeof (path), manifest)) {
+    path[strcspn (path, "\n")] = '\0';
+    if (*path)
+      touch_file (path, pagesize, &sum);
+  }
+  fclose (manifest);
+
+  latency = now_us () - start;
+  after = read_bytes ();
+  getrusage (RUSAGE_SELF, &ru);
+
+  printf ("latency_us=%lld majflt=%ld read_kb=%lld\n", latency, ru.ru_majflt,
+	  before < 0 || after < 0 ? -1 : (after - before) / 1024);
+  fflush (stdout);
+
+  usleep (atol (argv[2]) * 1000);
+  return 0;
+}
@@ -0,0 +1,389 @@
+#!/bin/bash
+# Cold-start benchmark for preload-ng on a synthetic app corpus
+#
+# Unlike bench.sh, this needs nothing but a C compiler and root: it
+# generates its own "apps" (copies of scripts/coldstart-app.c, each mapping
+# and touching its own set of generated library and data files), trains
+# the daemon built in preload-src on scripted launch sequences, then
+# replays them on cold caches with prediction off and on, measuring
+# launch latency, major faults, bytes read and daemon CPU.
+#
+# The corpus is generated once per work directory and reused, so numbers
+# stay comparable across commits.  Results are appended to
+# WORKDIR/results.csv and WORKDIR/daemon.csv.
+
+set -e
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+# Configuration
+SCRIPT_DIR="$(dirname "$(readlink -f "$0")")"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+BINARY="$PROJECT_ROOT/preload-src/preload"
+WORKDIR="/var/tmp/preload-coldstart"
+ENGINE="VOMM"
+EXTRA_CONF=""
+APPS=9
+LIBS=12
+APP_LIBS=4
+LIB_KB=4096
+DATA_KB=16384
+SEED=1
+CYCLE=4
+TRAIN_ROUNDS=3
+RUNS=3
+
+print_header() {
+    echo -e "${BLUE}==========================================${NC}"
+    echo -e "${BLUE}  Preload-NG - Cold-Start Benchmark${NC}"
+    echo -e "${BLUE}==========================================${NC}"
+    echo ""
+}
+
+print_success() {
+    echo -e "${GREEN}✓ $1${NC}"
+}
+
+print_error() {
+    echo -e "${RED}✗ $1${NC}"
+}
+
+print_warning() {
+    echo -e "${YELLOW}! $1${NC}"
+}
+
+print_info() {
+    echo -e "${BLUE}→ $1${NC}"
+}
+
+check_root() {
+    if [ "$EUID" -ne 0 ]; then
+        print_error "This script must be run as root (use sudo)"
+        exit 1
+    fi
+}
+
+check_dependencies() {
+    print_info "Checking dependencies..."
+
+    if ! command -v cc &>/dev/null; then
+        print_error "Missing dependency: cc"
+        exit 1
+    fi
+
+    if [ ! -x "$BINARY" ]; then
+        print_error "Daemon not found at $BINARY, build it first (scripts/build.sh)"
+        exit 1
+    fi
+
+    print_success "All dependencies found"
+}
+
+clear_cache() {
+    sync
+    echo 3 >/proc/sys/vm/drop_caches
+}
+
+# generate_corpus: apps, their files and launch sequences, once per WORKDIR
+generate_corpus() {
+    local corpus="$WORKDIR/corpus"
+    local i j
+
+    if [ -f "$corpus/sequences" ]; then
+        print_success "Reusing corpus in $corpus"
+        return
+    fi
+
+    print_info "Generating corpus in $corpus..."
+    rm -rf "$corpus"
+    mkdir -p "$corpus/bin" "$corpus/lib" "$corpus/data" "$corpus/apps"
+
+    cc -O2 -o "$corpus/coldstart-app" "$SCRIPT_DIR/coldstart-app.c"
+
+    RANDOM=$SEED
+    for ((i = 0; i < LIBS; i++)); do
+        head -c "$(((LIB_KB / 2 + RANDOM % LIB_KB) * 1024))" /dev/urandom \
+            >"$corpus/lib/lib$i.so"
+    done
+
+    for ((i = 0; i < APPS; i++)); do
+        local app="app$i"
+
+        cp "$corpus/coldstart-app" "$corpus/bin/$app"
+        head -c "$(((DATA_KB / 2 + RANDOM % DATA_KB) * 1024))" /dev/urandom \
+            >"$corpus/data/$app.dat"
+
+        echo "$corpus/data/$app.dat" >"$corpus/apps/$app"
+        for ((j = 0; j < APP_LIBS; j++)); do
+            echo "$corpus/lib/lib$((RANDOM % LIBS)).so"
+        done | sort -u >>"$corpus/apps/$app"
+    done
+
+    # each sequence is a workflow: apps started one after the other
+    for ((i = 0; i < APPS; i += 3)); do
+        echo "app$i app$(((i + 1) % APPS)) app$(((i + 2) % APPS))"
+    done >"$corpus/sequences"
+
+    print_success "Generated $APPS apps, $LIBS libraries, $(wc -l <"$corpus/sequences") sequences"
+}
+
+# write_conf FILE DOPREDICT
+write_conf() {
+    cat >"$1" <<EOF
+[model]
+cycle = $CYCLE
+minsize = 100000
+memfree = 90
+memcached = 50
+
+[system]
+doscan = true
+dopredict = $2
+prediction_algorithm = $ENGINE
+autosave = 3600
+mapprefix =
+exeprefix =
+EOF
+    if [ -n "$EXTRA_CONF" ]; then
+        cat "$EXTRA_CONF" >>"$1"
+    fi
+}
+
+DAEMON_PID=""
+DAEMON_CPU=0
+
+# start_daemon NAME DOPREDICT
+start_daemon() {
+    write_conf "$WORKDIR/$1.conf" "$2"
+    "$BINARY" -f -c "$WORKDIR/$1.conf" -s "$WORKDIR/$1.state" \
+        -l "$WORKDIR/$1.log" -t "" &
+    DAEMON_PID=$!
+    sleep "$CYCLE"
+}
+
+# stop_daemon: sets DAEMON_CPU to the CPU time it used, in milliseconds
+stop_daemon() {
+    local ticks
+
+    ticks=$(awk '{ print $14 + $15 }' "/proc/$DAEMON_PID/stat")
+    kill "$DAEMON_PID"
+    wait "$DAEMON_PID" 2>/dev/null || true
+    DAEMON_PID=""
+    DAEMON_CPU=$((ticks * 1000 / $(getconf CLK_TCK)))
+}
+
+# run_sequence SEQUENCE HOLD_MS OUTPUT_PREFIX: starts the apps one cycle apart
+run_sequence() {
+    local prefix="$3"
+    local pos=0
+    local pids=""
+    local app
+
+    for app in $1; do
+        "$WORKDIR/corpus/bin/$app" "$WORKDIR/corpus/apps/$app" "$2" \
+            >"$prefix.$pos.$app" &
+        pids="$pids $!"
+        pos=$((pos + 1))
+        sleep "$CYCLE"
+    done
+    wait $pids
+}
+
+train() {
+    local round seq
+
+    print_info "Training the daemon ($TRAIN_ROUNDS rounds)..."
+    rm -f "$WORKDIR/train.state"
+    start_daemon train true
+
+    for ((round = 1; round <= TRAIN_ROUNDS; round++)); do
+        while read -r seq; do
+            run_sequence "$seq" $((CYCLE * 4 * 1000)) "$WORKDIR/out/train"
+        done <"$WORKDIR/corpus/sequences"
+    done
+
+    stop_daemon
+    print_success "Trained"
+}
+
+# measure MODE DOPREDICT
+measure() {
+    local mode="$1"
+    local round seq n line file name
+
+    print_info "Measuring with prediction $mode ($RUNS rounds)..."
+    cp "$WORKDIR/train.state" "$WORKDIR/$mode.state"
+    start_daemon "$mode" "$2"
+
+    for ((round = 1; round <= RUNS; round++)); do
+        n=0
+        while read -r seq; do
+            rm -f "$WORKDIR/out/run".*
+            clear_cache
+            sleep 1
+            run_sequence "$seq" $((CYCLE * 4 * 1000)) "$WORKDIR/out/run"
+
+            for file in "$WORKDIR/out/run".*; do
+                name=${file##*/run.}
+                line=$(sed -e 's/[a-z_]*=//g; s/ /,/g' "$file")
+                echo "$COMMIT,$ENGINE,$mode,$round,$n,${name%%.*},${name#*.},$line" \
+                    >>"$WORKDIR/results.csv"
+            done
+            n=$((n + 1))
+        done <"$WORKDIR/corpus/sequences"
+    done
+
+    stop_daemon
+    echo "$COMMIT,$ENGINE,$mode,$DAEMON_CPU" >>"$WORKDIR/daemon.csv"
+    print_success "Done, daemon used ${DAEMON_CPU}ms of CPU"
+}
+
+summarize() {
+    echo ""
+    echo -e "${GREEN}==========================================${NC}"
+    echo -e "${GREEN}  Results ($ENGINE, $COMMIT)${NC}"
+    echo -e "${GREEN}==========================================${NC}"
+    echo ""
+    printf "%-6s %-8s %12s %10s %10s\n" mode position latency_ms majflt read_kb
+    awk -F, -v commit="$COMMIT" -v engine="$ENGINE" -v stamp="$STAMP" '
+        NR > stamp && $1 == commit && $2 == engine {
+            key = $3 " " ($6 == 0 ? "first" : "next")
+            n[key]++; lat[key] += $8; flt[key] += $9; kb[key] += $10
+        }
+        END {
+            for (key in n)
+                printf "%-6s %-8s %12.1f %10.1f %10.1f\n", substr(key, 1, index(key, " ") - 1),
+                    substr(key, index(key, " ") + 1), lat[key] / n[key] / 1000,
+                    flt[key] / n[key], kb[key] / n[key]
+        }' "$WORKDIR/results.csv" | sort
+    echo ""
+    echo "Daemon CPU (ms):"
+    tail -n 2 "$WORKDIR/daemon.csv" | awk -F, '{ printf "  %-4s %s\n", $3, $4 }'
+    echo ""
+    print_info "'first' apps start on cold caches in both modes; 'next' ones may be prefetched."
+    print_info "Raw numbers: $WORKDIR/results.csv, $WORKDIR/daemon.csv"
+}
+
+cleanup() {
+    if [ -n "$DAEMON_PID" ]; then
+        kill "$DAEMON_PID" 2>/dev/null || true
+    fi
+}
+
+show_help() {
+    echo "Preload-NG Cold-Start Benchmark"
+    echo ""
+    echo "Usage: sudo $0 [OPTIONS]"
+    echo ""
+    echo "Options:"
+    echo "  -e, --engine NAME   Prediction algorithm, VOMM, Markov, Frecency or Logistic"
+    echo "                      (default: $ENGINE)"
+    echo "  -C, --conf FILE     Extra configuration appended to the daemon's"
+    echo "  -b, --binary PATH   Daemon to run (default: $BINARY)"
+    echo "  -w, --workdir DIR   Corpus and results, on the disk to test (default: $WORKDIR)"
+    echo "  -a, --apps N        Synthetic apps in a new corpus (default: $APPS)"
+    echo "  -l, --libs N        Shared libraries in a new corpus (default: $LIBS)"
+    echo "  -s, --seed N        Seed for a new corpus (default: $SEED)"
+    echo "  -c, --cycle N       Daemon cycle in seconds (default: $CYCLE)"
+    echo "  -t, --train N       Training rounds (default: $TRAIN_ROUNDS)"
+    echo "  -r, --runs N        Measured rounds per mode (default: $RUNS)"
+    echo "  -h, --help          Show this help message"
+    echo ""
+    echo "Delete WORKDIR/corpus to generate a new corpus."
+    echo ""
+}
+
+# Parse arguments
+while [[ $# -gt 0 ]]; do
+    case $1 in
+    -e | --engine)
+        case $2 in
+        VOMM | Markov | Frecency | Logistic) ;;
+        *)
+            print_error "Unknown engine: $2"
+            show_help
+            exit 1
+            ;;
+        esac
+        ENGINE="$2"
+        shift 2
+        ;;
+    -C | --conf)
+        EXTRA_CONF="$(readlink -f "$2")"
+        shift 2
+        ;;
+    -b | --binary)
+        BINARY="$(readlink -f "$2")"
+        shift 2
+        ;;
+    -w | --workdir)
+        WORKDIR="$2"
+        shift 2
+        ;;
+    -a | --apps)
+        APPS="$2"
+        shift 2
+        ;;
+    -l | --libs)
+        LIBS="$2"
+        shift 2
+        ;;
+    -s | --seed)
+        SEED="$2"
+        shift 2
+        ;;
+    -c | --cycle)
+        CYCLE="$2"
+        shift 2
+        ;;
+    -t | --train)
+        TRAIN_ROUNDS="$2"
+        shift 2
+        ;;
+    -r | --runs)
+        RUNS="$2"
+        shift 2
+        ;;
+    -h | --help)
+        show_help
+        exit 0
+        ;;
+    *)
+        print_error "Unknown option: $1"
+        show_help
+        exit 1
+        ;;
+    esac
+done
+
+# Main
+print_header
+check_root
+check_dependencies
+
+COMMIT=$(git -C "$PROJECT_ROOT" rev-parse --short HEAD 2>/dev/null || echo unknown)
+mkdir -p "$WORKDIR/out"
+[ -s "$WORKDIR/results.csv" ] ||
+    echo "commit,engine,mode,round,sequence,position,app,latency_us,majflt,read_kb" >"$WORKDIR/results.csv"
+[ -s "$WORKDIR/daemon.csv" ] ||
+    echo "commit,engine,mode,cpu_ms" >"$WORKDIR/daemon.csv"
+STAMP=$(wc -l <"$WORKDIR/results.csv")
+trap cleanup EXIT
+
+echo "Configuration:"
+echo "  Daemon:          $BINARY ($COMMIT)"
+echo "  Engine:          $ENGINE"
+echo "  Work directory:  $WORKDIR"
+echo "  Cycle:           ${CYCLE}s"
+echo ""
+
+generate_corpus
+train
+measure off false
+measure on true
+summarize